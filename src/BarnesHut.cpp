@@ -0,0 +1,155 @@
+#include "BarnesHut.h"
+#include "Chebyshev.h"
+#include "ForceKernel.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+// Particules partageant une liste d'interactions : ~70 en moyenne. Listes ~35 % plus longues qu'avec 64
+// (~18 en moyenne), mais 4x moins de parcours et des blocs de 16 cibles remplis à 90 % au lieu de 72 %
+const int GROUP_SIZE = 256;
+static_assert(BarnesHutSolver::SPLIT_TERMS == FORCE_POLY_TERMS, "g(t) évalué par le noyau de ForceKernel.h");
+
+} // namespace
+
+// Facteur de la partie courte portée (force longue portée = gaussienne exp(-k² r_s²) en Fourier) :
+//   g(r) = erfc(x) + 2x / sqrt(π) exp(-x²),  x = r / (2 r_s)
+// Interpolé aux noeuds de Tchebychev sur [0, rcut] puis converti en monômes de t = 2 r / rcut - 1.
+void BarnesHutSolver::SetShortRange(float splitScaleValue) {
+    splitScale = std::max(splitScaleValue, 0.0f);
+    cutoff = splitScale * SPLIT_CUTOFF;
+    if (splitScale <= 0.0f) return;
+
+    const int N = SPLIT_TERMS;
+    const double PI = 3.14159265358979323846;
+    double cheb[N] = {};
+    for (int j = 0; j < N; j++) {
+        const double angle = PI * (j + 0.5) / N;
+        const double x = 0.5 * SPLIT_CUTOFF * (std::cos(angle) + 1.0) / 2.0;    // r / (2 r_s)
+        const double g = std::erfc(x) + 2.0 * x / std::sqrt(PI) * std::exp(-x * x);
+        for (int k = 0; k < N; k++) cheb[k] += 2.0 / N * g * std::cos(k * angle);
+    }
+    cheb[0] *= 0.5;
+    ChebyshevToMonomial(cheb, splitPoly);
+}
+
+void BarnesHutSolver::ComputeAccelerations(const float* positions, size_t count, float G, float thetaValue,
+                                           float softening, float* accelerations) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    stats = BarnesHutStats();
+    if (count == 0) return;
+    const float theta = std::min(std::max(thetaValue, 0.05f), 1.0f);
+
+    // 1. Arbre, puis rayon d'ouverture de chaque noeud à partir de sa cellule géométrique
+    tree.Build(positions, count, LEAF_SIZE);
+    const std::vector<Octree::Node>& nodes = tree.nodes;
+    const std::vector<float>& px = tree.px;
+    const std::vector<float>& py = tree.py;
+    const std::vector<float>& pz = tree.pz;
+    const std::vector<float>& pm = tree.pm;
+    openSq.resize(nodes.size());
+    ParallelFor(0, nodes.size(), 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const Octree::Node& n = nodes[i];
+            const float dx = n.comX - n.cx, dy = n.comY - n.cy, dz = n.comZ - n.cz;
+            const float open = n.size / theta + std::sqrt(dx * dx + dy * dy + dz * dz);
+            openSq[i] = open * open;
+        }
+    });
+    // Groupes : plus hauts noeuds d'au plus GROUP_SIZE particules (les feuilles seules, ~5 particules
+    // en moyenne, laisseraient la plupart des voies SIMD vides)
+    groups.clear();
+    for (uint32_t i = 0; i < (uint32_t)nodes.size(); ) {
+        if (nodes[i].leaf || nodes[i].count <= (uint32_t)GROUP_SIZE) {
+            groups.push_back(i);
+            i = nodes[i].next;
+        } else {
+            i++;
+        }
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    // 2. Parcours : une liste d'interactions par groupe, évaluée par le noyau SIMD (ForceKernel.h)
+    const float eps2 = softening * softening;
+    const bool shortRange = splitScale > 0.0f;
+    // TreePM : chaque terme multiplié par le facteur de coupure g(r), polynôme en t = 2 r / rcut - 1
+    const ForceKernel kernel = SelectForceKernel(shortRange ? FACTOR_CUTOFF : FACTOR_NONE, DetectSimdLevel());
+    ForceParams params;
+    params.eps2 = eps2;
+    params.tScale = shortRange ? 2.0f / cutoff : 0.0f;
+    params.poly = splitPoly;
+    const float cutoff2 = cutoff * cutoff;
+    const uint32_t nodeCount = (uint32_t)nodes.size();
+    std::atomic<uint64_t> interactions{0};
+    ParallelFor(0, groups.size(), 4, [&](size_t begin, size_t end) {
+        std::vector<float> lx, ly, lz, lm;
+        uint64_t localInteractions = 0;
+        for (size_t gi = begin; gi < end; gi++) {
+            const Octree::Node& group = nodes[groups[gi]];
+            const size_t first = group.first, last = group.first + group.count;
+
+            float minX = px[first], maxX = px[first];
+            float minY = py[first], maxY = py[first];
+            float minZ = pz[first], maxZ = pz[first];
+            for (size_t i = first + 1; i < last; i++) {
+                minX = std::min(minX, px[i]); maxX = std::max(maxX, px[i]);
+                minY = std::min(minY, py[i]); maxY = std::max(maxY, py[i]);
+                minZ = std::min(minZ, pz[i]); maxZ = std::max(maxZ, pz[i]);
+            }
+
+            lx.clear(); ly.clear(); lz.clear(); lm.clear();
+            uint32_t i = 0;
+            while (i < nodeCount) {
+                const Octree::Node& n = nodes[i];
+                if (shortRange) {
+                    // Cellule entière au-delà de rcut : aucune contribution
+                    const float h = 0.5f * n.size;
+                    const float cx = std::max(std::max(minX - (n.cx + h), (n.cx - h) - maxX), 0.0f);
+                    const float cy = std::max(std::max(minY - (n.cy + h), (n.cy - h) - maxY), 0.0f);
+                    const float cz = std::max(std::max(minZ - (n.cz + h), (n.cz - h) - maxZ), 0.0f);
+                    if (cx * cx + cy * cy + cz * cz > cutoff2) {
+                        i = n.next;
+                        continue;
+                    }
+                }
+                const float dx = std::max(std::max(minX - n.comX, n.comX - maxX), 0.0f);
+                const float dy = std::max(std::max(minY - n.comY, n.comY - maxY), 0.0f);
+                const float dz = std::max(std::max(minZ - n.comZ, n.comZ - maxZ), 0.0f);
+                if (dx * dx + dy * dy + dz * dz > openSq[i]) {
+                    lx.push_back(n.comX); ly.push_back(n.comY); lz.push_back(n.comZ); lm.push_back(n.mass);
+                    i = n.next;
+                } else if (n.leaf) {
+                    // Voisins proches (y compris le groupe lui-même : r = 0 donne une force nulle)
+                    lx.insert(lx.end(), px.begin() + n.first, px.begin() + n.first + n.count);
+                    ly.insert(ly.end(), py.begin() + n.first, py.begin() + n.first + n.count);
+                    lz.insert(lz.end(), pz.begin() + n.first, pz.begin() + n.first + n.count);
+                    lm.insert(lm.end(), pm.begin() + n.first, pm.begin() + n.first + n.count);
+                    i = n.next;
+                } else {
+                    i++;
+                }
+            }
+
+            const size_t listSize = lx.size();
+            EvaluateTargets(kernel, px.data(), py.data(), pz.data(), first, last, lx.data(), ly.data(), lz.data(),
+                            lm.data(), listSize, params, [&](size_t i, float fx, float fy, float fz) {
+                                float* a = accelerations + 4 * (size_t)tree.order[i];
+                                a[0] = G * fx; a[1] = G * fy; a[2] = G * fz; a[3] = 0.0f;
+                            });
+            localInteractions += (uint64_t)listSize * group.count;
+        }
+        interactions += localInteractions;
+    });
+
+    auto t2 = std::chrono::high_resolution_clock::now();
+    stats.buildMs = std::chrono::duration<float, std::milli>(t1 - t0).count();
+    stats.walkMs = std::chrono::duration<float, std::milli>(t2 - t1).count();
+    stats.nodeCount = nodes.size();
+    stats.interactionsPerParticle = (double)interactions.load() / (double)count;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "Octree.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --- Solveur Barnes-Hut (CPU) ---
+// Octree reconstruit à chaque pas (voir Octree.h), parcouru sans pile grâce aux liens "next".
+// Parcours par groupe (sous-arbre d'au plus 256 particules voisines) : une seule liste d'interactions
+// en SoA (x, y, z, m), partagée par tout le groupe, évaluée par le noyau de ForceKernel.h (AVX2 /
+// AVX-512 selon le processeur) par blocs de 16 particules.
+//
+// Critère d'ouverture : noeud accepté si d > s / θ + δ (s = côté, δ = écart centre de masse / centre
+// géométrique), d mesuré jusqu'à la boîte englobante du groupe. L'erreur relative est bornée par θ
+// et un noeud ne peut jamais être accepté par une particule qu'il contient (θ <= 1).
+//
+// Débit mesuré (sphère de Plummer, 200k particules, un coeur AVX-512) : ~0.3 M particules/s à θ = 0.6,
+// ~0.8 M à θ = 1. Les listes sont évaluées à ~2 G interactions/s ; parcours et construction des listes
+// font le reste. Au million de particules par défaut : ~1 s par pas sur 4 coeurs à θ = 0.6, interactif
+// jusqu'à ~10^5 particules ; au-delà, PM ou arbre GPU.
+
+struct BarnesHutStats {
+    float buildMs = 0.0f;                 // Bornes + clés + tri + arbre
+    float walkMs = 0.0f;                  // Parcours + forces
+    size_t nodeCount = 0;
+    double interactionsPerParticle = 0.0;
+};
+
+class BarnesHutSolver {
+public:
+    static const int LEAF_SIZE = 16;
+    static const int SPLIT_TERMS = 12;          // Degré 11 : erreur ~2e-6 sur le facteur de coupure
+    static constexpr float SPLIT_CUTOFF = 4.5f; // rcut / r_s (GADGET-2) : g(rcut) ~ 2 %
+
+    // positions : count x (x, y, z, masse) ; accelerations : count x (ax, ay, az, 0), ordre d'origine.
+    // Adoucissement de Plummer : a = G m r / (r² + ε²)^(3/2).
+    void ComputeAccelerations(const float* positions, size_t count, float G, float theta, float softening,
+                              float* accelerations);
+
+    // TreePM : ne calcule que la partie courte portée, complémentaire d'un PM filtré par exp(-k² r_s²)
+    // (PMSolver, splitCells). Noeuds au-delà de rcut = SPLIT_CUTOFF x r_s ignorés. 0 : force complète.
+    void SetShortRange(float splitScale);
+
+    const BarnesHutStats& Stats() const { return stats; }
+
+private:
+    Octree tree;
+    std::vector<float> openSq;       // (s / θ + δ)² par noeud : accepté si d² > openSq
+    std::vector<uint32_t> groups;    // Noeuds parcourus : une liste d'interactions chacun
+
+    float splitScale = 0.0f, cutoff = 0.0f;
+    float splitPoly[SPLIT_TERMS] = {};
+
+    BarnesHutStats stats;
+};
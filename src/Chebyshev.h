@@ -0,0 +1,20 @@
+#pragma once
+
+// --- Séries de Tchebychev -> monômes ---
+// Facteurs radiaux des noyaux de force (coupure TreePM, référence P3M) : interpolés aux noeuds de
+// Tchebychev, puis évalués par Horner en monômes de t dans la boucle interne.
+// Σ c_k T_k(t) -> Σ a_i t^i, avec T_{k+1} = 2t T_k - T_{k-1}
+
+template <int N>
+inline void ChebyshevToMonomial(const double (&cheb)[N], float (&monomials)[N]) {
+    double mono[N] = {}, prev[N] = {}, curr[N] = {}, next[N];
+    prev[0] = 1.0;                  // T_0
+    curr[1] = 1.0;                  // T_1
+    mono[0] = cheb[0];
+    for (int i = 0; i < N; i++) mono[i] += cheb[1] * curr[i];
+    for (int k = 2; k < N; k++) {
+        for (int i = 0; i < N; i++) next[i] = (i > 0 ? 2.0 * curr[i - 1] : 0.0) - prev[i];
+        for (int i = 0; i < N; i++) { mono[i] += cheb[k] * next[i]; prev[i] = curr[i]; curr[i] = next[i]; }
+    }
+    for (int i = 0; i < N; i++) monomials[i] = (float)mono[i];
+}
@@ -0,0 +1,39 @@
+#include "ComputeShader.h"
+
+#include <algorithm>
+#include <iostream>
+
+GLuint CreateComputeProgram(const char* source, const std::string& defines) {
+    const std::string header = "#version 430 core\n" + defines;
+    const char* sources[] = { header.c_str(), source };
+    GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(shader, 2, sources, NULL);
+    glCompileShader(shader);
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[1024];
+        glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+        std::cerr << "COMPUTE SHADER ERROR:\n" << infoLog << std::endl;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+    glDeleteShader(shader);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[1024];
+        glGetProgramInfoLog(program, 1024, NULL, infoLog);
+        std::cerr << "COMPUTE LINK ERROR:\n" << infoLog << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void DispatchCompute1D(GLuint groups) {
+    if (groups == 0) return;
+    const GLuint x = std::min<GLuint>(groups, 65535u);
+    glDispatchCompute(x, (groups + x - 1) / x, 1);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <glad/glad.h>
+#include <string>
+
+// --- Compute shaders (OpenGL 4.3) ---
+// Le source ne contient pas de ligne #version : "#version 430 core" puis defines sont préfixés,
+// ce qui permet d'injecter des constantes de compilation (tailles de mémoire partagée, etc.).
+// Renvoie 0 (erreur affichée sur stderr) si la compilation ou l'édition de liens échoue.
+GLuint CreateComputeProgram(const char* source, const std::string& defines = std::string());
+
+// glDispatchCompute sur une grille 1D de groups workgroups, répartie en x * y pour dépasser la limite
+// de 65535 par dimension. Côté shader, l'indice linéaire est  x + y * gl_NumWorkGroups.x  et les
+// workgroups au-delà de groups doivent sortir immédiatement.
+void DispatchCompute1D(GLuint groups);
@@ -0,0 +1,149 @@
+#include "CosmoIC.h"
+#include "FFT.h"
+#include "Parallel.h"
+#include "Philox.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+// Bardeen, Bond, Kaiser & Szalay (1986), k en h/Mpc
+double TransferBBKS(double k, double shapeGamma) {
+    double q = k / shapeGamma;
+    if (q < 1e-8) return 1.0;
+    double poly = 1.0 + 3.89 * q + std::pow(16.1 * q, 2.0) + std::pow(5.46 * q, 3.0) + std::pow(6.71 * q, 4.0);
+    return std::log(1.0 + 2.34 * q) / (2.34 * q) * std::pow(poly, -0.25);
+}
+
+double ShapeSpectrum(double k, const CosmologyParams& p) {
+    double t = TransferBBKS(k, p.shapeGamma);
+    return std::pow(k, (double)p.spectralIndex) * t * t;
+}
+
+// Variance du contraste lissé par une sphère de rayon R (Mpc/h), spectre non normalisé
+double SmoothedVariance(const CosmologyParams& p, double R) {
+    const int steps = 4000;
+    const double lnMin = std::log(1e-5), lnMax = std::log(1e3);
+    const double h = (lnMax - lnMin) / steps;
+    double sum = 0.0;
+    for (int s = 0; s <= steps; s++) {
+        double k = std::exp(lnMin + s * h);
+        double x = k * R;
+        double w = x < 1e-4 ? 1.0 : 3.0 * (std::sin(x) - x * std::cos(x)) / (x * x * x);
+        double f = k * k * k * ShapeSpectrum(k, p) * w * w;
+        sum += (s == 0 || s == steps) ? 0.5 * f : f;
+    }
+    return sum * h / (2.0 * PI * PI);
+}
+
+} // namespace
+
+size_t CosmologyParticleCount(const CosmologyParams& params) {
+    size_t n = (size_t)params.gridSize;
+    return n * n * n;
+}
+
+void GenerateCosmologicalBox(const CosmologyParams& p, uint32_t seed,
+                             glm::vec4* positions, glm::vec4* velocities, size_t count) {
+    const int n = p.gridSize;
+    const size_t N = (size_t)n;
+    const size_t cells = N * N * N;
+    const size_t produced = std::min(count, cells);
+    FFT3D fft(n);
+
+    // 1. Bruit blanc gaussien (Box-Muller sur Philox, compteur = index de cellule) puis passage en Fourier.
+    // Partir d'un champ réel garantit la symétrie hermitienne de delta_k sans la construire à la main.
+    std::vector<Complex> delta(cells);
+    ParallelFor(0, cells, 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            PhiloxStream rng = { seed, (uint32_t)i };
+            float u[4];
+            rng.Uniform4(0, u);
+            float g = std::sqrt(-2.0f * std::log(1.0f - u[0])) * std::cos(2.0f * (float)PI * u[1]);
+            delta[i] = Complex(g, 0.0f);
+        }
+    });
+    fft.Forward(delta.data());
+
+    // 2. delta_k = W_k * sqrt(P(k) / V) / sqrt(N³)   (<|W_k|²> = N³ pour la FFT non normalisée)
+    const double growth = 1.0 / (1.0 + p.redshift);
+    const double amplitude = p.sigma8 * p.sigma8 * growth * growth / SmoothedVariance(p, 8.0);
+    const double volume = (double)p.boxMpc * p.boxMpc * p.boxMpc;
+    const double kFund = 2.0 * PI / p.boxMpc;
+    auto waveVector = [&](size_t i, double& kx, double& ky, double& kz) {
+        const int mx = fft.Frequency((int)(i % N));
+        const int my = fft.Frequency((int)((i / N) % N));
+        const int mz = fft.Frequency((int)(i / (N * N)));
+        kx = kFund * mx; ky = kFund * my; kz = kFund * mz;
+        // Mode moyen et plans de Nyquist à zéro : leur partie imaginaire n'a pas de sens pour un champ réel
+        return !(mx == 0 && my == 0 && mz == 0) && std::abs(mx) != n / 2 && std::abs(my) != n / 2 && std::abs(mz) != n / 2;
+    };
+    // P ne dépend que de |m|² (entier) : table plutôt que pow/log par cellule
+    std::vector<float> filter(3 * (n / 2) * (n / 2) + 1, 0.0f);
+    for (size_t m2 = 1; m2 < filter.size(); m2++) {
+        double k = kFund * std::sqrt((double)m2);
+        filter[m2] = (float)std::sqrt(amplitude * ShapeSpectrum(k, p) / (volume * (double)cells));
+    }
+    ParallelFor(0, cells, 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            double kx, ky, kz;
+            if (!waveVector(i, kx, ky, kz)) { delta[i] = Complex(0.0f, 0.0f); continue; }
+            size_t m2 = (size_t)std::lround((kx * kx + ky * ky + kz * kz) / (kFund * kFund));
+            delta[i] *= filter[m2];
+        }
+    });
+
+    // 3. Déplacements psi_k = i k / k² delta_k. psi_x et psi_y sont réels : une seule FFT inverse
+    // de psi_x + i psi_y donne psi_x en partie réelle et psi_y en partie imaginaire.
+    const float toSim = p.boxSize / p.boxMpc;   // Mpc/h -> unités de simulation
+    const float rho = (float)((double)cells * p.particleMass / ((double)p.boxSize * p.boxSize * p.boxSize));
+    const float velocity = p.velocityScale * std::sqrt(4.0f * (float)PI * rho);
+
+    std::vector<Complex> work(cells);
+    for (int pass = 0; pass < 2; pass++) {
+        ParallelFor(0, cells, 16384, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                double kx, ky, kz;
+                waveVector(i, kx, ky, kz);
+                double k2 = kx * kx + ky * ky + kz * kz;
+                if (k2 == 0.0) { work[i] = Complex(0.0f, 0.0f); continue; }
+                const Complex d = delta[i];
+                const Complex id(-d.imag(), d.real());           // i * delta_k
+                if (pass == 0) {
+                    const Complex cx = id * (float)(kx / k2);
+                    const Complex cy = id * (float)(ky / k2);
+                    work[i] = Complex(cx.real() - cy.imag(), cx.imag() + cy.real()); // cx + i cy
+                } else {
+                    work[i] = id * (float)(kz / k2);
+                }
+            }
+        });
+        fft.Inverse(work.data());
+
+        ParallelFor(0, produced, 16384, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                if (pass == 0) {
+                    const glm::vec2 psi(work[i].real() * toSim, work[i].imag() * toSim);
+                    const float qx = ((float)(i % N) + 0.5f) / (float)N - 0.5f;
+                    const float qy = ((float)((i / N) % N) + 0.5f) / (float)N - 0.5f;
+                    positions[i] = glm::vec4(qx * p.boxSize + psi.x, qy * p.boxSize + psi.y, 0.0f, p.particleMass);
+                    velocities[i] = glm::vec4(psi * velocity, 0.0f, 0.0f);
+                } else {
+                    const float psiZ = work[i].real() * toSim;
+                    const float qz = ((float)(i / (N * N)) + 0.5f) / (float)N - 0.5f;
+                    positions[i].z = qz * p.boxSize + psiZ;
+                    velocities[i].z = psiZ * velocity;
+                }
+            }
+        });
+    }
+
+    for (size_t i = produced; i < count; i++) {
+        positions[i] = glm::vec4(0.0f);
+        velocities[i] = glm::vec4(0.0f);
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+
+// --- Conditions initiales cosmologiques (approximation de Zel'dovich) ---
+// Champ gaussien de spectre P(k) = A k^ns T(k)² (transfert BBKS), normalisé par sigma8 puis ramené
+// au redshift initial par le facteur de croissance d'Einstein-de Sitter D = 1 / (1 + z).
+// Les particules partent d'un réseau gridSize³ et sont déplacées de psi, avec div(psi) = -delta.
+// La boîte de simulation n'est pas en expansion : la vitesse est celle du mode croissant
+// d'un milieu homogène statique, v = psi * sqrt(4 pi G rho) (G = 1 comme dans GalaxyModels).
+// Le résultat dépend aussi de FFT.cpp : tout changement de sortie -> IC_GENERATOR_VERSION (main.cpp).
+
+struct CosmologyParams {
+    int gridSize = 64;              // Particules par côté (puissance de 2), soit gridSize³ particules
+    float boxSize = 2400.0f;        // Côté de la boîte en unités de simulation (centrée sur l'origine)
+    float boxMpc = 100.0f;          // Côté de la boîte en Mpc/h (fixe les échelles du spectre)
+    float sigma8 = 0.8f;            // Normalisation à z = 0
+    float redshift = 30.0f;         // Redshift des conditions initiales
+    float spectralIndex = 0.96f;    // ns
+    float shapeGamma = 0.21f;       // Γ = Ωm h (BBKS)
+    float particleMass = 1.0f;      // pos.w
+    float velocityScale = 1.0f;     // Multiplie la vitesse du mode croissant
+};
+
+// Nombre de particules produites par le générateur
+size_t CosmologyParticleCount(const CosmologyParams& params);
+
+// Remplit count particules : le réseau complet si count = gridSize³, sinon tronqué
+// (les particules en trop restent au centre avec une masse nulle).
+// Déterministe pour une seed donnée, quel que soit le nombre de threads.
+void GenerateCosmologicalBox(const CosmologyParams& params, uint32_t seed,
+                             glm::vec4* positions, glm::vec4* velocities, size_t count);
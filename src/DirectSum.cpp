@@ -0,0 +1,78 @@
+#include "DirectSum.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+const int BLOCK = FORCE_BLOCK;         // Cibles par bloc
+const size_t BLOCKS_PER_TASK = 16;     // 256 cibles par tâche réutilisent chaque tuile
+
+} // namespace
+
+SimdLevel DirectSumSolver::DetectLevel() {
+    return DetectSimdLevel();
+}
+
+const char* DirectSumSolver::LevelName(SimdLevel value) {
+    return SimdLevelName(value);
+}
+
+void DirectSumSolver::SetLevel(SimdLevel value) {
+    level = std::min(value, DetectLevel());
+}
+
+void DirectSumSolver::ComputeAccelerations(const float* positions, size_t count, float G, float softening,
+                                           float* accelerations) {
+    ComputeTargets(positions, count, nullptr, count, G, softening, accelerations);
+}
+
+// targets == nullptr : toutes les particules, dans l'ordre
+void DirectSumSolver::ComputeTargets(const float* positions, size_t count, const uint32_t* targets,
+                                     size_t targetCount, float G, float softening, float* accelerations) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    // Sources SoA ; masses nulles en bourrage (adoucissement > 0 : pas de 0 / 0)
+    const size_t sourceCount = (count + BLOCK - 1) / BLOCK * BLOCK;
+    sx.assign(sourceCount, 0.0f); sy.assign(sourceCount, 0.0f); sz.assign(sourceCount, 0.0f); sm.assign(sourceCount, 0.0f);
+    for (size_t i = 0; i < count; i++) {
+        sx[i] = positions[4 * i]; sy[i] = positions[4 * i + 1]; sz[i] = positions[4 * i + 2]; sm[i] = positions[4 * i + 3];
+    }
+    const size_t blockCount = (targetCount + BLOCK - 1) / BLOCK;
+    tx.resize(blockCount * BLOCK); ty.resize(blockCount * BLOCK); tz.resize(blockCount * BLOCK);
+    for (size_t t = 0; t < blockCount * BLOCK; t++) {
+        const size_t i = targets ? targets[std::min(t, targetCount - 1)] : std::min(t, count - 1);
+        tx[t] = positions[4 * i]; ty[t] = positions[4 * i + 1]; tz[t] = positions[4 * i + 2];
+    }
+    ax.assign(blockCount * BLOCK, 0.0); ay.assign(blockCount * BLOCK, 0.0); az.assign(blockCount * BLOCK, 0.0);
+
+    const ForceKernel kernel = SelectForceKernel(FACTOR_NONE, level);
+    ForceParams params;
+    params.eps2 = softening * softening;
+
+    // Tâche = BLOCKS_PER_TASK blocs de cibles ; pour chaque tuile de sources, tous les blocs de la tâche
+    ParallelFor(0, blockCount, BLOCKS_PER_TASK, [&](size_t begin, size_t end) {
+        for (size_t tile = 0; tile < sourceCount; tile += SOURCE_TILE) {
+            const size_t tileSize = std::min<size_t>(SOURCE_TILE, sourceCount - tile);
+            for (size_t b = begin; b < end; b++) {
+                float fx[BLOCK] = {}, fy[BLOCK] = {}, fz[BLOCK] = {};
+                const size_t t = b * BLOCK;
+                kernel(sx.data() + tile, sy.data() + tile, sz.data() + tile, sm.data() + tile, tileSize,
+                       tx.data() + t, ty.data() + t, tz.data() + t, params, fx, fy, fz);
+                for (int p = 0; p < BLOCK; p++) { ax[t + p] += fx[p]; ay[t + p] += fy[p]; az[t + p] += fz[p]; }
+            }
+        }
+    });
+
+    for (size_t t = 0; t < targetCount; t++) {
+        float* a = accelerations + 4 * t;
+        a[0] = (float)(G * ax[t]); a[1] = (float)(G * ay[t]); a[2] = (float)(G * az[t]); a[3] = 0.0f;
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    stats.ms = std::chrono::duration<float, std::milli>(t1 - t0).count();
+    stats.interactions = (double)targetCount * (double)count;
+    stats.interactionsPerSecond = stats.ms > 0.0f ? stats.interactions / (stats.ms * 1e-3) : 0.0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "ForceKernel.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --- Somme directe O(N²) (CPU) ---
+// Force exacte au float près, même adoucissement de Plummer que BarnesHutSolver : référence pour
+// mesurer l'erreur des autres solveurs, et solveur exact le plus rapide jusqu'à ~100k particules.
+// Noyau de ForceKernel.h (générique, AVX2 + FMA ou AVX-512, choisi à l'exécution ou imposé par SetLevel).
+// Tuiles de SOURCE_TILE sources en SoA (64 Ko, restent en cache) parcourues par tous les blocs de
+// 16 cibles d'une tâche ; sommes partielles de chaque tuile cumulées en double.
+
+struct DirectSumStats {
+    float ms = 0.0f;
+    double interactions = 0.0;
+    double interactionsPerSecond = 0.0;
+};
+
+class DirectSumSolver {
+public:
+    static const int SOURCE_TILE = 4096;
+
+    static SimdLevel DetectLevel();             // Meilleur jeu d'instructions du processeur
+    static const char* LevelName(SimdLevel level);
+
+    void SetLevel(SimdLevel value);             // Plafonné à DetectLevel()
+    SimdLevel Level() const { return level; }
+
+    // positions : count x (x, y, z, masse) ; accelerations : count x (ax, ay, az, 0), ordre d'origine.
+    void ComputeAccelerations(const float* positions, size_t count, float G, float softening, float* accelerations);
+
+    // Seulement les cibles targets[0..targetCount) (toutes les particules restent sources) :
+    // accelerations : targetCount x (ax, ay, az, 0), dans l'ordre de targets.
+    void ComputeTargets(const float* positions, size_t count, const uint32_t* targets, size_t targetCount, float G,
+                        float softening, float* accelerations);
+
+    const DirectSumStats& Stats() const { return stats; }
+
+private:
+    SimdLevel level = DetectLevel();
+
+    std::vector<float> sx, sy, sz, sm;          // Sources, complétées par des masses nulles
+    std::vector<float> tx, ty, tz;              // Cibles, complétées jusqu'à un multiple de 16
+    std::vector<double> ax, ay, az;
+
+    DirectSumStats stats;
+};
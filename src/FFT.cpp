@@ -0,0 +1,221 @@
+#include "FFT.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int LINE_BATCH = 16; // Lignes y / z traitées ensemble (x contigus -> lectures par blocs de 128 octets)
+
+inline Complex Multiply(Complex a, Complex b) {
+    return Complex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+} // namespace
+
+void FFT3D::LinePlan::Init(int size) {
+    length = size;
+    int bits = 0;
+    while ((1 << bits) < length) bits++;
+
+    bitReverse.resize(length);
+    for (int i = 0; i < length; i++) {
+        int r = 0;
+        for (int b = 0; b < bits; b++) r |= ((i >> b) & 1) << (bits - 1 - b);
+        bitReverse[i] = r;
+    }
+
+    twiddles.resize(std::max(1, length / 2));
+    for (int j = 0; j < length / 2; j++) {
+        double angle = -2.0 * 3.14159265358979323846 * j / length;
+        twiddles[j] = Complex((float)std::cos(angle), (float)std::sin(angle));
+    }
+}
+
+// Cooley-Tukey itératif en place. Produit complexe écrit à la main : std::complex passe
+// par __mulsc3 (gestion des NaN/inf) sans -ffast-math, ce qui coûte cher ici.
+void FFT3D::LinePlan::Run(Complex* line, bool inverse) const {
+    for (int i = 0; i < length; i++) {
+        int j = bitReverse[i];
+        if (i < j) std::swap(line[i], line[j]);
+    }
+
+    float* v = reinterpret_cast<float*>(line);
+    const float sign = inverse ? -1.0f : 1.0f;
+    for (int halfSize = 1, stride = length / 2; halfSize < length; halfSize *= 2, stride /= 2) {
+        for (int start = 0; start < length; start += 2 * halfSize) {
+            for (int k = 0; k < halfSize; k++) {
+                const Complex w = twiddles[k * stride];
+                const float wr = w.real(), wi = sign * w.imag();
+                float* a = v + 2 * (start + k);
+                float* b = v + 2 * (start + k + halfSize);
+                float tr = b[0] * wr - b[1] * wi;
+                float ti = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - tr; b[1] = a[1] - ti;
+                a[0] += tr;       a[1] += ti;
+            }
+        }
+    }
+}
+
+FFT3D::FFT3D(int size) : n(size) {
+    full.Init(n);
+    half.Init(std::max(1, n / 2));
+
+    realTwiddles.resize(n / 2 + 1);
+    for (int k = 0; k <= n / 2; k++) {
+        double angle = -2.0 * 3.14159265358979323846 * k / n;
+        realTwiddles[k] = Complex((float)std::cos(angle), (float)std::sin(angle));
+    }
+}
+
+void FFT3D::Forward(Complex* data) const {
+    Transform(data, false);
+}
+
+void FFT3D::Inverse(Complex* data) const {
+    Transform(data, true);
+}
+
+void FFT3D::Transform(Complex* data, bool inverse) const {
+    const size_t N = (size_t)n;
+
+    // Passe x : lignes contiguës
+    ParallelFor(0, N * N, 64, [&](size_t begin, size_t end) {
+        for (size_t line = begin; line < end; line++) full.Run(data + line * N, inverse);
+    });
+    TransformYZ(data, N, inverse);
+}
+
+// Passes y puis z sur des lignes de rowWidth éléments
+void FFT3D::TransformYZ(Complex* data, size_t rowWidth, bool inverse) const {
+    TransformAxis(data, rowWidth, 1, (size_t)n, inverse);
+    TransformAxis(data, rowWidth, 2, (size_t)n, inverse);
+}
+
+// Une passe y (axis = 1) ou z (axis = 2) sur les plans [0, planes) de l'autre axe : on copie jusqu'à
+// LINE_BATCH lignes voisines en x dans un tampon contigu, on les transforme, puis on les réécrit.
+void FFT3D::TransformAxis(Complex* data, size_t rowWidth, int axis, size_t planes, bool inverse) const {
+    const size_t N = (size_t)n;
+    const size_t batch = std::min<size_t>(LINE_BATCH, rowWidth);
+    const size_t blocksPerPlane = (rowWidth + batch - 1) / batch;
+    const size_t stride = axis == 1 ? rowWidth : rowWidth * N;      // Pas le long de l'axe transformé
+    const size_t outer = axis == 1 ? rowWidth * N : rowWidth;       // Pas de l'autre axe (z pour y, y pour z)
+
+    ParallelFor(0, planes * blocksPerPlane, 1, [&](size_t begin, size_t end) {
+        std::vector<Complex> scratch(batch * N);
+        for (size_t task = begin; task < end; task++) {
+            const size_t plane = task / blocksPerPlane;
+            const size_t x0 = (task % blocksPerPlane) * batch;
+            const size_t width = std::min(batch, rowWidth - x0);
+            Complex* base = data + plane * outer + x0;
+            for (size_t i = 0; i < N; i++)
+                for (size_t b = 0; b < width; b++) scratch[b * N + i] = base[i * stride + b];
+            for (size_t b = 0; b < width; b++) full.Run(scratch.data() + b * N, inverse);
+            for (size_t i = 0; i < N; i++)
+                for (size_t b = 0; b < width; b++) base[i * stride + b] = scratch[b * N + i];
+        }
+    });
+}
+
+// Ligne réelle x[0..n) vue comme n/2 complexes z[m] = x[2m] + i x[2m+1] : une FFT de longueur n/2,
+// puis séparation des parties paire E et impaire O : X[k] = E[k] + W^k O[k], W = exp(-2iπ/n).
+void FFT3D::RealLineForward(const float* x, Complex* X, Complex* z) const {
+    const int h = n / 2;
+    for (int m = 0; m < h; m++) z[m] = Complex(x[2 * m], x[2 * m + 1]);
+    half.Run(z, false);
+
+    for (int k = 0; k <= h; k++) {
+        const Complex a = z[k % h];
+        const Complex b = std::conj(z[(h - k) % h]);
+        const Complex even = (a + b) * 0.5f;
+        const Complex odd = Multiply(Complex(0.0f, -0.5f), a - b);  // (a - b) / 2i
+        X[k] = even + Multiply(realTwiddles[k], odd);
+    }
+}
+
+// Reconstruction de Z = 2E + 2i O puis FFT inverse de longueur n/2 : le facteur 2 compense
+// la longueur moitié, de sorte que l'aller-retour vaut n³ comme pour la version complexe.
+void FFT3D::RealLineInverse(const Complex* X, float* x, Complex* z) const {
+    const int h = n / 2;
+    for (int k = 0; k < h; k++) {
+        const Complex a = X[k];
+        const Complex b = std::conj(X[h - k]);
+        const Complex even = a + b;
+        const Complex odd = Multiply(a - b, std::conj(realTwiddles[k]));
+        z[k] = even + Complex(-odd.imag(), odd.real());      // even + i odd
+    }
+    half.Run(z, true);
+
+    for (int m = 0; m < h; m++) {
+        x[2 * m] = z[m].real();
+        x[2 * m + 1] = z[m].imag();
+    }
+}
+
+void FFT3D::ForwardReal(const float* in, Complex* out) const {
+    const size_t N = (size_t)n;
+    const size_t rowWidth = N / 2 + 1;
+
+    ParallelFor(0, N * N, 64, [&](size_t begin, size_t end) {
+        std::vector<Complex> z(n / 2);
+        for (size_t line = begin; line < end; line++) RealLineForward(in + line * N, out + line * rowWidth, z.data());
+    });
+    TransformYZ(out, rowWidth, false);
+}
+
+void FFT3D::InverseReal(Complex* in, float* out) const {
+    const size_t N = (size_t)n;
+    const size_t rowWidth = N / 2 + 1;
+
+    TransformYZ(in, rowWidth, true);
+    ParallelFor(0, N * N, 64, [&](size_t begin, size_t end) {
+        std::vector<Complex> z(n / 2);
+        for (size_t line = begin; line < end; line++) RealLineInverse(in + line * rowWidth, out + line * N, z.data());
+    });
+}
+
+// Lignes x : seules celles avec y et z < n/2 portent des données, les autres sont mises à zéro sans FFT.
+// Passe y : les plans z >= n/2 sont nuls avant comme après. Passe z : complète.
+void FFT3D::ForwardRealPadded(const float* in, Complex* out) const {
+    const size_t N = (size_t)n;
+    const size_t M = N / 2;
+    const size_t rowWidth = M + 1;
+
+    ParallelFor(0, N * N, 64, [&](size_t begin, size_t end) {
+        std::vector<float> x(N, 0.0f);                   // x >= n/2 : toujours nul
+        std::vector<Complex> z(M);
+        for (size_t line = begin; line < end; line++) {
+            Complex* X = out + line * rowWidth;
+            const size_t y = line % N, zz = line / N;
+            if (y >= M || zz >= M) {
+                std::fill(X, X + rowWidth, Complex(0.0f, 0.0f));
+                continue;
+            }
+            std::copy(in + (zz * M + y) * M, in + (zz * M + y + 1) * M, x.begin());
+            RealLineForward(x.data(), X, z.data());
+        }
+    });
+    TransformAxis(out, rowWidth, 1, M, false);
+    TransformAxis(out, rowWidth, 2, N, false);
+}
+
+// Ordre inverse de ForwardRealPadded : z complète, puis y et x sur le seul bloc de sortie
+void FFT3D::InverseRealCropped(Complex* in, float* out) const {
+    const size_t N = (size_t)n;
+    const size_t M = N / 2;
+    const size_t rowWidth = M + 1;
+
+    TransformAxis(in, rowWidth, 2, N, true);
+    TransformAxis(in, rowWidth, 1, M, true);
+    ParallelFor(0, M * M, 64, [&](size_t begin, size_t end) {
+        std::vector<float> x(N);
+        std::vector<Complex> z(M);
+        for (size_t line = begin; line < end; line++) {
+            const size_t y = line % M, zz = line / M;
+            RealLineInverse(in + (zz * N + y) * rowWidth, x.data(), z.data());
+            std::copy(x.begin(), x.begin() + M, out + line * M);
+        }
+    });
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+// --- FFT 3D complexe, radix-2, multithreadée ---
+// Grille cubique n³ (n puissance de 2), stockage x le plus rapide : index = (z * n + y) * n + x.
+// Les transformées ne sont pas normalisées : Inverse(Forward(f)) = n³ f.
+// Les passes y et z regroupent des lignes voisines en x pour rester dans le cache.
+// CosmoIC en dépend : un changement d'arrondi change les particules en cache (IC_GENERATOR_VERSION).
+
+typedef std::complex<float> Complex;
+
+class FFT3D {
+public:
+    explicit FFT3D(int n);
+
+    int Size() const { return n; }
+
+    void Forward(Complex* data) const;   // exp(-i k x)
+    void Inverse(Complex* data) const;   // exp(+i k x)
+
+    // Transformées d'un champ réel : n³ réels <-> demi-spectre (n/2 + 1) x n x n (x le plus rapide).
+    // Deux fois moins de calcul et de mémoire que la version complexe. InverseReal détruit son entrée.
+    // InverseReal(ForwardReal(f)) = n³ f.
+    size_t HalfSpectrumSize() const { return (size_t)(n / 2 + 1) * n * n; }
+    void ForwardReal(const float* in, Complex* out) const;
+    void InverseReal(Complex* in, float* out) const;
+
+    // Convolution isolée : champ réel (n/2)³ complété de zéros jusqu'à n³. ForwardRealPadded saute les
+    // lignes x (3/4) et les plans y (1/2) entièrement nuls ; InverseRealCropped ne reconstruit que le
+    // bloc (n/2)³ de départ, avec les mêmes économies dans l'autre sens. ~60 % du coût des versions pleines.
+    void ForwardRealPadded(const float* in, Complex* out) const;   // in : (n/2)³ réels
+    void InverseRealCropped(Complex* in, float* out) const;        // out : (n/2)³ réels
+
+    // Fréquence entière signée du mode m (0..n-1) : 0, 1, ..., n/2, -n/2 + 1, ..., -1
+    int Frequency(int m) const { return m <= n / 2 ? m : m - n; }
+
+private:
+    // FFT 1D en place d'une longueur donnée (tables précalculées)
+    struct LinePlan {
+        int length = 0;
+        std::vector<int> bitReverse;
+        std::vector<Complex> twiddles;   // exp(-2iπ j / length), j < length/2
+        void Init(int length);
+        void Run(Complex* line, bool inverse) const;
+    };
+
+    void Transform(Complex* data, bool inverse) const;
+    void TransformYZ(Complex* data, size_t rowWidth, bool inverse) const;
+    void TransformAxis(Complex* data, size_t rowWidth, int axis, size_t planes, bool inverse) const;
+    void RealLineForward(const float* x, Complex* X, Complex* z) const;   // z : n/2 complexes de travail
+    void RealLineInverse(const Complex* X, float* x, Complex* z) const;
+
+    int n;
+    LinePlan full;                       // Longueur n (transformées complexes)
+    LinePlan half;                       // Longueur n/2 (lignes réelles empaquetées deux par deux)
+    std::vector<Complex> realTwiddles;   // exp(-2iπ k / n), k <= n/2
+};
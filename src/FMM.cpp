@@ -0,0 +1,471 @@
+#include "FMM.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+const size_t TASK_MIN = 2048;      // Particules minimum par sous-arbre parallèle
+const int TASKS_PER_THREAD = 16;   // Découpage fin : le bulbe d'une galaxie ne doit pas former une seule tâche
+const uint32_t NO_TASK = 0xffffffffu;
+
+
+// --- Tables des multi-indices, générées à la compilation pour chaque ordre ---
+// Termes (i, j, k) triés par degré ; chaque terme de degré >= 1 est obtenu depuis "prev" en retirant 1
+// sur son premier axe non nul (monômes d^t / t! et récurrence des dérivées).
+// Les noyaux déroulent ces tables (fold expressions) : indices constants, accumulateurs en registres.
+
+struct Term { int e[3]; int degree, axis, prev, prev2, exponent; };
+struct Triple { int out, in, factor; };
+struct DerivativeStep { int out, up, up2, axis, coef; };    // R[out] = d_axis R[up] + coef R[up2]
+
+constexpr int TermCount(int p) { return (p + 1) * (p + 2) * (p + 3) / 6; }
+
+constexpr int TermIndex(int i, int j, int k) {
+    const int d = i + j + k, a = j + k;
+    return d * (d + 1) * (d + 2) / 6 + a * (a + 1) / 2 + (a - j);
+}
+
+template <int P>
+constexpr std::array<Term, TermCount(P)> MakeTerms() {
+    std::array<Term, TermCount(P)> terms{};
+    for (int d = 0; d <= P; d++) {
+        for (int i = d; i >= 0; i--) {
+            for (int j = d - i; j >= 0; j--) {
+                const int k = d - i - j;
+                Term& t = terms[TermIndex(i, j, k)];
+                t.e[0] = i; t.e[1] = j; t.e[2] = k;
+                t.degree = d;
+                t.prev = t.prev2 = -1;
+                if (d == 0) continue;
+                int r[3] = { i, j, k };
+                t.axis = i > 0 ? 0 : (j > 0 ? 1 : 2);
+                t.exponent = r[t.axis];
+                r[t.axis]--;
+                t.prev = TermIndex(r[0], r[1], r[2]);
+                if (r[t.axis] > 0) {
+                    r[t.axis]--;
+                    t.prev2 = TermIndex(r[0], r[1], r[2]);
+                }
+            }
+        }
+    }
+    return terms;
+}
+
+// Paires (entrée k, sortie n) d'un décalage : M2M si k <= n (composante par composante),
+// M2L / L2L si |n| + |k| <= p. Boucle externe sur l'entrée : sorties consécutives différentes.
+template <int P, bool Shift>
+constexpr int PairCount() {
+    constexpr std::array<Term, TermCount(P)> terms = MakeTerms<P>();
+    int count = 0;
+    for (int in = 0; in < TermCount(P); in++) {
+        for (int out = 0; out < TermCount(P); out++) {
+            const int* k = terms[in].e;
+            const int* n = terms[out].e;
+            if (Shift ? (k[0] <= n[0] && k[1] <= n[1] && k[2] <= n[2]) : terms[in].degree + terms[out].degree <= P)
+                count++;
+        }
+    }
+    return count;
+}
+
+template <int P>
+constexpr std::array<Triple, PairCount<P, true>()> MakeM2M() {       // M'[n] += M[k] d^(n-k) / (n-k)!
+    constexpr std::array<Term, TermCount(P)> terms = MakeTerms<P>();
+    std::array<Triple, PairCount<P, true>()> table{};
+    int c = 0;
+    for (int in = 0; in < TermCount(P); in++) {
+        for (int out = 0; out < TermCount(P); out++) {
+            const int* k = terms[in].e;
+            const int* n = terms[out].e;
+            if (k[0] <= n[0] && k[1] <= n[1] && k[2] <= n[2])
+                table[c++] = { out, in, TermIndex(n[0] - k[0], n[1] - k[1], n[2] - k[2]) };
+        }
+    }
+    return table;
+}
+
+template <int P, bool Local>
+constexpr std::array<Triple, PairCount<P, false>()> MakeM2L() {      // L[n] += M[k] D[n+k]
+    constexpr std::array<Term, TermCount(P)> terms = MakeTerms<P>();  // ou L'[n] += L[n+k] d^k / k!
+    std::array<Triple, PairCount<P, false>()> table{};
+    int c = 0;
+    for (int in = 0; in < TermCount(P); in++) {
+        for (int out = 0; out < TermCount(P); out++) {
+            const int* k = terms[in].e;
+            const int* n = terms[out].e;
+            if (terms[in].degree + terms[out].degree > P) continue;
+            const int sum = TermIndex(n[0] + k[0], n[1] + k[1], n[2] + k[2]);
+            table[c++] = Local ? Triple{ out, sum, in } : Triple{ out, in, sum };
+        }
+    }
+    return table;
+}
+
+template <int P>
+constexpr std::array<Triple, 3 * TermCount(P - 1)> MakeL2P() {     // g[axe] += L[n + e_axe] d^n / n!
+    constexpr std::array<Term, TermCount(P)> terms = MakeTerms<P>();
+    std::array<Triple, 3 * TermCount(P - 1)> table{};
+    int c = 0;
+    for (int t = 0; t < TermCount(P - 1); t++) {
+        for (int a = 0; a < 3; a++) {
+            int e[3] = { terms[t].e[0], terms[t].e[1], terms[t].e[2] };
+            e[a]++;
+            table[c++] = { a, TermIndex(e[0], e[1], e[2]), t };
+        }
+    }
+    return table;
+}
+
+constexpr int DerivativeCount(int p) {
+    int count = 0;
+    for (int d = 1; d <= p; d++) count += (TermCount(d) - TermCount(d - 1)) * (p - d + 1);
+    return count;
+}
+
+// Récurrence de McMurchie-Davidson : R(n)_t stocké en R[n * T + t], termes par degré croissant
+template <int P>
+constexpr std::array<DerivativeStep, DerivativeCount(P)> MakeDerivatives() {
+    constexpr std::array<Term, TermCount(P)> terms = MakeTerms<P>();
+    constexpr int T = TermCount(P);
+    std::array<DerivativeStep, DerivativeCount(P)> table{};
+    int c = 0;
+    for (int t = 1; t < T; t++) {
+        const Term& term = terms[t];
+        for (int n = 0; n <= P - term.degree; n++) {
+            const bool second = term.prev2 >= 0;
+            table[c++] = { n * T + t, (n + 1) * T + term.prev, second ? (n + 1) * T + term.prev2 : 0,
+                           term.axis, second ? term.exponent - 1 : 0 };
+        }
+    }
+    return table;
+}
+
+template <int P>
+struct Expansion {
+    static constexpr int T = TermCount(P);
+    static constexpr std::array<Term, T> terms = MakeTerms<P>();
+    static constexpr std::array<Triple, PairCount<P, true>()> m2m = MakeM2M<P>();
+    static constexpr std::array<Triple, PairCount<P, false>()> m2l = MakeM2L<P, false>();
+    static constexpr std::array<Triple, PairCount<P, false>()> l2l = MakeM2L<P, true>();
+    static constexpr std::array<Triple, 3 * TermCount(P - 1)> l2p = MakeL2P<P>();
+    static constexpr std::array<DerivativeStep, DerivativeCount(P)> derivatives = MakeDerivatives<P>();
+
+    // d^t / t! pour tous les termes
+    template <size_t... I>
+    static void Monomials(const double d[3], double* out, std::index_sequence<I...>) {
+        out[0] = 1.0;
+        ((out[I + 1] = out[terms[I + 1].prev] * d[terms[I + 1].axis] * (1.0 / terms[I + 1].exponent)), ...);
+    }
+    static void Monomials(double dx, double dy, double dz, double* out) {
+        const double d[3] = { dx, dy, dz };
+        Monomials(d, out, std::make_index_sequence<T - 1>());
+    }
+
+    // out[table.out] += in[table.in] * factor[table.factor]
+    template <const auto& Table, class In, class Out, size_t... I>
+    static void Contract(const In* in, const double* factor, Out* out, std::index_sequence<I...>) {
+        ((out[Table[I].out] += in[Table[I].in] * factor[Table[I].factor]), ...);
+    }
+    template <const auto& Table, class In, class Out>
+    static void Contract(const In* in, const double* factor, Out* out) {
+        Contract<Table>(in, factor, out, std::make_index_sequence<Table.size()>());
+    }
+
+    // Dérivées D^t g(d), g = 1 / sqrt(r² + ε²) :
+    //   R(n)_000 = f^(n)(s), s = r² / 2, f(s) = (2s + ε²)^(-1/2)
+    //   R(n)_{t + e_a} = t_a R(n+1)_{t - e_a} + d_a R(n+1)_t      et D^t g = R(0)_t
+    template <size_t... I>
+    static void Derivatives(const double d[3], double eps2, double* R, std::index_sequence<I...>) {
+        const double inv2 = 1.0 / (d[0] * d[0] + d[1] * d[1] + d[2] * d[2] + eps2);
+        double f = std::sqrt(inv2);
+        for (int n = 0; n <= P; n++) {
+            R[n * T] = f;
+            f *= -(2.0 * n + 1.0) * inv2;
+        }
+        ((R[derivatives[I].out] = d[derivatives[I].axis] * R[derivatives[I].up]
+                                + derivatives[I].coef * R[derivatives[I].up2]), ...);
+    }
+
+    // --- Noyaux (pointeurs rangés dans FMMSolver::Kernels) ---
+
+    // M[t] = somme m (z - x)^t / t! ; renvoie la distance maximale au centre
+    static float P2M(const float* x, const float* y, const float* z, const float* m, size_t count,
+                     const float center[3], float* M) {
+        double acc[T] = {}, mono[T];
+        double r2 = 0.0;
+        for (size_t j = 0; j < count; j++) {
+            const double dx = (double)center[0] - x[j], dy = (double)center[1] - y[j], dz = (double)center[2] - z[j];
+            Monomials(dx, dy, dz, mono);
+            for (int t = 0; t < T; t++) acc[t] += m[j] * mono[t];
+            r2 = std::max(r2, dx * dx + dy * dy + dz * dz);
+        }
+        for (int t = 0; t < T; t++) M[t] = (float)acc[t];
+        return (float)std::sqrt(r2);
+    }
+
+    // d = centre parent - centre enfant
+    static void M2M(const float* child, double dx, double dy, double dz, float* parent) {
+        double mono[T], acc[T] = {};
+        Monomials(dx, dy, dz, mono);
+        Contract<m2m>(child, mono, acc);
+        for (int t = 0; t < T; t++) parent[t] += (float)acc[t];
+    }
+
+    // d = centre cible - centre source
+    static void M2L(const float* M, double dx, double dy, double dz, double eps2, float* L) {
+        const double d[3] = { dx, dy, dz };
+        double R[(P + 1) * T], acc[T] = {};
+        Derivatives(d, eps2, R, std::make_index_sequence<derivatives.size()>());
+        Contract<m2l>(M, R, acc);
+        for (int t = 0; t < T; t++) L[t] += (float)acc[t];
+    }
+
+    // d = centre enfant - centre parent
+    static void L2L(const float* parent, double dx, double dy, double dz, float* child) {
+        double mono[T], acc[T] = {};
+        Monomials(dx, dy, dz, mono);
+        Contract<l2l>(parent, mono, acc);
+        for (int t = 0; t < T; t++) child[t] += (float)acc[t];
+    }
+
+    // grad(psi) en x, d = x - centre
+    static void L2P(const float* L, double dx, double dy, double dz, double g[3]) {
+        double mono[T];
+        Monomials(dx, dy, dz, mono);
+        Contract<l2p>(L, mono, g);
+    }
+};
+
+} // namespace
+
+struct FMMSolver::Kernels {
+    int terms;
+    uint64_t directMax;     // Paires de particules en dessous desquelles la somme directe bat un M2L
+    float (*p2m)(const float*, const float*, const float*, const float*, size_t, const float[3], float*);
+    void (*m2m)(const float*, double, double, double, float*);
+    void (*m2l)(const float*, double, double, double, double, float*);
+    void (*l2l)(const float*, double, double, double, float*);
+    void (*l2p)(const float*, double, double, double, double[3]);
+};
+
+namespace {
+
+template <int P>
+constexpr FMMSolver::Kernels MakeKernels() {
+    // M2L ~ 0.5 ns par terme de sa table, autant qu'une paire directe avec le noyau SIMD (~2 G paires/s)
+    return { Expansion<P>::T, Expansion<P>::m2l.size(), &Expansion<P>::P2M, &Expansion<P>::M2M, &Expansion<P>::M2L,
+             &Expansion<P>::L2L, &Expansion<P>::L2P };
+}
+
+const FMMSolver::Kernels KERNELS[FMMSolver::MAX_ORDER] = {
+    MakeKernels<1>(), MakeKernels<2>(), MakeKernels<3>(), MakeKernels<4>(), MakeKernels<5>(), MakeKernels<6>()
+};
+
+} // namespace
+
+// P2M / M2M et rayon de la cellule (distance maximale du centre de masse à ses particules)
+void FMMSolver::Upward(uint32_t i) {
+    const Octree::Node& n = tree.nodes[i];
+    Cell& cell = cells[i];
+    cell.x = n.comX; cell.y = n.comY; cell.z = n.comZ;
+    float* M = &multipoles[(size_t)i * termCount];
+    if (n.leaf) {
+        const float center[3] = { cell.x, cell.y, cell.z };
+        cell.radius = kernels->p2m(&tree.px[n.first], &tree.py[n.first], &tree.pz[n.first], &tree.pm[n.first],
+                                   n.count, center, M);
+        return;
+    }
+    std::fill(M, M + termCount, 0.0f);
+    float radius = 0.0f;
+    for (uint32_t c = i + 1; c < n.next; c = tree.nodes[c].next) {
+        const Cell& child = cells[c];
+        const double dx = (double)cell.x - child.x;
+        const double dy = (double)cell.y - child.y;
+        const double dz = (double)cell.z - child.z;
+        kernels->m2m(&multipoles[(size_t)c * termCount], dx, dy, dz, M);
+        radius = std::max(radius, (float)std::sqrt(dx * dx + dy * dy + dz * dz) + child.radius);
+    }
+    // Borne géométrique : coin de la cellule le plus éloigné du centre de masse
+    const float gx = n.comX - n.cx, gy = n.comY - n.cy, gz = n.comZ - n.cz;
+    cell.radius = std::min(radius, std::sqrt(gx * gx + gy * gy + gz * gz) + 0.8660254f * n.size);
+}
+
+// Parcours dual : n'écrit que dans le sous-arbre de a (développements locaux, paires du champ proche).
+// Cellules bien séparées -> M2L, sauf si la somme directe coûte moins cher (peu de particules).
+void FMMSolver::Interact(uint32_t a, uint32_t b, bool top, TaskContext& context) {
+    if (top && taskOf[a] != NO_TASK) {
+        pending[taskOf[a]].push_back(b);
+        return;
+    }
+    const Cell& A = cells[a];
+    const Cell& B = cells[b];
+    const Octree::Node& na = tree.nodes[a];
+    const Octree::Node& nb = tree.nodes[b];
+    const uint64_t pairs = (uint64_t)na.count * nb.count;
+    const float dx = A.x - B.x, dy = A.y - B.y, dz = A.z - B.z;
+    const float open = (A.radius + B.radius) * thetaInv;
+    if (pairs > kernels->directMax && dx * dx + dy * dy + dz * dz > open * open) {
+        kernels->m2l(&multipoles[(size_t)b * termCount], dx, dy, dz, eps2, &locals[(size_t)a * termCount]);
+        context.m2l++;
+    } else if (pairs <= kernels->directMax || (na.leaf && nb.leaf)) {
+        context.near.emplace_back(a, b);
+        context.direct += pairs;
+    } else if (nb.leaf || (!na.leaf && A.radius >= B.radius)) {
+        for (uint32_t c = a + 1; c < na.next; c = tree.nodes[c].next) Interact(c, b, top, context);
+    } else {
+        for (uint32_t c = b + 1; c < nb.next; c = tree.nodes[c].next) Interact(a, c, top, context);
+    }
+}
+
+// Champ proche d'une cellule cible : particules de toutes ses sources rassemblées en une liste SoA,
+// évaluée par le noyau SIMD de ForceKernel.h (le même que BarnesHutSolver)
+void FMMSolver::NearField(uint32_t a, const std::pair<uint32_t, uint32_t>* sources, size_t sourceCount,
+                          TaskContext& context) {
+    std::vector<float>& lx = context.lx;
+    std::vector<float>& ly = context.ly;
+    std::vector<float>& lz = context.lz;
+    std::vector<float>& lm = context.lm;
+    lx.clear(); ly.clear(); lz.clear(); lm.clear();
+    for (size_t s = 0; s < sourceCount; s++) {
+        const Octree::Node& n = tree.nodes[sources[s].second];
+        lx.insert(lx.end(), tree.px.begin() + n.first, tree.px.begin() + n.first + n.count);
+        ly.insert(ly.end(), tree.py.begin() + n.first, tree.py.begin() + n.first + n.count);
+        lz.insert(lz.end(), tree.pz.begin() + n.first, tree.pz.begin() + n.first + n.count);
+        lm.insert(lm.end(), tree.pm.begin() + n.first, tree.pm.begin() + n.first + n.count);
+    }
+
+    const Octree::Node& target = tree.nodes[a];
+    EvaluateTargets(nearKernel, tree.px.data(), tree.py.data(), tree.pz.data(), target.first,
+                    target.first + target.count, lx.data(), ly.data(), lz.data(), lm.data(), lx.size(), nearParams,
+                    [&](size_t i, float fx, float fy, float fz) { ax[i] += fx; ay[i] += fy; az[i] += fz; });
+}
+
+// L2L vers les enfants, L2P aux feuilles : a = G grad(psi), psi = somme L[n] (x - c)^n / n!
+void FMMSolver::Downward(uint32_t i) {
+    const Octree::Node& n = tree.nodes[i];
+    const Cell& cell = cells[i];
+    const float* L = &locals[(size_t)i * termCount];
+    if (n.leaf) {
+        for (uint32_t j = n.first; j < n.first + n.count; j++) {
+            double g[3] = { 0.0, 0.0, 0.0 };
+            kernels->l2p(L, (double)tree.px[j] - cell.x, (double)tree.py[j] - cell.y, (double)tree.pz[j] - cell.z, g);
+            ax[j] += (float)g[0]; ay[j] += (float)g[1]; az[j] += (float)g[2];
+        }
+        return;
+    }
+    for (uint32_t c = i + 1; c < n.next; c = tree.nodes[c].next) {
+        const Cell& child = cells[c];
+        kernels->l2l(L, (double)child.x - cell.x, (double)child.y - cell.y, (double)child.z - cell.z,
+                     &locals[(size_t)c * termCount]);
+    }
+}
+
+void FMMSolver::ComputeAccelerations(const float* positions, size_t count, float G, int orderValue,
+                                     float theta, float softening, float* accelerations) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    stats = FMMStats();
+    if (count == 0) return;
+    order = std::min(std::max(orderValue, 1), MAX_ORDER);
+    kernels = &KERNELS[order - 1];
+    termCount = kernels->terms;
+    thetaInv = 1.0f / std::min(std::max(theta, 0.1f), 1.0f);
+    eps2 = softening * softening;
+    nearKernel = SelectForceKernel(FACTOR_NONE, DetectSimdLevel());
+    nearParams.eps2 = eps2;
+
+    tree.Build(positions, count, LEAF_SIZE);
+    const std::vector<Octree::Node>& nodes = tree.nodes;
+    const uint32_t nodeCount = (uint32_t)nodes.size();
+
+    // Sous-arbres parallèles : plus hauts noeuds assez petits (ou feuilles) ; au-dessus, noeuds "haut"
+    // traités en série (quelques centaines au plus)
+    const size_t taskSize = std::max(TASK_MIN, count / ((size_t)ParallelThreadCount() * TASKS_PER_THREAD));
+    taskRoots.clear();
+    topNodes.clear();
+    taskOf.assign(nodeCount, NO_TASK);
+    for (uint32_t i = 0; i < nodeCount; ) {
+        if (nodes[i].leaf || nodes[i].count <= taskSize) {
+            taskOf[i] = (uint32_t)taskRoots.size();
+            taskRoots.push_back(i);
+            i = nodes[i].next;
+        } else {
+            topNodes.push_back(i);
+            i++;
+        }
+    }
+    pending.resize(taskRoots.size());
+    for (auto& p : pending) p.clear();
+    contexts.resize(taskRoots.size() + 1);
+    for (TaskContext& c : contexts) c.m2l = c.direct = 0;
+
+    cells.resize(nodeCount);
+    multipoles.resize((size_t)nodeCount * termCount);
+    locals.assign((size_t)nodeCount * termCount, 0.0f);
+    ax.assign(count, 0.0f); ay.assign(count, 0.0f); az.assign(count, 0.0f);
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    // 1. Montée : sous-arbres (ordre DFS inverse -> enfants avant parents), puis le haut de l'arbre
+    ParallelFor(0, taskRoots.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++)
+            for (uint32_t i = nodes[taskRoots[t]].next; i-- > taskRoots[t]; ) Upward(i);
+    });
+    TaskContext& topContext = contexts.back();
+    for (size_t k = topNodes.size(); k-- > 0; ) Upward(topNodes[k]);
+
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    // 2. Interactions : paires descendues en série jusqu'aux racines de tâches, puis une tâche par
+    // sous-arbre cible (aucune écriture partagée)
+    Interact(0, 0, true, topContext);
+    ParallelFor(0, taskRoots.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            TaskContext& context = contexts[t];
+            context.near.clear();
+            for (uint32_t b : pending[t]) Interact(taskRoots[t], b, false, context);
+
+            std::stable_sort(context.near.begin(), context.near.end(),
+                             [](const std::pair<uint32_t, uint32_t>& x, const std::pair<uint32_t, uint32_t>& y) {
+                                 return x.first < y.first;
+                             });
+            for (size_t s = 0; s < context.near.size(); ) {
+                size_t e = s + 1;
+                while (e < context.near.size() && context.near[e].first == context.near[s].first) e++;
+                NearField(context.near[s].first, &context.near[s], e - s, context);
+                s = e;
+            }
+        }
+    });
+
+    auto t3 = std::chrono::high_resolution_clock::now();
+
+    // 3. Descente : haut de l'arbre dans l'ordre DFS (parents avant enfants), puis les sous-arbres
+    for (uint32_t i : topNodes) Downward(i);
+    ParallelFor(0, taskRoots.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++)
+            for (uint32_t i = taskRoots[t]; i < nodes[taskRoots[t]].next; i++) Downward(i);
+    });
+    ParallelFor(0, count, 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            float* a = accelerations + 4 * (size_t)tree.order[i];
+            a[0] = G * ax[i]; a[1] = G * ay[i]; a[2] = G * az[i]; a[3] = 0.0f;
+        }
+    });
+
+    auto t4 = std::chrono::high_resolution_clock::now();
+    uint64_t m2l = 0, direct = 0;
+    for (const TaskContext& c : contexts) { m2l += c.m2l; direct += c.direct; }
+    stats.buildMs = std::chrono::duration<float, std::milli>(t1 - t0).count();
+    stats.upwardMs = std::chrono::duration<float, std::milli>(t2 - t1).count();
+    stats.interactMs = std::chrono::duration<float, std::milli>(t3 - t2).count();
+    stats.downwardMs = std::chrono::duration<float, std::milli>(t4 - t3).count();
+    stats.nodeCount = nodeCount;
+    stats.m2lPerCell = (double)m2l / (double)nodeCount;
+    stats.directPerParticle = (double)direct / (double)count;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "ForceKernel.h"
+#include "Octree.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --- Solveur FMM (Fast Multipole Method, CPU) ---
+// Même octree adaptatif que Barnes-Hut (Octree.h), feuilles plus grosses. Développements de Taylor
+// cartésiens d'ordre p (1..MAX_ORDER, termes de degré total <= p) autour du centre de masse des cellules :
+//   montée        P2M aux feuilles puis M2M vers la racine
+//   interactions  parcours dual cellule-cellule (Dehnen 2002) : cellules bien séparées
+//                 (|zA - zB| > (rA + rB) / θ) -> M2L ; sinon la plus grosse est ouverte. Deux feuilles
+//                 trop proches, ou deux cellules assez petites pour que la somme directe coûte moins
+//                 qu'un M2L, vont dans la liste de champ proche de la cible (somme directe, noyau SIMD
+//                 de ForceKernel.h).
+//   descente      L2L puis L2P aux feuilles
+// Parallélisme par tâches : l'arbre est coupé en sous-arbres de ~N / (16 x coeurs) particules. Montée,
+// interactions et descente traitent chaque sous-arbre dans une tâche ; seuls les quelques noeuds
+// au-dessus sont traités en série. Une tâche n'écrit que dans son sous-arbre cible : pas de verrou.
+// Coût O(N) : interactions par cellule indépendantes de N, fixées par θ et p. Débit mesuré (sphère de
+// Plummer, 200k particules, un coeur AVX-512, θ = 0.8) : ~0.3-0.4 M particules/s à p = 6, ~0.5-0.6 M à
+// p = 4. Au million de particules par défaut : ~0.8 s par pas sur 4 coeurs à p = 6, pas interactif.
+// Dérivées du noyau adouci 1/sqrt(r² + ε²) par la récurrence de McMurchie-Davidson (valable pour
+// toute fonction de r²) : le champ lointain reste cohérent avec le champ proche adouci.
+
+struct FMMStats {
+    float buildMs = 0.0f;       // Arbre
+    float upwardMs = 0.0f;      // P2M + M2M
+    float interactMs = 0.0f;    // M2L + champ proche
+    float downwardMs = 0.0f;    // L2L + L2P
+    size_t nodeCount = 0;
+    double m2lPerCell = 0.0;
+    double directPerParticle = 0.0;
+};
+
+class FMMSolver {
+public:
+    static const int MAX_ORDER = 6;
+    static const int LEAF_SIZE = 128;       // Champ proche en SIMD : grosses feuilles, moins de M2L
+
+    // positions : count x (x, y, z, masse) ; accelerations : count x (ax, ay, az, 0), ordre d'origine.
+    // Même adoucissement de Plummer que BarnesHutSolver.
+    void ComputeAccelerations(const float* positions, size_t count, float G, int order, float theta,
+                              float softening, float* accelerations);
+
+    const FMMStats& Stats() const { return stats; }
+
+    struct Kernels;     // Noyaux P2M / M2M / M2L / L2L / L2P d'un ordre donné (FMM.cpp)
+
+private:
+    struct Cell {
+        float x, y, z;      // Centre des développements (centre de masse)
+        float radius;       // Distance maximale du centre aux particules
+    };
+
+    // Etat d'une tâche : paires du champ proche, liste de sources, compteurs
+    struct TaskContext {
+        std::vector<std::pair<uint32_t, uint32_t>> near;    // (cellule cible, cellule source)
+        std::vector<float> lx, ly, lz, lm;
+        uint64_t m2l = 0, direct = 0;
+    };
+
+    void Upward(uint32_t i);
+    void Downward(uint32_t i);
+    void Interact(uint32_t a, uint32_t b, bool top, TaskContext& context);
+    void NearField(uint32_t a, const std::pair<uint32_t, uint32_t>* sources, size_t sourceCount,
+                   TaskContext& context);
+
+    // Paramètres du pas en cours
+    int order = 0;
+    int termCount = 0;          // (p + 1)(p + 2)(p + 3) / 6 coefficients par développement
+    const Kernels* kernels = nullptr;
+    float thetaInv = 2.0f;
+    float eps2 = 0.0f;
+    ForceKernel nearKernel = nullptr;           // Champ proche : somme directe SIMD
+    ForceParams nearParams;
+
+    Octree tree;
+    std::vector<Cell> cells;
+    std::vector<float> multipoles, locals;      // termCount coefficients par noeud
+    std::vector<float> ax, ay, az;              // Accélérations (ordre trié), sans G
+    std::vector<uint32_t> taskRoots;            // Sous-arbres traités en parallèle
+    std::vector<uint32_t> topNodes;             // Noeuds au-dessus, ordre DFS
+    std::vector<uint32_t> taskOf;               // Noeud -> tâche dont il est la racine
+    std::vector<std::vector<uint32_t>> pending; // Cellules sources en attente, par tâche
+    std::vector<TaskContext> contexts;          // Une par tâche + une pour le haut de l'arbre
+
+    FMMStats stats;
+};
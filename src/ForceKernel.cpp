@@ -0,0 +1,228 @@
+#include "ForceKernel.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define FORCE_KERNEL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#define TARGET_AVX512
+#else
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+#endif
+
+namespace {
+
+const int TERMS = FORCE_POLY_TERMS;
+
+template <int Factor>
+void KernelGeneric(const float* sx, const float* sy, const float* sz, const float* sm, size_t sourceCount,
+                   const float* tx, const float* ty, const float* tz, const ForceParams& params, float* ax,
+                   float* ay, float* az) {
+    const float eps2 = params.eps2, tScale = params.tScale, meshScale = params.meshScale;
+    float poly[TERMS] = {};
+    if (Factor != FACTOR_NONE) std::copy_n(params.poly, TERMS, poly);
+    float gx[FORCE_BLOCK], gy[FORCE_BLOCK], gz[FORCE_BLOCK];
+    float fx[FORCE_BLOCK] = {}, fy[FORCE_BLOCK] = {}, fz[FORCE_BLOCK] = {};
+    for (int p = 0; p < FORCE_BLOCK; p++) { gx[p] = tx[p]; gy[p] = ty[p]; gz[p] = tz[p]; }
+    for (size_t k = 0; k < sourceCount; k++) {
+        const float qx = sx[k], qy = sy[k], qz = sz[k], qm = sm[k];
+        for (int p = 0; p < FORCE_BLOCK; p++) {
+            const float dx = qx - gx[p], dy = qy - gy[p], dz = qz - gz[p];
+            const float d2 = dx * dx + dy * dy + dz * dz;
+            const float inv = 1.0f / std::sqrt(d2 + eps2);
+            float w = qm * inv * inv * inv;
+            if (Factor != FACTOR_NONE) {
+                // t borné à 1 : loin de rcut, le polynôme de degré 11 déborderait (inf x 0 = NaN).
+                // Coupure par un masque multiplicatif plutôt qu'une branche, la boucle reste vectorisée
+                const float t = std::min(std::sqrt(d2) * tScale - 1.0f, 1.0f);
+                float g = poly[TERMS - 1];
+                for (int c = TERMS - 2; c >= 0; c--) g = g * t + poly[c];
+                const float inside = t < 1.0f ? 1.0f : 0.0f;
+                if (Factor == FACTOR_CUTOFF) w *= g * inside;
+                else w = (w - qm * g * meshScale) * inside;
+            }
+            fx[p] += dx * w; fy[p] += dy * w; fz[p] += dz * w;
+        }
+    }
+    for (int p = 0; p < FORCE_BLOCK; p++) { ax[p] += fx[p]; ay[p] += fy[p]; az[p] += fz[p]; }
+}
+
+#ifdef FORCE_KERNEL_X86
+struct Constants256 {
+    __m256 e2, half, threeHalves, one, tScale, meshScale, poly[TERMS];
+};
+
+// Une source (qx, qy, qz, qm) sur 8 cibles (gx, gy, gz)
+template <int Factor>
+TARGET_AVX2 inline void Accumulate256(const __m256& qx, const __m256& qy, const __m256& qz, const __m256& qm,
+                                      const __m256& gx, const __m256& gy, const __m256& gz, const Constants256& c,
+                                      __m256& fx, __m256& fy, __m256& fz) {
+    const __m256 dx = _mm256_sub_ps(qx, gx), dy = _mm256_sub_ps(qy, gy), dz = _mm256_sub_ps(qz, gz);
+    const __m256 r2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_fmadd_ps(dz, dz, c.e2)));
+
+    // y = rsqrt(r²) puis Newton : y (3/2 - r²/2 y²)
+    __m256 y = _mm256_rsqrt_ps(r2);
+    y = _mm256_mul_ps(y, _mm256_fnmadd_ps(_mm256_mul_ps(_mm256_mul_ps(c.half, r2), y), y, c.threeHalves));
+    __m256 w = _mm256_mul_ps(_mm256_mul_ps(qm, y), _mm256_mul_ps(y, y));
+    if (Factor != FACTOR_NONE) {
+        const __m256 d2 = _mm256_max_ps(_mm256_sub_ps(r2, c.e2), _mm256_setzero_ps());
+        const __m256 t = _mm256_min_ps(_mm256_fmsub_ps(_mm256_sqrt_ps(d2), c.tScale, c.one), c.one);
+        __m256 g = c.poly[TERMS - 1];
+        for (int k = TERMS - 2; k >= 0; k--) g = _mm256_fmadd_ps(g, t, c.poly[k]);
+        const __m256 inside = _mm256_cmp_ps(t, c.one, _CMP_LT_OQ);
+        if (Factor == FACTOR_CUTOFF) w = _mm256_and_ps(_mm256_mul_ps(w, g), inside);
+        else w = _mm256_and_ps(_mm256_fnmadd_ps(_mm256_mul_ps(qm, g), c.meshScale, w), inside);
+    }
+    fx = _mm256_fmadd_ps(dx, w, fx); fy = _mm256_fmadd_ps(dy, w, fy); fz = _mm256_fmadd_ps(dz, w, fz);
+}
+
+template <int Factor>
+TARGET_AVX2
+void KernelAVX2(const float* sx, const float* sy, const float* sz, const float* sm, size_t sourceCount,
+                const float* tx, const float* ty, const float* tz, const ForceParams& params, float* ax, float* ay,
+                float* az) {
+    Constants256 c;
+    c.e2 = _mm256_set1_ps(params.eps2); c.half = _mm256_set1_ps(0.5f); c.threeHalves = _mm256_set1_ps(1.5f);
+    c.one = _mm256_set1_ps(1.0f); c.tScale = _mm256_set1_ps(params.tScale); c.meshScale = _mm256_set1_ps(params.meshScale);
+    for (int k = 0; k < TERMS; k++) c.poly[k] = _mm256_set1_ps(Factor != FACTOR_NONE ? params.poly[k] : 0.0f);
+
+    const __m256 gx0 = _mm256_loadu_ps(tx), gx1 = _mm256_loadu_ps(tx + 8);
+    const __m256 gy0 = _mm256_loadu_ps(ty), gy1 = _mm256_loadu_ps(ty + 8);
+    const __m256 gz0 = _mm256_loadu_ps(tz), gz1 = _mm256_loadu_ps(tz + 8);
+    __m256 fx0 = _mm256_setzero_ps(), fy0 = _mm256_setzero_ps(), fz0 = _mm256_setzero_ps();
+    __m256 fx1 = _mm256_setzero_ps(), fy1 = _mm256_setzero_ps(), fz1 = _mm256_setzero_ps();
+    for (size_t k = 0; k < sourceCount; k++) {
+        const __m256 qx = _mm256_broadcast_ss(sx + k), qy = _mm256_broadcast_ss(sy + k);
+        const __m256 qz = _mm256_broadcast_ss(sz + k), qm = _mm256_broadcast_ss(sm + k);
+        Accumulate256<Factor>(qx, qy, qz, qm, gx0, gy0, gz0, c, fx0, fy0, fz0);
+        Accumulate256<Factor>(qx, qy, qz, qm, gx1, gy1, gz1, c, fx1, fy1, fz1);
+    }
+    _mm256_storeu_ps(ax, _mm256_add_ps(_mm256_loadu_ps(ax), fx0));
+    _mm256_storeu_ps(ax + 8, _mm256_add_ps(_mm256_loadu_ps(ax + 8), fx1));
+    _mm256_storeu_ps(ay, _mm256_add_ps(_mm256_loadu_ps(ay), fy0));
+    _mm256_storeu_ps(ay + 8, _mm256_add_ps(_mm256_loadu_ps(ay + 8), fy1));
+    _mm256_storeu_ps(az, _mm256_add_ps(_mm256_loadu_ps(az), fz0));
+    _mm256_storeu_ps(az + 8, _mm256_add_ps(_mm256_loadu_ps(az + 8), fz1));
+}
+
+struct Constants512 {
+    __m512 e2, half, threeHalves, one, tScale, meshScale, poly[TERMS];
+};
+
+// Une source (qx, qy, qz, qm) sur les 16 cibles (gx, gy, gz)
+template <int Factor>
+TARGET_AVX512 inline void Accumulate512(const __m512& qx, const __m512& qy, const __m512& qz, const __m512& qm,
+                                        const __m512& gx, const __m512& gy, const __m512& gz, const Constants512& c,
+                                        __m512& fx, __m512& fy, __m512& fz) {
+    const __m512 dx = _mm512_sub_ps(qx, gx), dy = _mm512_sub_ps(qy, gy), dz = _mm512_sub_ps(qz, gz);
+    const __m512 r2 = _mm512_fmadd_ps(dx, dx, _mm512_fmadd_ps(dy, dy, _mm512_fmadd_ps(dz, dz, c.e2)));
+
+    __m512 y = _mm512_rsqrt14_ps(r2);
+    y = _mm512_mul_ps(y, _mm512_fnmadd_ps(_mm512_mul_ps(_mm512_mul_ps(c.half, r2), y), y, c.threeHalves));
+    __m512 w = _mm512_mul_ps(_mm512_mul_ps(qm, y), _mm512_mul_ps(y, y));
+    if (Factor != FACTOR_NONE) {
+        const __m512 d2 = _mm512_max_ps(_mm512_sub_ps(r2, c.e2), _mm512_setzero_ps());
+        const __m512 t = _mm512_min_ps(_mm512_fmsub_ps(_mm512_sqrt_ps(d2), c.tScale, c.one), c.one);
+        __m512 g = c.poly[TERMS - 1];
+        for (int k = TERMS - 2; k >= 0; k--) g = _mm512_fmadd_ps(g, t, c.poly[k]);
+        const __mmask16 inside = _mm512_cmp_ps_mask(t, c.one, _CMP_LT_OQ);
+        if (Factor == FACTOR_CUTOFF) w = _mm512_maskz_mul_ps(inside, w, g);
+        else w = _mm512_maskz_mov_ps(inside, _mm512_fnmadd_ps(_mm512_mul_ps(qm, g), c.meshScale, w));
+    }
+    fx = _mm512_fmadd_ps(dx, w, fx); fy = _mm512_fmadd_ps(dy, w, fy); fz = _mm512_fmadd_ps(dz, w, fz);
+}
+
+template <int Factor>
+TARGET_AVX512
+void KernelAVX512(const float* sx, const float* sy, const float* sz, const float* sm, size_t sourceCount,
+                  const float* tx, const float* ty, const float* tz, const ForceParams& params, float* ax,
+                  float* ay, float* az) {
+    Constants512 c;
+    c.e2 = _mm512_set1_ps(params.eps2); c.half = _mm512_set1_ps(0.5f); c.threeHalves = _mm512_set1_ps(1.5f);
+    c.one = _mm512_set1_ps(1.0f); c.tScale = _mm512_set1_ps(params.tScale); c.meshScale = _mm512_set1_ps(params.meshScale);
+    for (int k = 0; k < TERMS; k++) c.poly[k] = _mm512_set1_ps(Factor != FACTOR_NONE ? params.poly[k] : 0.0f);
+
+    const __m512 gx = _mm512_loadu_ps(tx), gy = _mm512_loadu_ps(ty), gz = _mm512_loadu_ps(tz);
+    // Deux jeux d'accumulateurs (sources paires / impaires) : deux chaînes de dépendance indépendantes
+    __m512 fx0 = _mm512_setzero_ps(), fy0 = _mm512_setzero_ps(), fz0 = _mm512_setzero_ps();
+    __m512 fx1 = _mm512_setzero_ps(), fy1 = _mm512_setzero_ps(), fz1 = _mm512_setzero_ps();
+    size_t k = 0;
+    for (; k + 1 < sourceCount; k += 2) {
+        Accumulate512<Factor>(_mm512_set1_ps(sx[k]), _mm512_set1_ps(sy[k]), _mm512_set1_ps(sz[k]),
+                              _mm512_set1_ps(sm[k]), gx, gy, gz, c, fx0, fy0, fz0);
+        Accumulate512<Factor>(_mm512_set1_ps(sx[k + 1]), _mm512_set1_ps(sy[k + 1]), _mm512_set1_ps(sz[k + 1]),
+                              _mm512_set1_ps(sm[k + 1]), gx, gy, gz, c, fx1, fy1, fz1);
+    }
+    if (k < sourceCount)
+        Accumulate512<Factor>(_mm512_set1_ps(sx[k]), _mm512_set1_ps(sy[k]), _mm512_set1_ps(sz[k]),
+                              _mm512_set1_ps(sm[k]), gx, gy, gz, c, fx0, fy0, fz0);
+    _mm512_storeu_ps(ax, _mm512_add_ps(_mm512_loadu_ps(ax), _mm512_add_ps(fx0, fx1)));
+    _mm512_storeu_ps(ay, _mm512_add_ps(_mm512_loadu_ps(ay), _mm512_add_ps(fy0, fy1)));
+    _mm512_storeu_ps(az, _mm512_add_ps(_mm512_loadu_ps(az), _mm512_add_ps(fz0, fz1)));
+}
+#endif
+
+SimdLevel QueryCpu() {
+#ifdef FORCE_KERNEL_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return SIMD_GENERIC;
+    __cpuid(info, 1);
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave) return SIMD_GENERIC;
+    const unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    const bool avx2 = (info[1] & (1 << 5)) != 0;
+    const bool avx512 = (info[1] & (1 << 16)) != 0;
+    if (avx512 && (xcr0 & 0xE6) == 0xE6) return SIMD_AVX512;     // Registres ymm + zmm sauvegardés par l'OS
+    if (avx2 && fma && (xcr0 & 0x6) == 0x6) return SIMD_AVX2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SIMD_AVX2;
+#endif
+#endif
+    return SIMD_GENERIC;
+}
+
+template <int Factor>
+ForceKernel SelectLevel(SimdLevel level) {
+#ifdef FORCE_KERNEL_X86
+    if (level == SIMD_AVX512) return KernelAVX512<Factor>;
+    if (level == SIMD_AVX2) return KernelAVX2<Factor>;
+#endif
+    (void)level;
+    return KernelGeneric<Factor>;
+}
+
+} // namespace
+
+SimdLevel DetectSimdLevel() {
+    static const SimdLevel detected = QueryCpu();
+    return detected;
+}
+
+const char* SimdLevelName(SimdLevel value) {
+    switch (value) {
+    case SIMD_AVX512: return "AVX-512";
+    case SIMD_AVX2: return "AVX2 + FMA";
+    default: return "Generique";
+    }
+}
+
+ForceKernel SelectForceKernel(ForceFactor factor, SimdLevel level) {
+    level = std::min(level, DetectSimdLevel());
+    switch (factor) {
+    case FACTOR_CUTOFF: return SelectLevel<FACTOR_CUTOFF>(level);
+    case FACTOR_P3M: return SelectLevel<FACTOR_P3M>(level);
+    default: return SelectLevel<FACTOR_NONE>(level);
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+
+// --- Noyau de forces adoucies liste -> cibles (CPU) ---
+// Boucle interne commune à DirectSumSolver, BarnesHutSolver (listes d'interactions), FMMSolver (champ
+// proche) et P3MCorrection : sources (X, Y, Z, M) en SoA contre un bloc de FORCE_BLOCK cibles,
+// adoucissement de Plummer  w = m / (r² + ε²)^(3/2), force d w. Facteur radial en paramètre de template :
+//   FACTOR_NONE     w
+//   FACTOR_CUTOFF   w g(t)                                 TreePM (courte portée), nul pour r >= rcut
+//   FACTOR_P3M      m [ (r² + ε²)^(-3/2) - q(t) meshScale ]  correction P3M, nulle pour r >= rcut
+// g et q : FORCE_POLY_TERMS monômes de t = 2 r / rcut - 1 (Chebyshev.h), t borné à 1.
+// Noyaux générique (boucle vectorisée par le compilateur), AVX2 + FMA et AVX-512 (rsqrt + une
+// itération de Newton : erreur relative ~1e-7), choisis à l'exécution selon le processeur.
+
+enum SimdLevel {
+    SIMD_GENERIC = 0,
+    SIMD_AVX2 = 1,
+    SIMD_AVX512 = 2
+};
+
+SimdLevel DetectSimdLevel();                    // Meilleur jeu d'instructions du processeur
+const char* SimdLevelName(SimdLevel level);
+
+enum ForceFactor {
+    FACTOR_NONE = 0,
+    FACTOR_CUTOFF = 1,
+    FACTOR_P3M = 2
+};
+
+const int FORCE_BLOCK = 16;                     // Cibles par bloc (un registre AVX-512, deux AVX2)
+const int FORCE_POLY_TERMS = 12;
+
+struct ForceParams {
+    float eps2 = 0.0f;
+    float tScale = 0.0f;                        // 2 / rcut
+    float meshScale = 0.0f;                     // P3M : 1 / h³
+    const float* poly = nullptr;                // FORCE_POLY_TERMS coefficients (sauf FACTOR_NONE)
+};
+
+// Ajoute à (ax, ay, az)[0..FORCE_BLOCK) les forces (sans G) des sources [0, sourceCount) sur les
+// cibles (tx, ty, tz)[0..FORCE_BLOCK). sourceCount quelconque.
+typedef void (*ForceKernel)(const float* sx, const float* sy, const float* sz, const float* sm, size_t sourceCount,
+                            const float* tx, const float* ty, const float* tz, const ForceParams& params, float* ax,
+                            float* ay, float* az);
+
+ForceKernel SelectForceKernel(ForceFactor factor, SimdLevel level);
+
+// Cibles [first, last) de tableaux SoA (px, py, pz), par blocs de FORCE_BLOCK (le dernier complété par
+// sa dernière cible, résultats ignorés) contre une même liste : store(index, ax, ay, az) par cible.
+template <typename Store>
+void EvaluateTargets(ForceKernel kernel, const float* px, const float* py, const float* pz, size_t first, size_t last,
+                     const float* X, const float* Y, const float* Z, const float* M, size_t listSize,
+                     const ForceParams& params, Store store) {
+    for (size_t chunk = first; chunk < last; chunk += FORCE_BLOCK) {
+        const size_t width = last - chunk < (size_t)FORCE_BLOCK ? last - chunk : (size_t)FORCE_BLOCK;
+        float gx[FORCE_BLOCK], gy[FORCE_BLOCK], gz[FORCE_BLOCK];
+        float ax[FORCE_BLOCK] = {}, ay[FORCE_BLOCK] = {}, az[FORCE_BLOCK] = {};
+        for (size_t p = 0; p < (size_t)FORCE_BLOCK; p++) {
+            const size_t src = chunk + (p < width ? p : width - 1);
+            gx[p] = px[src]; gy[p] = py[src]; gz[p] = pz[src];
+        }
+        kernel(X, Y, Z, M, listSize, gx, gy, gz, params, ax, ay, az);
+        for (size_t p = 0; p < width; p++) store(chunk + p, ax[p], ay[p], az[p]);
+    }
+}
@@ -0,0 +1,201 @@
+#include "GPUPoisson.h"
+#include "ComputeShader.h"
+
+#include <string>
+
+namespace {
+
+// Masse (texture) -> SSBO complexe (partie imaginaire nulle)
+const char* loadCS = R"(
+layout (local_size_x = 8, local_size_y = 8) in;
+layout (std430, binding = 0) buffer Grid { vec2 data[]; };
+uniform sampler3D massTex;
+
+void main() {
+    ivec3 id = ivec3(gl_GlobalInvocationID.xy, gl_WorkGroupID.z);
+    uint index = (uint(id.z) * FFT_SIZE + uint(id.y)) * FFT_SIZE + uint(id.x);
+    data[index] = vec2(texelFetch(massTex, id, 0).r, 0.0);
+}
+)";
+
+// Une ligne de FFT_SIZE complexes par workgroup (dispatch n x n), Stockham en mémoire partagée.
+// Étape de taille Ns et radix R : lecture en j + r n/R, écriture en (j / Ns) Ns R + j % Ns + r Ns,
+// donc pas de permutation bit-reverse et des accès partagés sans conflit de réordonnancement.
+const char* fftCS = R"(
+layout (local_size_x = 64) in;
+layout (std430, binding = 0) buffer Grid { vec2 data[]; };
+uniform int axis;          // 0 : x, 1 : y, 2 : z
+uniform float direction;   // -1 : directe, +1 : inverse
+
+shared vec2 line[2 * FFT_SIZE];  // Deux moitiés : source / destination de l'étape
+
+const float PI = 3.14159265358979;
+
+vec2 cmul(vec2 a, vec2 b) { return vec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x); }
+
+void main() {
+    const uint N = uint(FFT_SIZE);
+    uint a = gl_WorkGroupID.x, b = gl_WorkGroupID.y;
+    uint base, stride;
+    if (axis == 0)      { base = (b * N + a) * N; stride = 1u; }
+    else if (axis == 1) { base = b * N * N + a;   stride = N; }
+    else                { base = b * N + a;       stride = N * N; }
+
+    for (uint i = gl_LocalInvocationID.x; i < N; i += 64u) line[i] = data[base + i * stride];
+    barrier();
+
+    uint src = 0u;
+    for (uint Ns = 1u; Ns < N; ) {
+        uint R = (Ns * 4u <= N) ? 4u : 2u;
+        uint dst = N - src;
+        for (uint j = gl_LocalInvocationID.x; j < N / R; j += 64u) {
+            uint k = j % Ns;
+            float angle = direction * 2.0 * PI * float(k) / float(Ns * R);
+            uint idxD = (j / Ns) * Ns * R + k;
+            if (R == 4u) {
+                vec2 v0 = line[src + j];
+                vec2 v1 = cmul(line[src + j + N / 4u],      vec2(cos(angle), sin(angle)));
+                vec2 v2 = cmul(line[src + j + N / 2u],      vec2(cos(2.0 * angle), sin(2.0 * angle)));
+                vec2 v3 = cmul(line[src + j + 3u * N / 4u], vec2(cos(3.0 * angle), sin(3.0 * angle)));
+                vec2 a0 = v0 + v2, a1 = v0 - v2;
+                vec2 a2 = v1 + v3, d = v1 - v3;
+                vec2 a3 = direction * vec2(-d.y, d.x);   // ±i (v1 - v3)
+                line[dst + idxD]           = a0 + a2;
+                line[dst + idxD + Ns]      = a1 + a3;
+                line[dst + idxD + 2u * Ns] = a0 - a2;
+                line[dst + idxD + 3u * Ns] = a1 - a3;
+            } else {
+                vec2 v0 = line[src + j];
+                vec2 v1 = cmul(line[src + j + N / 2u], vec2(cos(angle), sin(angle)));
+                line[dst + idxD]      = v0 + v1;
+                line[dst + idxD + Ns] = v0 - v1;
+            }
+        }
+        barrier();
+        src = dst;
+        Ns *= R;
+    }
+
+    for (uint i = gl_LocalInvocationID.x; i < N; i += 64u) data[base + i * stride] = line[src + i];
+}
+)";
+
+// Φ_k = -πG M_k / (h Σ sin²(π m / n)) / n³   (normalisation de l'inverse incluse dans scale)
+const char* greenCS = R"(
+layout (local_size_x = 8, local_size_y = 8) in;
+layout (std430, binding = 0) buffer Grid { vec2 data[]; };
+uniform float scale;
+
+const float PI = 3.14159265358979;
+
+void main() {
+    const int N = FFT_SIZE;
+    ivec3 id = ivec3(gl_GlobalInvocationID.xy, gl_WorkGroupID.z);
+    uint index = (uint(id.z) * uint(N) + uint(id.y)) * uint(N) + uint(id.x);
+    ivec3 m = ivec3(lessThanEqual(id, ivec3(N / 2))) * id + ivec3(greaterThan(id, ivec3(N / 2))) * (id - N);
+    vec3 s = sin(PI * vec3(m) / float(N));
+    float sum = dot(s, s);
+    data[index] *= (sum > 0.0) ? -PI / sum * scale : 0.0;
+}
+)";
+
+const char* storeCS = R"(
+layout (local_size_x = 8, local_size_y = 8) in;
+layout (std430, binding = 0) buffer Grid { vec2 data[]; };
+layout (r32f, binding = 0) uniform writeonly image3D potential;
+
+void main() {
+    ivec3 id = ivec3(gl_GlobalInvocationID.xy, gl_WorkGroupID.z);
+    uint index = (uint(id.z) * FFT_SIZE + uint(id.y)) * FFT_SIZE + uint(id.x);
+    imageStore(potential, id, vec4(data[index].x, 0.0, 0.0, 0.0));
+}
+)";
+
+} // namespace
+
+bool GPUPoissonSolver::Supported() {
+    return GLAD_GL_VERSION_4_3 != 0;
+}
+
+bool GPUPoissonSolver::Init(int size) {
+    if (!Supported()) return false;
+    if (size == n && buffer != 0) return true;
+    Release();
+
+    // La taille de la mémoire partagée doit être une constante : la résolution est injectée à la compilation
+    const std::string defines = "#define FFT_SIZE " + std::to_string(size) + "\n";
+    loadProgram = CreateComputeProgram(loadCS, defines);
+    fftProgram = CreateComputeProgram(fftCS, defines);
+    greenProgram = CreateComputeProgram(greenCS, defines);
+    storeProgram = CreateComputeProgram(storeCS, defines);
+    if (!loadProgram || !fftProgram || !greenProgram || !storeProgram) {
+        Release();
+        return false;
+    }
+
+    const GLsizeiptr bytes = (GLsizeiptr)size * size * size * 2 * sizeof(float);
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, NULL, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    if (glGetError() == GL_OUT_OF_MEMORY) {
+        Release();
+        return false;
+    }
+    n = size;
+    return true;
+}
+
+void GPUPoissonSolver::Release() {
+    if (buffer) glDeleteBuffers(1, &buffer);
+    if (loadProgram) glDeleteProgram(loadProgram);
+    if (fftProgram) glDeleteProgram(fftProgram);
+    if (greenProgram) glDeleteProgram(greenProgram);
+    if (storeProgram) glDeleteProgram(storeProgram);
+    buffer = loadProgram = fftProgram = greenProgram = storeProgram = 0;
+    n = 0;
+}
+
+void GPUPoissonSolver::Transform(float direction) {
+    glUseProgram(fftProgram);
+    glUniform1f(glGetUniformLocation(fftProgram, "direction"), direction);
+    for (int axis = 0; axis < 3; axis++) {
+        glUniform1i(glGetUniformLocation(fftProgram, "axis"), axis);
+        glDispatchCompute(n, n, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+}
+
+void GPUPoissonSolver::Solve(GLuint massTex, GLuint potentialTex, float boxSize, float G) {
+    if (!buffer) return;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer);
+
+    // 1. Masse -> SSBO
+    glUseProgram(loadProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, massTex);
+    glUniform1i(glGetUniformLocation(loadProgram, "massTex"), 0);
+    glDispatchCompute(n / 8, n / 8, n);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // 2. FFT directe, Green, FFT inverse
+    Transform(-1.0f);
+    glUseProgram(greenProgram);
+    const float cellSize = boxSize / (float)n;
+    glUniform1f(glGetUniformLocation(greenProgram, "scale"), G / (cellSize * (float)n * (float)n * (float)n));
+    glDispatchCompute(n / 8, n / 8, n);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    Transform(1.0f);
+
+    // 3. Partie réelle -> texture du potentiel
+    glUseProgram(storeProgram);
+    glBindImageTexture(0, potentialTex, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R32F);
+    glDispatchCompute(n / 8, n / 8, n);
+    // Lue ensuite par physicsVS / meshFieldFS (fetch), et relue ou réécrite par glGetTexImage /
+    // glTexSubImage3D (auto-test, retour au solveur CPU) : mise à jour de texture
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+    glBindImageTexture(0, 0, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R32F);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <glad/glad.h>
+
+// --- Solveur de Poisson GPU (compute shaders, OpenGL 4.3) ---
+// Même problème que PMSolver (Poisson périodique, laplacien discret à 7 points) mais la grille
+// ne quitte jamais la VRAM : masse CIC (texture R32F) -> SSBO complexe -> FFT 3D -> Green -> FFT
+// inverse -> potentiel (imageStore dans la texture R32F lue par physicsVS).
+// FFT de Stockham radix-4 (+ une étape radix-2 si log2 n est impair), une ligne par workgroup,
+// entièrement en mémoire partagée : une seule lecture et une seule écriture globale par passe.
+
+class GPUPoissonSolver {
+public:
+    static bool Supported();   // Contexte 4.3 : compute shaders + SSBO
+
+    // Compile les shaders pour une grille n³ (n puissance de 2, 16 <= n <= 512) et alloue le SSBO
+    bool Init(int n);
+    void Release();
+    int Size() const { return n; }
+
+    // massTex, potentialTex : textures 3D R32F de taille n³. Synchronisé par glMemoryBarrier,
+    // le potentiel peut être échantillonné directement après l'appel.
+    void Solve(GLuint massTex, GLuint potentialTex, float boxSize, float G);
+
+private:
+    void Transform(float direction);
+
+    int n = 0;
+    GLuint buffer = 0;           // vec2 [n³]
+    GLuint loadProgram = 0;
+    GLuint fftProgram = 0;
+    GLuint greenProgram = 0;
+    GLuint storeProgram = 0;
+};
@@ -0,0 +1,568 @@
+#include "GPUTree.h"
+#include "ComputeShader.h"
+
+#include <algorithm>
+
+namespace {
+
+// Préfixe commun : indice linéaire du workgroup (dispatch réparti en x * y, cf. DispatchCompute1D)
+const char* commonCS = R"(
+uint GroupIndex() { return gl_WorkGroupID.x + gl_WorkGroupID.y * gl_NumWorkGroups.x; }
+
+// Les flottants encodés ainsi se comparent comme des entiers (atomicMin / atomicMax)
+uint EncodeFloat(float f) {
+    uint u = floatBitsToUint(f);
+    return (u & 0x80000000u) != 0u ? ~u : (u | 0x80000000u);
+}
+float DecodeFloat(uint u) {
+    return uintBitsToFloat((u & 0x80000000u) != 0u ? (u & 0x7FFFFFFFu) : ~u);
+}
+)";
+
+const char* boundsCS = R"(
+layout (local_size_x = 256) in;
+layout (std430, binding = 0) readonly buffer Positions { vec4 positions[]; };
+layout (std430, binding = 1) buffer Bounds { uint bounds[6]; };
+uniform uint count;
+
+shared vec3 sMin[256];
+shared vec3 sMax[256];
+
+void main() {
+    uint lid = gl_LocalInvocationIndex;
+    uint i = GroupIndex() * 256u + lid;
+    if (GroupIndex() * 256u >= count) return;
+
+    vec3 lo = vec3(1e30), hi = vec3(-1e30);
+    if (i < count) {
+        vec3 p = positions[i].xyz;
+        if (!any(isnan(p)) && !any(isinf(p))) { lo = p; hi = p; }
+    }
+    sMin[lid] = lo;
+    sMax[lid] = hi;
+    barrier();
+    for (uint s = 128u; s > 0u; s >>= 1u) {
+        if (lid < s) {
+            sMin[lid] = min(sMin[lid], sMin[lid + s]);
+            sMax[lid] = max(sMax[lid], sMax[lid + s]);
+        }
+        barrier();
+    }
+    if (lid == 0u) {
+        for (int a = 0; a < 3; a++) {
+            atomicMin(bounds[a], EncodeFloat(sMin[0][a]));
+            atomicMax(bounds[3 + a], EncodeFloat(sMax[0][a]));
+        }
+    }
+}
+)";
+
+// Clés de Morton 30 bits (10 bits par axe) dans le cube englobant
+const char* mortonCS = R"(
+layout (local_size_x = 256) in;
+layout (std430, binding = 0) readonly buffer Positions { vec4 positions[]; };
+layout (std430, binding = 1) readonly buffer Bounds { uint bounds[6]; };
+layout (std430, binding = 2) writeonly buffer Keys { uint keys[]; };
+layout (std430, binding = 3) writeonly buffer Values { uint values[]; };
+uniform uint count;
+
+uint SpreadBits(uint v) {
+    v &= 0x3FFu;
+    v = (v | (v << 16)) & 0x030000FFu;
+    v = (v | (v << 8))  & 0x0300F00Fu;
+    v = (v | (v << 4))  & 0x030C30C3u;
+    v = (v | (v << 2))  & 0x09249249u;
+    return v;
+}
+
+void main() {
+    uint i = GroupIndex() * 256u + gl_LocalInvocationIndex;
+    if (i >= count) return;
+
+    vec3 lo = vec3(DecodeFloat(bounds[0]), DecodeFloat(bounds[1]), DecodeFloat(bounds[2]));
+    vec3 hi = vec3(DecodeFloat(bounds[3]), DecodeFloat(bounds[4]), DecodeFloat(bounds[5]));
+    if (any(greaterThan(lo, hi))) { lo = vec3(0.0); hi = vec3(0.0); }
+    vec3 extent = hi - lo;
+    float size = max(max(extent.x, extent.y), extent.z) * 1.0001 + 1e-3;
+
+    vec3 p = positions[i].xyz;
+    vec3 q = (p - lo) * (1024.0 / size);
+    q = any(isnan(q)) ? vec3(0.0) : clamp(q, 0.0, 1023.0);
+    keys[i] = SpreadBits(uint(q.x)) | (SpreadBits(uint(q.y)) << 1) | (SpreadBits(uint(q.z)) << 2);
+    values[i] = i;
+}
+)";
+
+// Tri radix, passe 1 : histogramme des chiffres de 4 bits par bloc de 256 clés (disposition chiffre majeur)
+const char* histogramCS = R"(
+layout (local_size_x = 256) in;
+layout (std430, binding = 2) readonly buffer Keys { uint keys[]; };
+layout (std430, binding = 4) writeonly buffer Histogram { uint histogram[]; };
+uniform uint count;
+uniform uint shift;
+uniform uint blockCount;
+
+shared uint sCount[16];
+
+void main() {
+    uint block = GroupIndex();
+    if (block >= blockCount) return;
+    uint lid = gl_LocalInvocationIndex;
+    if (lid < 16u) sCount[lid] = 0u;
+    barrier();
+    uint i = block * 256u + lid;
+    if (i < count) atomicAdd(sCount[(keys[i] >> shift) & 15u], 1u);
+    barrier();
+    if (lid < 16u) histogram[lid * blockCount + block] = sCount[lid];
+}
+)";
+
+// Passe 2 : scan exclusif de tout l'histogramme (un seul workgroup, chaque thread une tranche contiguë)
+const char* scanCS = R"(
+layout (local_size_x = 256) in;
+layout (std430, binding = 4) buffer Histogram { uint histogram[]; };
+uniform uint total;
+
+shared uint sSum[256];
+
+void main() {
+    uint lid = gl_LocalInvocationIndex;
+    uint chunk = (total + 255u) / 256u;
+    uint begin = min(lid * chunk, total);
+    uint end = min(begin + chunk, total);
+
+    uint sum = 0u;
+    for (uint i = begin; i < end; i++) sum += histogram[i];
+    sSum[lid] = sum;
+    barrier();
+    for (uint offset = 1u; offset < 256u; offset <<= 1u) {
+        uint t = lid >= offset ? sSum[lid - offset] : 0u;
+        barrier();
+        sSum[lid] += t;
+        barrier();
+    }
+
+    uint running = sSum[lid] - sum;
+    for (uint i = begin; i < end; i++) {
+        uint c = histogram[i];
+        histogram[i] = running;
+        running += c;
+    }
+}
+)";
+
+// Passe 3 : tri local stable du bloc par 4 splits de 1 bit en mémoire partagée, puis dispersion.
+// Les clés fantômes (au-delà de count) valent 0xFFFFFFFF : elles restent en fin de bloc et ne sont pas écrites.
+const char* scatterCS = R"(
+layout (local_size_x = 256) in;
+layout (std430, binding = 2) readonly buffer KeysIn { uint keysIn[]; };
+layout (std430, binding = 3) readonly buffer ValuesIn { uint valuesIn[]; };
+layout (std430, binding = 4) readonly buffer Histogram { uint histogram[]; };
+layout (std430, binding = 5) writeonly buffer KeysOut { uint keysOut[]; };
+layout (std430, binding = 6) writeonly buffer ValuesOut { uint valuesOut[]; };
+uniform uint count;
+uniform uint shift;
+uniform uint blockCount;
+
+shared uint sKey[256];
+shared uint sValue[256];
+shared uint sScan[256];
+shared uint sStart[16];
+
+void main() {
+    uint block = GroupIndex();
+    if (block >= blockCount) return;
+    uint lid = gl_LocalInvocationIndex;
+    uint i = block * 256u + lid;
+    uint key = i < count ? keysIn[i] : 0xFFFFFFFFu;
+    uint value = i < count ? valuesIn[i] : 0u;
+
+    for (uint b = 0u; b < 4u; b++) {
+        uint zero = 1u - ((key >> (shift + b)) & 1u);
+        sScan[lid] = zero;
+        barrier();
+        for (uint offset = 1u; offset < 256u; offset <<= 1u) {
+            uint t = lid >= offset ? sScan[lid - offset] : 0u;
+            barrier();
+            sScan[lid] += t;
+            barrier();
+        }
+        uint zerosBefore = sScan[lid] - zero;
+        uint pos = zero != 0u ? zerosBefore : sScan[255] + lid - zerosBefore;
+        barrier();
+        sKey[pos] = key;
+        sValue[pos] = value;
+        barrier();
+        key = sKey[lid];
+        value = sValue[lid];
+        barrier();
+    }
+
+    uint digit = (key >> shift) & 15u;
+    if (lid == 0u || ((sKey[lid - 1u] >> shift) & 15u) != digit) sStart[digit] = lid;
+    barrier();
+
+    uint valid = min(256u, count - block * 256u);
+    if (lid < valid) {
+        uint dst = histogram[digit * blockCount + block] + lid - sStart[digit];
+        keysOut[dst] = key;
+        valuesOut[dst] = value;
+    }
+}
+)";
+
+// Noeuds internes 0..n-2, feuilles n-1..2n-2 (feuille k = particule triée k). Racine = noeud 0.
+const char* buildCS = R"(
+layout (local_size_x = 256) in;
+layout (std430, binding = 0) readonly buffer Keys { uint keys[]; };
+layout (std430, binding = 2) writeonly buffer Children { uvec2 children[]; };
+layout (std430, binding = 4) writeonly buffer Parents { uint parents[]; };
+uniform uint count;
+
+// Longueur du préfixe commun ; clés égales départagées par leurs indices
+int Delta(int i, int j) {
+    if (j < 0 || j >= int(count)) return -1;
+    uint a = keys[i], b = keys[j];
+    if (a == b) return 32 + 31 - findMSB(uint(i ^ j));
+    return 31 - findMSB(a ^ b);
+}
+
+void main() {
+    int i = int(GroupIndex() * 256u + gl_LocalInvocationIndex);
+    int n = int(count);
+    if (i >= n - 1) return;
+
+    // Direction et étendue de la plage couverte par le noeud
+    int d = Delta(i, i + 1) - Delta(i, i - 1) >= 0 ? 1 : -1;
+    int deltaMin = Delta(i, i - d);
+    int lMax = 2;
+    while (Delta(i, i + lMax * d) > deltaMin) lMax *= 2;
+    int l = 0;
+    for (int t = lMax / 2; t >= 1; t /= 2)
+        if (Delta(i, i + (l + t) * d) > deltaMin) l += t;
+    int j = i + l * d;
+
+    // Point de coupe : dernier indice partageant plus que deltaNode bits avec i
+    int deltaNode = Delta(i, j);
+    int s = 0;
+    int t = l;
+    do {
+        t = (t + 1) / 2;
+        if (Delta(i, i + (s + t) * d) > deltaNode) s += t;
+    } while (t > 1);
+    int gamma = i + s * d + min(d, 0);
+
+    uint left = min(i, j) == gamma ? uint(n - 1 + gamma) : uint(gamma);
+    uint right = max(i, j) == gamma + 1 ? uint(n + gamma) : uint(gamma + 1);
+    children[i] = uvec2(left, right);
+    parents[left] = uint(i);
+    parents[right] = uint(i);
+    if (i == 0) parents[0] = 0xFFFFFFFFu;
+}
+)";
+
+// Remontée : chaque feuille monte tant qu'elle est le second enfant arrivé (compteur atomique)
+const char* summarizeCS = R"(
+layout (local_size_x = 256) in;
+layout (std430, binding = 0) readonly buffer Positions { vec4 positions[]; };
+layout (std430, binding = 1) coherent buffer Flags { uint flags[]; };
+layout (std430, binding = 2) readonly buffer Children { uvec2 children[]; };
+layout (std430, binding = 3) readonly buffer Values { uint values[]; };
+layout (std430, binding = 4) readonly buffer Parents { uint parents[]; };
+layout (std430, binding = 5) coherent buffer Mass { vec4 mass[]; };
+layout (std430, binding = 6) coherent buffer BoxMin { vec4 boxMin[]; };
+layout (std430, binding = 7) coherent buffer BoxMax { vec4 boxMax[]; };
+uniform uint count;
+uniform float theta;
+
+void main() {
+    uint k = GroupIndex() * 256u + gl_LocalInvocationIndex;
+    if (k >= count) return;
+
+    // Feuille : rayon d'ouverture nul, toute autre particule l'accepte (interaction directe)
+    uint node = count - 1u + k;
+    vec4 p = positions[values[k]];
+    mass[node] = p;
+    boxMin[node] = vec4(p.xyz, 0.0);
+    boxMax[node] = vec4(p.xyz, 0.0);
+    memoryBarrierBuffer();
+
+    uint current = parents[node];
+    while (current != 0xFFFFFFFFu) {
+        if (atomicAdd(flags[current], 1u) == 0u) return;   // Le frère n'est pas prêt : il continuera
+        memoryBarrierBuffer();
+
+        uvec2 c = children[current];
+        vec4 a = mass[c.x], b = mass[c.y];
+        vec3 lo = min(boxMin[c.x].xyz, boxMin[c.y].xyz);
+        vec3 hi = max(boxMax[c.x].xyz, boxMax[c.y].xyz);
+        float m = a.w + b.w;
+        vec3 com = m > 0.0 ? (a.xyz * a.w + b.xyz * b.w) / m : 0.5 * (lo + hi);
+
+        // d > s / θ + δ, s = diagonale de la boîte, δ = écart centre de masse / centre de la boîte
+        float open = length(hi - lo) / theta + length(com - 0.5 * (lo + hi));
+
+        mass[current] = vec4(com, m);
+        boxMin[current] = vec4(lo, 0.0);
+        boxMax[current] = vec4(hi, open * open);
+        memoryBarrierBuffer();
+        current = parents[current];
+    }
+}
+)";
+
+const char* traverseCS = R"(
+layout (local_size_x = 64) in;
+layout (std430, binding = 0) readonly buffer Positions { vec4 positions[]; };
+layout (std430, binding = 1) writeonly buffer Accelerations { vec4 accelerations[]; };
+layout (std430, binding = 2) readonly buffer Children { uvec2 children[]; };
+layout (std430, binding = 3) readonly buffer Values { uint values[]; };
+layout (std430, binding = 5) readonly buffer Mass { vec4 mass[]; };
+layout (std430, binding = 7) readonly buffer BoxMax { vec4 boxMax[]; };
+uniform uint count;
+uniform float G;
+uniform float eps2;
+
+const int STACK_SIZE = 64;
+
+void main() {
+    uint k = GroupIndex() * 64u + gl_LocalInvocationIndex;
+    if (k >= count) return;
+
+    uint self = values[k];
+    vec3 p = positions[self].xyz;
+    uint firstLeaf = count - 1u;
+
+    uint stack[STACK_SIZE];
+    int sp = 0;
+    stack[sp++] = 0u;
+    vec3 acc = vec3(0.0);
+    while (sp > 0) {
+        uint node = stack[--sp];
+        vec4 m = mass[node];
+        vec3 d = m.xyz - p;
+        float r2 = dot(d, d);
+        // Pile pleine (arbre dégénéré) : on se contente du monopôle
+        if (r2 > boxMax[node].w || (node < firstLeaf && sp > STACK_SIZE - 2)) {
+            float inv = inversesqrt(r2 + eps2);
+            acc += d * (m.w * inv * inv * inv);
+        } else if (node < firstLeaf) {
+            uvec2 c = children[node];
+            stack[sp++] = c.x;
+            stack[sp++] = c.y;
+        }
+    }
+    accelerations[self] = vec4(G * acc, 0.0);
+}
+)";
+
+void BindStorage(GLuint binding, GLuint buffer) {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+}
+
+GLuint CreateStorage(size_t bytes) {
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)bytes, NULL, GL_DYNAMIC_COPY);
+    return buffer;
+}
+
+void DeleteBuffer(GLuint& buffer) {
+    if (buffer) glDeleteBuffers(1, &buffer);
+    buffer = 0;
+}
+
+void DeleteProgram(GLuint& program) {
+    if (program) glDeleteProgram(program);
+    program = 0;
+}
+
+} // namespace
+
+bool GPUTreeSolver::Supported() {
+    return GLAD_GL_VERSION_4_3 != 0;
+}
+
+bool GPUTreeSolver::Init() {
+    if (!Supported()) return false;
+    if (traverseProgram) return true;
+
+    const std::string common = commonCS;
+    boundsProgram = CreateComputeProgram(boundsCS, common);
+    mortonProgram = CreateComputeProgram(mortonCS, common);
+    histogramProgram = CreateComputeProgram(histogramCS, common);
+    scanProgram = CreateComputeProgram(scanCS, common);
+    scatterProgram = CreateComputeProgram(scatterCS, common);
+    buildProgram = CreateComputeProgram(buildCS, common);
+    summarizeProgram = CreateComputeProgram(summarizeCS, common);
+    traverseProgram = CreateComputeProgram(traverseCS, common);
+    if (!boundsProgram || !mortonProgram || !histogramProgram || !scanProgram || !scatterProgram ||
+        !buildProgram || !summarizeProgram || !traverseProgram) {
+        Release();
+        return false;
+    }
+    boundsBuffer = CreateStorage(6 * sizeof(GLuint));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return true;
+}
+
+void GPUTreeSolver::Release() {
+    DeleteProgram(boundsProgram);
+    DeleteProgram(mortonProgram);
+    DeleteProgram(histogramProgram);
+    DeleteProgram(scanProgram);
+    DeleteProgram(scatterProgram);
+    DeleteProgram(buildProgram);
+    DeleteProgram(summarizeProgram);
+    DeleteProgram(traverseProgram);
+    DeleteBuffer(boundsBuffer);
+    for (int i = 0; i < 2; i++) {
+        DeleteBuffer(keyBuffers[i]);
+        DeleteBuffer(valueBuffers[i]);
+    }
+    DeleteBuffer(histogramBuffer);
+    DeleteBuffer(childBuffer);
+    DeleteBuffer(parentBuffer);
+    DeleteBuffer(flagBuffer);
+    DeleteBuffer(massBuffer);
+    DeleteBuffer(boxMinBuffer);
+    DeleteBuffer(boxMaxBuffer);
+    capacity = 0;
+}
+
+// Taille exacte (pas de croissance géométrique) : ~130 octets par particule
+void GPUTreeSolver::Reserve(size_t count) {
+    if (count <= capacity) return;
+    for (int i = 0; i < 2; i++) {
+        DeleteBuffer(keyBuffers[i]);
+        DeleteBuffer(valueBuffers[i]);
+    }
+    DeleteBuffer(histogramBuffer);
+    DeleteBuffer(childBuffer);
+    DeleteBuffer(parentBuffer);
+    DeleteBuffer(flagBuffer);
+    DeleteBuffer(massBuffer);
+    DeleteBuffer(boxMinBuffer);
+    DeleteBuffer(boxMaxBuffer);
+
+    const size_t nodes = 2 * count - 1;
+    const size_t blocks = (count + 255) / 256;
+    for (int i = 0; i < 2; i++) {
+        keyBuffers[i] = CreateStorage(count * sizeof(GLuint));
+        valueBuffers[i] = CreateStorage(count * sizeof(GLuint));
+    }
+    histogramBuffer = CreateStorage(16 * blocks * sizeof(GLuint));
+    childBuffer = CreateStorage((count - 1) * 2 * sizeof(GLuint));
+    parentBuffer = CreateStorage(nodes * sizeof(GLuint));
+    flagBuffer = CreateStorage((count - 1) * sizeof(GLuint));
+    massBuffer = CreateStorage(nodes * 4 * sizeof(float));
+    boxMinBuffer = CreateStorage(nodes * 4 * sizeof(float));
+    boxMaxBuffer = CreateStorage(nodes * 4 * sizeof(float));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    capacity = count;
+}
+
+// 8 passes de 4 bits (clés 30 bits) : le résultat revient dans keyBuffers[0] / valueBuffers[0]
+void GPUTreeSolver::SortKeys(size_t count) {
+    const GLuint blockCount = (GLuint)((count + 255) / 256);
+    int src = 0;
+    for (GLuint shift = 0; shift < 32; shift += 4) {
+        glUseProgram(histogramProgram);
+        glUniform1ui(glGetUniformLocation(histogramProgram, "count"), (GLuint)count);
+        glUniform1ui(glGetUniformLocation(histogramProgram, "shift"), shift);
+        glUniform1ui(glGetUniformLocation(histogramProgram, "blockCount"), blockCount);
+        BindStorage(2, keyBuffers[src]);
+        BindStorage(4, histogramBuffer);
+        DispatchCompute1D(blockCount);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        glUseProgram(scanProgram);
+        glUniform1ui(glGetUniformLocation(scanProgram, "total"), 16 * blockCount);
+        glDispatchCompute(1, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        glUseProgram(scatterProgram);
+        glUniform1ui(glGetUniformLocation(scatterProgram, "count"), (GLuint)count);
+        glUniform1ui(glGetUniformLocation(scatterProgram, "shift"), shift);
+        glUniform1ui(glGetUniformLocation(scatterProgram, "blockCount"), blockCount);
+        BindStorage(3, valueBuffers[src]);
+        BindStorage(5, keyBuffers[1 - src]);
+        BindStorage(6, valueBuffers[1 - src]);
+        DispatchCompute1D(blockCount);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        src = 1 - src;
+    }
+}
+
+void GPUTreeSolver::ComputeAccelerations(GLuint positions, size_t count, float G, float theta, float softening,
+                                         GLuint accelerations) {
+    if (!traverseProgram || count == 0) return;
+    if (count < 2) {
+        // Pas de noeud interne : une particule seule ne subit aucune force
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, accelerations);
+        glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_RGBA32F, 0, count * 4 * sizeof(float), GL_RGBA, GL_FLOAT, NULL);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        return;
+    }
+    Reserve(count);
+    theta = std::min(std::max(theta, 0.05f), 1.0f);
+    const GLuint groups = (GLuint)((count + 255) / 256);
+
+    // 1. Boîte englobante
+    const GLuint emptyBounds[6] = { 0xFFFFFFFFu, 0xFFFFFFFFu, 0xFFFFFFFFu, 0u, 0u, 0u };
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(emptyBounds), emptyBounds);
+    glUseProgram(boundsProgram);
+    glUniform1ui(glGetUniformLocation(boundsProgram, "count"), (GLuint)count);
+    BindStorage(0, positions);
+    BindStorage(1, boundsBuffer);
+    DispatchCompute1D(groups);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // 2. Clés de Morton + tri
+    glUseProgram(mortonProgram);
+    glUniform1ui(glGetUniformLocation(mortonProgram, "count"), (GLuint)count);
+    BindStorage(2, keyBuffers[0]);
+    BindStorage(3, valueBuffers[0]);
+    DispatchCompute1D(groups);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    SortKeys(count);
+
+    // 3. Arbre radix
+    glUseProgram(buildProgram);
+    glUniform1ui(glGetUniformLocation(buildProgram, "count"), (GLuint)count);
+    BindStorage(0, keyBuffers[0]);
+    BindStorage(2, childBuffer);
+    BindStorage(4, parentBuffer);
+    DispatchCompute1D(groups);
+
+    // 4. Monopôles et boîtes, des feuilles vers la racine
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, flagBuffer);
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, (count - 1) * sizeof(GLuint), GL_RED_INTEGER,
+                         GL_UNSIGNED_INT, NULL);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    glUseProgram(summarizeProgram);
+    glUniform1ui(glGetUniformLocation(summarizeProgram, "count"), (GLuint)count);
+    glUniform1f(glGetUniformLocation(summarizeProgram, "theta"), theta);
+    BindStorage(0, positions);
+    BindStorage(1, flagBuffer);
+    BindStorage(3, valueBuffers[0]);
+    BindStorage(5, massBuffer);
+    BindStorage(6, boxMinBuffer);
+    BindStorage(7, boxMaxBuffer);
+    DispatchCompute1D(groups);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // 5. Parcours
+    glUseProgram(traverseProgram);
+    glUniform1ui(glGetUniformLocation(traverseProgram, "count"), (GLuint)count);
+    glUniform1f(glGetUniformLocation(traverseProgram, "G"), G);
+    glUniform1f(glGetUniformLocation(traverseProgram, "eps2"), softening * softening);
+    BindStorage(1, accelerations);
+    DispatchCompute1D((GLuint)((count + 63) / 64));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    for (GLuint binding = 0; binding < 8; binding++) BindStorage(binding, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
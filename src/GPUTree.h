@@ -0,0 +1,48 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+
+// --- Arbre de gravité GPU (compute shaders, OpenGL 4.3) ---
+// Arbre radix binaire linéaire (Karras 2012), reconstruit à chaque pas sans quitter la VRAM :
+//   1. boîte englobante (réduction + atomiques sur des flottants encodés en entiers ordonnés)
+//   2. clés de Morton 30 bits lues directement dans posVBO (lié comme SSBO)
+//   3. tri radix LSD 4 bits (histogrammes par bloc, scan, dispersion stable par splits 1 bit en mémoire partagée)
+//   4. noeuds internes construits en parallèle (un thread par noeud, clés identiques départagées par l'indice)
+//   5. monopôles + boîtes remontés des feuilles vers la racine (compteur atomique par noeud : le second arrivé continue)
+//   6. parcours avec pile par particule, dans l'ordre de Morton (threads voisins -> chemins voisins)
+// Critère d'ouverture de BarnesHutSolver (d > s / θ + δ) avec s = diagonale de la boîte du noeud (les noeuds
+// binaires sont allongés) mais évalué par particule et non par groupe : erreur ~3x plus grande à θ égal.
+// Accélérations écrites au format de treeAccBuffer (vec4 par particule, ordre d'origine).
+
+class GPUTreeSolver {
+public:
+    static bool Supported();   // Contexte 4.3 : compute shaders + SSBO
+
+    bool Init();
+    void Release();
+
+    // positions : VBO de count vec4 (xyz, masse) ; accelerations : buffer d'au moins count vec4.
+    // Synchronisé par glMemoryBarrier : le résultat peut être lu comme texture buffer juste après.
+    void ComputeAccelerations(GLuint positions, size_t count, float G, float theta, float softening,
+                              GLuint accelerations);
+
+private:
+    void Reserve(size_t count);
+    void SortKeys(size_t count);
+
+    size_t capacity = 0;
+    GLuint boundsProgram = 0, mortonProgram = 0;
+    GLuint histogramProgram = 0, scanProgram = 0, scatterProgram = 0;
+    GLuint buildProgram = 0, summarizeProgram = 0, traverseProgram = 0;
+
+    GLuint boundsBuffer = 0;        // 6 uint : min xyz, max xyz encodés
+    GLuint keyBuffers[2] = {};      // Clés de Morton (ping-pong du tri)
+    GLuint valueBuffers[2] = {};    // Indice d'origine de chaque clé
+    GLuint histogramBuffer = 0;     // 16 x nombre de blocs, chiffre majeur
+    GLuint childBuffer = 0;         // uvec2 par noeud interne
+    GLuint parentBuffer = 0;        // Parent de chaque noeud (internes puis feuilles)
+    GLuint flagBuffer = 0;          // Compteurs d'arrivée de la remontée
+    GLuint massBuffer = 0;          // vec4 (centre de masse, masse) par noeud
+    GLuint boxMinBuffer = 0;        // vec4 (min, -)
+    GLuint boxMaxBuffer = 0;        // vec4 (max, rayon d'ouverture²)
+};
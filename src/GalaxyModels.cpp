@@ -0,0 +1,377 @@
+#include "GalaxyModels.h"
+#include "LowDiscrepancy.h"
+#include "Parallel.h"
+#include "Philox.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const float BH_SOFTENING = 10.0f; // Identique à physicsVS (distSq + 10)
+
+// --- Fonctions de Bessel modifiées (Abramowitz & Stegun 9.8.1 - 9.8.8) ---
+// std::cyl_bessel_* n'existe pas avec libc++ (macOS), d'où ces approximations polynomiales.
+double BesselI0(double x) {
+    if (x < 3.75) {
+        double t = x / 3.75; t *= t;
+        return 1.0 + t*(3.5156229 + t*(3.0899424 + t*(1.2067492 + t*(0.2659732 + t*(0.0360768 + t*0.0045813)))));
+    }
+    double t = 3.75 / x;
+    return (std::exp(x) / std::sqrt(x)) * (0.39894228 + t*(0.01328592 + t*(0.00225319 + t*(-0.00157565 + t*(0.00916281
+           + t*(-0.02057706 + t*(0.02635537 + t*(-0.01647633 + t*0.00392377))))))));
+}
+
+double BesselI1(double x) {
+    if (x < 3.75) {
+        double t = x / 3.75; t *= t;
+        return x * (0.5 + t*(0.87890594 + t*(0.51498869 + t*(0.15084934 + t*(0.02658733 + t*(0.00301532 + t*0.00032411))))));
+    }
+    double t = 3.75 / x;
+    return (std::exp(x) / std::sqrt(x)) * (0.39894228 + t*(-0.03988024 + t*(-0.00362018 + t*(0.00163801 + t*(-0.01031555
+           + t*(0.02282967 + t*(-0.02895312 + t*(0.01787654 - t*0.00420059))))))));
+}
+
+double BesselK0(double x) {
+    if (x <= 2.0) {
+        double y = x * x / 4.0;
+        return -std::log(x / 2.0) * BesselI0(x) + (-0.57721566 + y*(0.42278420 + y*(0.23069756 + y*(0.03488590
+               + y*(0.00262698 + y*(0.00010750 + y*0.0000074))))));
+    }
+    double y = 2.0 / x;
+    return (std::exp(-x) / std::sqrt(x)) * (1.25331414 + y*(-0.07832358 + y*(0.02189568 + y*(-0.01062446
+           + y*(0.00587872 + y*(-0.00251540 + y*0.00053208))))));
+}
+
+double BesselK1(double x) {
+    if (x <= 2.0) {
+        double y = x * x / 4.0;
+        return std::log(x / 2.0) * BesselI1(x) + (1.0 / x) * (1.0 + y*(0.15443144 + y*(-0.67278579 + y*(-0.18156897
+               + y*(-0.01919402 + y*(-0.00110404 + y*(-0.00004686)))))));
+    }
+    double y = 2.0 / x;
+    return (std::exp(-x) / std::sqrt(x)) * (1.25331414 + y*(0.23498619 + y*(-0.03655620 + y*(0.01504268
+           + y*(-0.00780353 + y*(0.00325614 + y*(-0.00068245)))))));
+}
+
+// --- Profils (masses cumulées non normalisées, densités à une constante près) ---
+double DiskMassFraction(double R, double Rd) {
+    double x = R / Rd;
+    return 1.0 - (1.0 + x) * std::exp(-x);
+}
+
+double HernquistMass(double r, double a) {
+    return (r * r) / ((r + a) * (r + a));
+}
+
+double HernquistDensity(double r, double a) {
+    double x = r / a;
+    return 1.0 / (x * (1.0 + x) * (1.0 + x) * (1.0 + x));
+}
+
+double NFWMass(double r, double rs) {
+    double x = r / rs;
+    return std::log(1.0 + x) - x / (1.0 + x);
+}
+
+double NFWDensity(double r, double rs) {
+    double x = r / rs;
+    return 1.0 / (x * (1.0 + x) * (1.0 + x));
+}
+
+// Box-Muller : deux gaussiennes à partir de deux uniformes
+void Gaussian2(float u1, float u2, float& g1, float& g2) {
+    float rad = std::sqrt(-2.0f * std::log(std::max(u1, 1.0e-7f)));
+    float ang = 2.0f * (float)PI * u2;
+    g1 = rad * std::cos(ang);
+    g2 = rad * std::sin(ang);
+}
+
+// Uniformes de position : Sobol brouillé (indexé dans la composante, pour stratifier chaque composante)
+// ou Philox. Les vitesses restent toujours pseudo-aléatoires.
+void PositionUniforms(uint32_t seed, uint32_t index, uint32_t localIndex, uint32_t component, bool quasiRandom, float u[4]) {
+    if (quasiRandom) {
+        uint32_t componentSeed = seed ^ (component * 0x27D4EB2Fu);
+        for (int d = 0; d < 3; d++) u[d] = SobolUnit(localIndex, d, componentSeed);
+        u[3] = 0.0f;
+    } else {
+        PhiloxStream rng = { seed, index };
+        rng.Uniform4(0, u);
+    }
+}
+
+} // namespace
+
+// --- InverseCDFTable ---
+
+void InverseCDFTable::Build(const std::vector<double>& radius, const std::vector<double>& cumulative, int size) {
+    values.resize(size);
+    double total = cumulative.back();
+    size_t k = 0;
+    for (int j = 0; j < size; j++) {
+        double target = total * (double)j / (double)(size - 1);
+        while (k + 1 < cumulative.size() - 1 && cumulative[k + 1] < target) k++;
+        double c0 = cumulative[k], c1 = cumulative[k + 1];
+        double t = (c1 > c0) ? (target - c0) / (c1 - c0) : 0.0;
+        t = std::min(std::max(t, 0.0), 1.0);
+        values[j] = (float)(radius[k] + t * (radius[k + 1] - radius[k]));
+    }
+}
+
+float InverseCDFTable::Sample(float u) const {
+    float x = u * (float)(values.size() - 1);
+    int i = std::min((int)x, (int)values.size() - 2);
+    float t = x - (float)i;
+    return values[i] + t * (values[i + 1] - values[i]);
+}
+
+// --- RadialTable ---
+
+void RadialTable::Init(double rMin, double rMax, int n) {
+    logMin = std::log(rMin);
+    logStep = (std::log(rMax) - logMin) / (double)(n - 1);
+    count = n;
+}
+
+double RadialTable::Radius(int k) const {
+    return std::exp(logMin + logStep * k);
+}
+
+float RadialTable::Eval(const std::vector<float>& table, float r) const {
+    double x = (std::log(std::max((double)r, 1.0e-6)) - logMin) / logStep;
+    if (x <= 0.0) return table.front();
+    if (x >= count - 1) return table.back();
+    int i = (int)x;
+    float t = (float)(x - i);
+    return table[i] + t * (table[i + 1] - table[i]);
+}
+
+// --- GalaxyModel ---
+
+GalaxyModel::GalaxyModel(const GalaxyModelParams& params) : p(params) {
+    const double Rd = p.diskScaleLength;
+    const double a = p.bulgeScale;
+    const double rs = p.haloScale;
+
+    diskMaxRadius = (float)(10.0 * Rd);
+    const double bulgeMax = 30.0 * a;
+    const double haloMax = p.haloConcentration * rs;
+    const double rMax = std::max({ (double)diskMaxRadius, bulgeMax, haloMax }) * 1.5;
+    const double rMin = 1.0e-3 * std::min({ Rd, a, rs });
+
+    const int N = 2048;
+    grid.Init(rMin, rMax, N);
+
+    // 1. Masses cumulées (disque traité sphériquement pour les composantes sphéroïdales)
+    std::vector<double> r(N), mDisk(N), mBulge(N), mHalo(N), mTotal(N);
+    const double diskNorm = DiskMassFraction(diskMaxRadius, Rd);
+    const double bulgeNorm = HernquistMass(bulgeMax, a);
+    const double haloNorm = NFWMass(haloMax, rs);
+    for (int k = 0; k < N; k++) {
+        r[k] = grid.Radius(k);
+        mDisk[k]  = p.diskMass  * DiskMassFraction(std::min(r[k], (double)diskMaxRadius), Rd) / diskNorm;
+        mBulge[k] = p.bulgeMass * HernquistMass(std::min(r[k], bulgeMax), a) / bulgeNorm;
+        mHalo[k]  = p.haloMass  * NFWMass(std::min(r[k], haloMax), rs) / haloNorm;
+        mTotal[k] = mDisk[k] + mBulge[k] + mHalo[k] + p.blackHoleMass;
+    }
+
+    // 2. Tables d'inverse de CDF (grille log -> bonne résolution au centre)
+    std::vector<double> rc(N + 1, 0.0), cd(N + 1, 0.0), cb(N + 1, 0.0), ch(N + 1, 0.0);
+    for (int k = 0; k < N; k++) {
+        rc[k + 1] = r[k]; cd[k + 1] = mDisk[k]; cb[k + 1] = mBulge[k]; ch[k + 1] = mHalo[k];
+    }
+    diskCDF.Build(rc, cd);
+    bulgeCDF.Build(rc, cb);
+    haloCDF.Build(rc, ch);
+
+    // 3. Courbe de rotation dans le plan : disque de Freeman + sphéroïdes + trou noir adouci
+    vCirc.resize(N);
+    for (int k = 0; k < N; k++) {
+        double R = r[k];
+        double y = std::min(R, (double)diskMaxRadius) / (2.0 * Rd);
+        double vDisk2 = 0.0;
+        if (R < diskMaxRadius) {
+            vDisk2 = 2.0 * p.diskMass / Rd * y * y * (BesselI0(y) * BesselK0(y) - BesselI1(y) * BesselK1(y));
+        } else {
+            vDisk2 = p.diskMass / R; // Au-delà de la troncature : masse ponctuelle
+        }
+        double vSph2 = (mBulge[k] + mHalo[k]) / R;
+        double vBH2 = p.blackHoleMass * R * R / std::pow(R * R + BH_SOFTENING, 1.5);
+        vCirc[k] = (float)std::sqrt(std::max(0.0, vDisk2 + vSph2 + vBH2));
+    }
+
+    // κ² / (4Ω²) avec κ² = 2 (v/R) (v/R + dv/dR)
+    kappaOverOmega2.resize(N);
+    for (int k = 0; k < N; k++) {
+        int k0 = std::max(k - 1, 0), k1 = std::min(k + 1, N - 1);
+        double dvdR = (vCirc[k1] - vCirc[k0]) / (r[k1] - r[k0]);
+        double v = vCirc[k];
+        double ratio = (v > 0.0) ? 0.5 * (1.0 + r[k] * dvdR / v) : 1.0;
+        kappaOverOmega2[k] = (float)std::min(std::max(ratio, 0.25), 1.0);
+    }
+
+    // 4. Dispersion radiale du disque : Q de Toomre imposé au rayon de référence 2.43 Rd
+    {
+        float Rref = (float)(2.43 * Rd);
+        float v = grid.Eval(vCirc, Rref);
+        float kappa = std::sqrt(4.0f * grid.Eval(kappaOverOmega2, Rref)) * v / Rref;
+        double sigmaSurf = p.diskMass / (2.0 * PI * Rd * Rd) * std::exp(-Rref / Rd) / diskNorm;
+        double sigmaRef = p.toomreQ * 3.36 * sigmaSurf / std::max(kappa, 1.0e-6f);
+        // σ_R² ∝ exp(-R/Rd)  ->  normalisation à R = 0
+        sigmaR0 = (float)(sigmaRef * std::exp(0.5 * Rref / Rd));
+    }
+
+    // 5. Potentiel et équation de Jeans isotrope pour bulbe et halo
+    //    σ²(r) = 1/ρ(r) ∫_r^∞ ρ(r') M(r')/r'² dr'   (intégration en ln r, de l'extérieur vers l'intérieur)
+    std::vector<double> phi(N);
+    phi[N - 1] = -mTotal[N - 1] / r[N - 1];
+    for (int k = N - 2; k >= 0; k--) {
+        double g0 = mTotal[k] / (r[k] * r[k]), g1 = mTotal[k + 1] / (r[k + 1] * r[k + 1]);
+        phi[k] = phi[k + 1] - 0.5 * (g0 + g1) * (r[k + 1] - r[k]);
+    }
+    vEscape.resize(N);
+    for (int k = 0; k < N; k++) vEscape[k] = (float)std::sqrt(-2.0 * phi[k]);
+
+    auto jeans = [&](double (*density)(double, double), double scale, double rTrunc, std::vector<float>& sigma) {
+        sigma.assign(N, 0.0f);
+        double integral = 0.0;
+        double prev = 0.0;
+        for (int k = N - 1; k >= 0; k--) {
+            double rho = (r[k] < rTrunc) ? density(r[k], scale) : 0.0;
+            double f = rho * mTotal[k] / (r[k] * r[k]);
+            if (k < N - 1) integral += 0.5 * (f + prev) * (r[k + 1] - r[k]);
+            prev = f;
+            sigma[k] = (rho > 0.0) ? (float)std::sqrt(integral / rho) : 0.0f;
+        }
+    };
+    jeans(HernquistDensity, a, bulgeMax, bulgeSigma);
+    jeans(NFWDensity, rs, haloMax, haloSigma);
+}
+
+float GalaxyModel::CircularVelocity(float r) const {
+    return grid.Eval(vCirc, r);
+}
+
+float GalaxyModel::TotalMass() const {
+    return p.diskMass + p.bulgeMass + p.haloMass;
+}
+
+void GalaxyModel::SampleDisk(uint32_t seed, uint32_t index, uint32_t localIndex, bool quasiRandom,
+                             glm::vec4& pos, glm::vec4& vel) const {
+    PhiloxStream rng = { seed, index };
+    float u[4], n[4];
+    PositionUniforms(seed, index, localIndex, 0, quasiRandom, u);
+    rng.Uniform4(1, n);
+
+    float R = diskCDF.Sample(u[0]);
+    float phi = u[1] * 2.0f * (float)PI;
+    // Profil vertical sech²(z/z0) : inverse exacte z = z0 atanh(2u - 1)
+    float uz = std::min(std::max(u[2], 1.0e-6f), 1.0f - 1.0e-6f);
+    float z = p.diskScaleHeight * std::atanh(2.0f * uz - 1.0f);
+
+    float c = std::cos(phi), s = std::sin(phi);
+    pos = glm::vec4(R * c, R * s, z, 1.0f);
+
+    // Dispersions (approximation épicyclique, Hernquist 1993)
+    float Rd = p.diskScaleLength;
+    float vc = grid.Eval(vCirc, R);
+    float k2 = grid.Eval(kappaOverOmega2, R);
+    float sigmaR = sigmaR0 * std::exp(-0.5f * R / Rd);
+    float sigmaPhi = sigmaR * std::sqrt(k2);
+    double diskNorm = DiskMassFraction(diskMaxRadius, Rd);
+    float surface = (float)(p.diskMass / (2.0 * PI * Rd * Rd) * std::exp(-R / Rd) / diskNorm);
+    float sigmaZ = std::sqrt((float)PI * surface * p.diskScaleHeight);
+    // Dérive asymétrique : v_phi² = v_c² + σ_R² (1 - κ²/4Ω² - 2R/Rd)
+    float vPhiMean = std::sqrt(std::max(0.0f, vc * vc + sigmaR * sigmaR * (1.0f - k2 - 2.0f * R / Rd)));
+
+    float gR, gPhi, gZ, gUnused;
+    Gaussian2(n[0], n[1], gR, gPhi);
+    Gaussian2(n[2], n[3], gZ, gUnused);
+
+    float vR = gR * sigmaR;
+    float vPhi = vPhiMean + gPhi * sigmaPhi;
+    float vZ = gZ * sigmaZ;
+    // Même sens de rotation que le disque legacy (tangente = (-sin, cos))
+    vel = glm::vec4(vR * c - vPhi * s, vR * s + vPhi * c, vZ, 0.0f);
+}
+
+void GalaxyModel::SampleSpheroid(uint32_t seed, uint32_t index, uint32_t localIndex, bool quasiRandom, uint32_t component,
+                                 const InverseCDFTable& cdf, const std::vector<float>& sigma,
+                                 glm::vec4& pos, glm::vec4& vel) const {
+    PhiloxStream rng = { seed, index };
+    float u[4];
+    PositionUniforms(seed, index, localIndex, component, quasiRandom, u);
+
+    float r = cdf.Sample(u[0]);
+    float cosT = 2.0f * u[1] - 1.0f;
+    float sinT = std::sqrt(std::max(0.0f, 1.0f - cosT * cosT));
+    float phi = u[2] * 2.0f * (float)PI;
+    pos = glm::vec4(r * sinT * std::cos(phi), r * sinT * std::sin(phi), r * cosT, 1.0f);
+
+    // Maxwellienne isotrope tronquée à 95% de la vitesse d'échappement
+    float s = grid.Eval(sigma, r);
+    float vMax = 0.95f * grid.Eval(vEscape, r);
+    glm::vec3 v(0.0f);
+    for (uint32_t attempt = 0; attempt < 16; attempt++) {
+        float n[4];
+        rng.Uniform4(1 + attempt, n);
+        float g0, g1, g2, g3;
+        Gaussian2(n[0], n[1], g0, g1);
+        Gaussian2(n[2], n[3], g2, g3);
+        v = glm::vec3(g0, g1, g2) * s;
+        if (glm::length(v) < vMax) break;
+        v *= vMax / glm::length(v) * 0.99f; // Dernier recours si aucune tentative n'est acceptée
+    }
+    vel = glm::vec4(v, 0.0f);
+}
+
+GalaxyModel::Partition GalaxyModel::Split(size_t count) const {
+    // Nombre de particules par composante ∝ masse / masse relative de particule
+    double wDisk = p.diskMass;
+    double wBulge = p.bulgeMass / std::max(p.bulgeParticleMassRatio, 1.0e-3f);
+    double wHalo = p.haloMass / std::max(p.haloParticleMassRatio, 1.0e-3f);
+    double wTotal = wDisk + wBulge + wHalo;
+
+    Partition part;
+    part.nBulge = (p.bulgeMass > 0.0f) ? (size_t)std::llround(count * (wBulge / wTotal)) : 0;
+    part.nHalo = (p.haloMass > 0.0f) ? (size_t)std::llround(count * (wHalo / wTotal)) : 0;
+    part.nBulge = std::min(part.nBulge, count);
+    part.nHalo = std::min(part.nHalo, count - part.nBulge);
+    part.nDisk = count - part.nBulge - part.nHalo;
+
+    // La masse de chaque composante est conservée exactement malgré les arrondis
+    part.diskParticleMass = part.nDisk ? p.diskMass / (float)part.nDisk : 0.0f;
+    part.bulgeParticleMass = part.nBulge ? p.bulgeMass / (float)part.nBulge : 0.0f;
+    part.haloParticleMass = part.nHalo ? p.haloMass / (float)part.nHalo : 0.0f;
+    return part;
+}
+
+void GalaxyModel::SampleOne(uint32_t seed, size_t index, const Partition& part, bool quasiRandom,
+                            glm::vec4& pos, glm::vec4& vel) const {
+    const uint32_t i = (uint32_t)index;
+    if (index < part.nDisk) {
+        SampleDisk(seed, i, i, quasiRandom, pos, vel);
+        pos.w = part.diskParticleMass;
+    } else if (index < part.nDisk + part.nBulge) {
+        uint32_t local = (uint32_t)(index - part.nDisk);
+        SampleSpheroid(seed, i, local, quasiRandom, 1, bulgeCDF, bulgeSigma, pos, vel);
+        pos.w = part.bulgeParticleMass;
+    } else {
+        uint32_t local = (uint32_t)(index - part.nDisk - part.nBulge);
+        SampleSpheroid(seed, i, local, quasiRandom, 2, haloCDF, haloSigma, pos, vel);
+        pos.w = part.haloParticleMass;
+    }
+}
+
+void GalaxyModel::Sample(uint32_t seed, size_t index, size_t count, bool quasiRandom, glm::vec4& pos, glm::vec4& vel) const {
+    SampleOne(seed, index, Split(count), quasiRandom, pos, vel);
+}
+
+void GalaxyModel::Generate(uint32_t seed, glm::vec4* positions, glm::vec4* velocities, size_t count, bool quasiRandom) const {
+    const Partition part = Split(count);
+    ParallelFor(0, count, 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            SampleOne(seed, i, part, quasiRandom, positions[i], velocities[i]);
+    });
+}
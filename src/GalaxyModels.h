@@ -0,0 +1,106 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --- Modèles de galaxie à l'équilibre ---
+// Disque exponentiel + bulbe de Hernquist + halo NFW, unités G = 1 (comme le trou noir de physicsVS).
+// Les positions sont tirées par tables d'inverse de fonction de répartition (précalculées une fois),
+// les vitesses par la courbe de rotation (disque) et l'équation de Jeans isotrope (bulbe, halo).
+// Tirages modifiés : incrémenter IC_GENERATOR_VERSION (main.cpp) pour invalider ic_cache/.
+
+struct GalaxyModelParams {
+    // Disque exponentiel (profil vertical sech²)
+    float diskMass = 6.0e5f;
+    float diskScaleLength = 250.0f;
+    float diskScaleHeight = 25.0f;
+    float toomreQ = 1.5f;          // Stabilité du disque, fixe la dispersion radiale
+
+    // Bulbe de Hernquist
+    float bulgeMass = 1.0e5f;
+    float bulgeScale = 60.0f;
+
+    // Halo NFW (tronqué à r200 = c * rs)
+    float haloMass = 1.5e6f;
+    float haloScale = 400.0f;
+    float haloConcentration = 8.0f;
+
+    // Importance sampling : masse d'une particule de bulbe / halo relativement à une particule de disque.
+    // > 1 : peu de particules lourdes dans les composantes diffuses, beaucoup de légères dans le disque.
+    float bulgeParticleMassRatio = 1.0f;
+    float haloParticleMassRatio = 1.0f;
+
+    // Masse centrale (même potentiel adouci que physicsVS)
+    float blackHoleMass = 0.0f;
+};
+
+// Table de l'inverse de la fonction de répartition : u uniforme -> rayon
+class InverseCDFTable {
+public:
+    // radius croissant, cumulative croissante (pas forcément normalisée)
+    void Build(const std::vector<double>& radius, const std::vector<double>& cumulative, int size = 4096);
+    float Sample(float u) const;
+
+private:
+    std::vector<float> values;
+};
+
+// Grandeur tabulée sur une grille logarithmique en rayon
+class RadialTable {
+public:
+    void Init(double rMin, double rMax, int count);
+    float Eval(const std::vector<float>& table, float r) const;
+    double Radius(int k) const;
+    int Count() const { return count; }
+
+private:
+    double logMin = 0.0, logStep = 1.0;
+    int count = 0;
+};
+
+class GalaxyModel {
+public:
+    explicit GalaxyModel(const GalaxyModelParams& params);
+
+    // Remplit count particules (index 0..count-1), parallèle et déterministe pour une seed donnée.
+    // quasiRandom : positions tirées d'une suite de Sobol brouillée (moins de bruit de Poisson sur la grille)
+    void Generate(uint32_t seed, glm::vec4* positions, glm::vec4* velocities, size_t count, bool quasiRandom = false) const;
+
+    // Échantillonne la particule index parmi count ; pos.w reçoit la masse de la particule
+    void Sample(uint32_t seed, size_t index, size_t count, bool quasiRandom, glm::vec4& pos, glm::vec4& vel) const;
+
+    float CircularVelocity(float r) const;
+    float TotalMass() const;
+
+    // Répartition des particules : [0, nDisk) disque, [nDisk, nDisk + nBulge) bulbe, reste halo
+    struct Partition {
+        size_t nDisk, nBulge, nHalo;
+        float diskParticleMass, bulgeParticleMass, haloParticleMass;
+    };
+    Partition Split(size_t count) const;
+
+private:
+    void SampleOne(uint32_t seed, size_t index, const Partition& part, bool quasiRandom,
+                   glm::vec4& pos, glm::vec4& vel) const;
+    void SampleDisk(uint32_t seed, uint32_t index, uint32_t localIndex, bool quasiRandom,
+                    glm::vec4& pos, glm::vec4& vel) const;
+    void SampleSpheroid(uint32_t seed, uint32_t index, uint32_t localIndex, bool quasiRandom, uint32_t component,
+                        const InverseCDFTable& cdf, const std::vector<float>& sigma,
+                        glm::vec4& pos, glm::vec4& vel) const;
+
+    GalaxyModelParams p;
+
+    InverseCDFTable diskCDF, bulgeCDF, haloCDF;
+
+    // Tables radiales : courbe de rotation et dispersions
+    RadialTable grid;
+    std::vector<float> vCirc;       // vitesse circulaire totale dans le plan
+    std::vector<float> kappaOverOmega2; // κ² / (4Ω²)
+    std::vector<float> bulgeSigma;  // dispersion 1D isotrope
+    std::vector<float> haloSigma;
+    std::vector<float> vEscape;     // sqrt(2|Φ|)
+
+    float sigmaR0 = 0.0f;           // dispersion radiale au rayon de référence
+    float diskMaxRadius = 0.0f;
+};
@@ -0,0 +1,273 @@
+#include "ICCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char* CACHE_DIRECTORY = "ic_cache";
+const uint32_t CACHE_MAGIC = 0x43495053u;   // "SPIC"
+const uint32_t CACHE_VERSION = 1;
+
+// 32 octets : les données vec4 restent alignées sur 16 dans la projection
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t hash;
+    uint64_t count;
+    uint64_t reserved;
+};
+
+std::string EntryPath(uint64_t hash) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.ic", (unsigned long long)hash);
+    return (std::filesystem::path(CACHE_DIRECTORY) / name).string();
+}
+
+size_t EntryBytes(size_t count) {
+    return sizeof(CacheHeader) + 2 * count * sizeof(glm::vec4);
+}
+
+std::atomic<size_t> diskBudget{IC_CACHE_DEFAULT_BUDGET};   // Commit tourne sur le thread de génération
+
+struct CacheEntry {
+    std::filesystem::path path;
+    size_t bytes;
+    std::filesystem::file_time_type lastUse;
+};
+
+std::vector<CacheEntry> ListEntries() {
+    std::vector<CacheEntry> entries;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(CACHE_DIRECTORY, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != ".ic") continue;
+        std::error_code sizeError, timeError;
+        entries.push_back({ it->path(), (size_t)it->file_size(sizeError), it->last_write_time(timeError) });
+    }
+    return entries;
+}
+
+// Supprime les entrées les plus anciennes, sauf keep (celle qu'on vient d'écrire), au-delà du budget
+void EvictToBudget(const std::filesystem::path& keep) {
+    std::vector<CacheEntry> entries = ListEntries();
+    size_t bytes = 0;
+    for (const CacheEntry& e : entries) bytes += e.bytes;
+    const size_t budget = diskBudget.load();
+    if (bytes <= budget) return;
+
+    std::sort(entries.begin(), entries.end(), [](const CacheEntry& a, const CacheEntry& b) { return a.lastUse < b.lastUse; });
+    for (const CacheEntry& e : entries) {
+        if (bytes <= budget) break;
+        std::error_code ec;
+        if (e.path == keep || !std::filesystem::remove(e.path, ec)) continue;   // Sous Windows : échec si projetée
+        bytes -= e.bytes;
+    }
+}
+
+} // namespace
+
+// --- MappedFile ---
+MappedFile::~MappedFile() {
+    Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::OpenRead(const std::string& path) {
+    Close();
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (f == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(f, &fileSize) || fileSize.QuadPart == 0) { CloseHandle(f); return false; }
+    HANDLE m = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!m) { CloseHandle(f); return false; }
+    data = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    if (!data) { CloseHandle(m); CloseHandle(f); return false; }
+    fileHandle = f;
+    mappingHandle = m;
+    size = (size_t)fileSize.QuadPart;
+    return true;
+}
+
+bool MappedFile::Create(const std::string& path, size_t bytes) {
+    Close();
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (f == INVALID_HANDLE_VALUE) return false;
+    const unsigned long long big = bytes;
+    HANDLE m = CreateFileMappingA(f, NULL, PAGE_READWRITE, (DWORD)(big >> 32), (DWORD)(big & 0xFFFFFFFFull), NULL);
+    if (!m) { CloseHandle(f); return false; }
+    data = MapViewOfFile(m, FILE_MAP_WRITE, 0, 0, bytes);
+    if (!data) { CloseHandle(m); CloseHandle(f); return false; }
+    fileHandle = f;
+    mappingHandle = m;
+    size = bytes;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle((HANDLE)mappingHandle);
+    if (fileHandle) CloseHandle((HANDLE)fileHandle);
+    data = nullptr;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+    size = 0;
+}
+
+#else
+
+bool MappedFile::OpenRead(const std::string& path) {
+    Close();
+    int f = open(path.c_str(), O_RDONLY);
+    if (f < 0) return false;
+    struct stat st;
+    if (fstat(f, &st) != 0 || st.st_size == 0) { close(f); return false; }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, f, 0);
+    if (p == MAP_FAILED) { close(f); return false; }
+    fd = f;
+    data = p;
+    size = (size_t)st.st_size;
+    return true;
+}
+
+bool MappedFile::Create(const std::string& path, size_t bytes) {
+    Close();
+    int f = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (f < 0) return false;
+    if (ftruncate(f, (off_t)bytes) != 0) { close(f); return false; }
+    void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, f, 0);
+    if (p == MAP_FAILED) { close(f); return false; }
+    fd = f;
+    data = p;
+    size = bytes;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data) munmap(data, size);
+    if (fd >= 0) close(fd);
+    data = nullptr;
+    fd = -1;
+    size = 0;
+}
+
+#endif
+
+// --- Lecture ---
+bool ICCacheReader::Open(uint64_t hash, size_t entryCount) {
+    count = 0;
+    if (!file.OpenRead(EntryPath(hash))) return false;
+    const CacheHeader* header = static_cast<const CacheHeader*>(file.Data());
+    if (file.Size() != EntryBytes(entryCount) || header->magic != CACHE_MAGIC || header->version != CACHE_VERSION
+        || header->hash != hash || header->count != entryCount) {
+        file.Close();
+        return false;
+    }
+    count = entryCount;
+    // Date rafraîchie : l'éviction part des entrées les moins récemment utilisées
+    std::error_code ec;
+    std::filesystem::last_write_time(EntryPath(hash), std::filesystem::file_time_type::clock::now(), ec);
+    return true;
+}
+
+const glm::vec4* ICCacheReader::Positions() const {
+    return reinterpret_cast<const glm::vec4*>(static_cast<const char*>(file.Data()) + sizeof(CacheHeader));
+}
+
+const glm::vec4* ICCacheReader::Velocities() const {
+    return Positions() + count;
+}
+
+// --- Écriture ---
+ICCacheWriter::~ICCacheWriter() {
+    Abort();
+}
+
+bool ICCacheWriter::Begin(uint64_t entryHash, size_t entryCount) {
+    std::error_code ec;
+    std::filesystem::create_directories(CACHE_DIRECTORY, ec);
+    hash = entryHash;
+    count = entryCount;
+    finalPath = EntryPath(hash);
+    tempPath = finalPath + ".tmp";
+    if (!file.Create(tempPath, EntryBytes(count))) {
+        tempPath.clear();
+        return false;
+    }
+    return true;
+}
+
+glm::vec4* ICCacheWriter::Positions() const {
+    return reinterpret_cast<glm::vec4*>(static_cast<char*>(file.Data()) + sizeof(CacheHeader));
+}
+
+glm::vec4* ICCacheWriter::Velocities() const {
+    return Positions() + count;
+}
+
+bool ICCacheWriter::Commit() {
+    if (tempPath.empty()) return false;
+    CacheHeader header = { CACHE_MAGIC, CACHE_VERSION, hash, (uint64_t)count, 0 };
+    std::memcpy(file.Data(), &header, sizeof(header));
+    file.Close();
+
+    std::error_code ec, removeError;
+    std::filesystem::rename(tempPath, finalPath, ec);
+    if (ec) std::filesystem::remove(tempPath, removeError);
+    tempPath.clear();
+    if (!ec) EvictToBudget(finalPath);
+    return !ec;
+}
+
+void ICCacheWriter::Abort() {
+    if (tempPath.empty()) return;
+    file.Close();
+    std::error_code ec;
+    std::filesystem::remove(tempPath, ec);
+    tempPath.clear();
+}
+
+bool ICCacheWrite(uint64_t hash, size_t count, const glm::vec4* positions, const glm::vec4* velocities) {
+    ICCacheWriter writer;
+    if (!writer.Begin(hash, count)) return false;
+    std::memcpy(writer.Positions(), positions, count * sizeof(glm::vec4));
+    std::memcpy(writer.Velocities(), velocities, count * sizeof(glm::vec4));
+    return writer.Commit();
+}
+
+size_t ICCacheBytes() {
+    size_t bytes = 0;
+    for (const CacheEntry& e : ListEntries()) bytes += e.bytes;
+    return bytes;
+}
+
+void ICCacheClear() {
+    // Liste d'abord, supprime ensuite : on ne modifie pas le dossier pendant son parcours
+    std::error_code ec;
+    for (const CacheEntry& e : ListEntries()) std::filesystem::remove(e.path, ec);
+}
+
+void ICCacheSetBudget(size_t bytes) {
+    diskBudget = bytes;
+    EvictToBudget(std::filesystem::path());
+}
+
+size_t ICCacheBudget() {
+    return diskBudget.load();
+}
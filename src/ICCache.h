@@ -0,0 +1,80 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// --- Cache disque des conditions initiales ---
+// Un fichier par jeu de paramètres : ic_cache/<empreinte>.ic = en-tête + positions + vitesses.
+// Les fichiers sont projetés en mémoire (mmap / MapViewOfFile) : une relecture ne coûte que
+// l'upload GPU, et l'écriture se fait directement dans les pages du fichier, sans tampon.
+// Budget disque (ICCacheSetBudget) : chaque Commit supprime les entrées les moins récemment utilisées
+// (date de modification, rafraîchie à chaque lecture) jusqu'à repasser sous le budget.
+
+// Projection d'un fichier en mémoire (lecture seule, ou lecture/écriture pour un nouveau fichier)
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool OpenRead(const std::string& path);
+    bool Create(const std::string& path, size_t size);
+    void Close();
+
+    void* Data() const { return data; }
+    size_t Size() const { return size; }
+
+private:
+    void* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+// Entrée existante et complète, projetée en lecture
+class ICCacheReader {
+public:
+    bool Open(uint64_t hash, size_t count);
+    const glm::vec4* Positions() const;
+    const glm::vec4* Velocities() const;
+    size_t Count() const { return count; }
+
+private:
+    MappedFile file;
+    size_t count = 0;
+};
+
+// Nouvelle entrée : on génère directement dans Positions()/Velocities(), puis Commit().
+// Le fichier est écrit sous un nom temporaire et renommé une fois l'en-tête posé :
+// une génération interrompue ne laisse jamais d'entrée lisible à moitié remplie.
+class ICCacheWriter {
+public:
+    ~ICCacheWriter();
+    bool Begin(uint64_t hash, size_t count);
+    glm::vec4* Positions() const;
+    glm::vec4* Velocities() const;
+    bool Commit();
+    void Abort();
+
+private:
+    MappedFile file;
+    uint64_t hash = 0;
+    size_t count = 0;
+    std::string tempPath, finalPath;
+};
+
+bool ICCacheWrite(uint64_t hash, size_t count, const glm::vec4* positions, const glm::vec4* velocities);
+
+// Taille totale des entrées sur disque, et suppression de toutes les entrées
+size_t ICCacheBytes();
+void ICCacheClear();
+
+const size_t IC_CACHE_DEFAULT_BUDGET = 4ull << 30;
+void ICCacheSetBudget(size_t bytes);
+size_t ICCacheBudget();
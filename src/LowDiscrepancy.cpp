@@ -0,0 +1,64 @@
+#include "LowDiscrepancy.h"
+
+namespace {
+
+// Polynômes primitifs et nombres de direction initiaux (Joe & Kuo), dimensions 2 à 6.
+// La dimension 1 est la suite de van der Corput en base 2.
+struct SobolPolynomial {
+    int degree;
+    uint32_t coefficients;
+    uint32_t m[4];
+};
+
+const SobolPolynomial SOBOL_POLYNOMIALS[SOBOL_DIMENSIONS - 1] = {
+    { 1, 0, { 1, 0, 0, 0 } },
+    { 2, 1, { 1, 3, 0, 0 } },
+    { 3, 1, { 1, 3, 1, 0 } },
+    { 3, 2, { 1, 1, 1, 0 } },
+    { 4, 1, { 1, 1, 3, 3 } },
+};
+
+struct SobolTable {
+    uint32_t v[SOBOL_DIMENSIONS * SOBOL_BITS];
+
+    SobolTable() {
+        for (int b = 0; b < SOBOL_BITS; b++)
+            v[b] = 1u << (31 - b);
+
+        for (int d = 1; d < SOBOL_DIMENSIONS; d++) {
+            const SobolPolynomial& poly = SOBOL_POLYNOMIALS[d - 1];
+            uint32_t* dv = v + d * SOBOL_BITS;
+            const int s = poly.degree;
+            for (int b = 0; b < s; b++)
+                dv[b] = poly.m[b] << (31 - b);
+            for (int b = s; b < SOBOL_BITS; b++) {
+                uint32_t x = dv[b - s] ^ (dv[b - s] >> s);
+                for (int k = 1; k < s; k++) {
+                    if ((poly.coefficients >> (s - 1 - k)) & 1u)
+                        x ^= dv[b - k];
+                }
+                dv[b] = x;
+            }
+        }
+    }
+};
+
+const SobolTable& Table() {
+    static const SobolTable table;
+    return table;
+}
+
+} // namespace
+
+const uint32_t* SobolDirections() {
+    return Table().v;
+}
+
+uint32_t Sobol(uint32_t index, int dim) {
+    const uint32_t* dv = Table().v + dim * SOBOL_BITS;
+    uint32_t x = 0;
+    for (int b = 0; index != 0; b++, index >>= 1) {
+        if (index & 1u) x ^= dv[b];
+    }
+    return x;
+}
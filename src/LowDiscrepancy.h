@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+
+// --- Suite quasi-aléatoire de Sobol ---
+// Nombres de direction de Joe & Kuo (new-joe-kuo-6.21201), brouillage d'Owen par hachage
+// (Burley 2020, "Practical Hash-based Owen Scrambling"). L'accès est direct par index,
+// donc le remplissage reste parallèle et déterministe comme avec Philox.
+// Points changés (table, brouillage) : IC_GENERATOR_VERSION de main.cpp, les caches en dépendent.
+
+const int SOBOL_DIMENSIONS = 6;
+const int SOBOL_BITS = 32;
+
+// Table [dim * SOBOL_BITS + bit], partagée avec le shader d'init GPU
+const uint32_t* SobolDirections();
+
+uint32_t Sobol(uint32_t index, int dim);
+
+inline uint32_t ReverseBits32(uint32_t x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+    x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Permutation de Laine-Karras appliquée aux bits inversés = brouillage d'Owen imbriqué
+inline uint32_t OwenScramble(uint32_t x, uint32_t seed) {
+    x = ReverseBits32(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return ReverseBits32(x);
+}
+
+// Point brouillé dans [0, 1) : chaque dimension a sa propre graine dérivée de seed
+inline float SobolUnit(uint32_t index, int dim, uint32_t seed) {
+    uint32_t dimSeed = seed * 0x9E3779B9u + (uint32_t)dim * 0x85EBCA6Bu;
+    uint32_t x = OwenScramble(Sobol(index, dim), dimSeed);
+    return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
@@ -0,0 +1,368 @@
+#include "Multigrid.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+inline size_t Stride(int n) { return (size_t)n + 2; }
+
+// Cellule (x, y, z) de [-1, n]³ : indice dans la grille avec fantômes
+inline size_t Index(int n, int x, int y, int z) {
+    const size_t s = Stride(n);
+    return ((size_t)(z + 1) * s + (size_t)(y + 1)) * s + (size_t)(x + 1);
+}
+
+} // namespace
+
+void MultigridSolver::Resize(int size) {
+    if (size == n) return;
+    n = size;
+    levels.clear();
+    for (int m = n;; m /= 2) {
+        Level level;
+        level.n = m;
+        // Cellule de bord à h_l / 2 du mur, erreur nulle à h / 2 au-delà : e(h_l) = e (1 - h_l / d),
+        // d = (h_l + h) / 2 ; nul sur la grille fine où les fantômes portent les valeurs imposées
+        const float ratio = (float)(n / m);
+        level.ghostFactor = m == n ? 0.0f : 1.0f - 2.0f * ratio / (ratio + 1.0f);
+        const size_t cells = Stride(m) * Stride(m) * Stride(m);
+        level.phi.assign(cells, 0.0f);
+        level.rhs.assign(cells, 0.0f);
+        level.res.assign(cells, 0.0f);
+        levels.push_back(std::move(level));
+        if (m <= COARSEST || (m & 1)) break;
+    }
+}
+
+// Appelle potentialAt(x, y, z) pour chaque cellule fantôme de la grille fine ([-1, n]³ moins [0, n)³)
+template <typename Function>
+void MultigridSolver::ForEachGhost(Function potentialAt) {
+    float* phi = levels[0].phi.data();
+    ParallelFor(0, (size_t)n + 2, 1, [&](size_t begin, size_t end) {
+        for (size_t zi = begin; zi < end; zi++) {
+            const int z = (int)zi - 1;
+            for (int y = -1; y <= n; y++) {
+                const size_t row = Index(n, 0, y, z);
+                if (z < 0 || z >= n || y < 0 || y >= n) {
+                    for (int x = -1; x <= n; x++) phi[row + x] = potentialAt(x, y, z);
+                } else {
+                    phi[row - 1] = potentialAt(-1, y, z);
+                    phi[row + n] = potentialAt(n, y, z);
+                }
+            }
+        }
+    });
+}
+
+// Φ aux cellules fantômes de la grille fine : monopôle + quadrupôle des masses de cellules autour
+// de leur centre de masse (le dipôle y est nul)
+void MultigridSolver::SetBoundary(const float* mass, float G) {
+    Level& fine = levels[0];
+    const float h = fine.h;
+    const float origin = -0.5f * h * n;    // Centre de la cellule i : origin + (i + 0.5) h
+
+    // Par plan z : M, Σ m x_i, Σ m x_i x_j (xx, yy, zz, xy, xz, yz)
+    partials.assign((size_t)n * 10, 0.0);
+    ParallelFor(0, n, 1, [&](size_t begin, size_t end) {
+        for (size_t z = begin; z < end; z++) {
+            double* p = &partials[z * 10];
+            const double pz = origin + (z + 0.5) * h;
+            for (int y = 0; y < n; y++) {
+                const double py = origin + (y + 0.5) * h;
+                const float* row = mass + (z * n + y) * n;
+                for (int x = 0; x < n; x++) {
+                    const double m = row[x];
+                    if (m == 0.0) continue;
+                    const double px = origin + (x + 0.5) * h;
+                    p[0] += m;
+                    p[1] += m * px; p[2] += m * py; p[3] += m * pz;
+                    p[4] += m * px * px; p[5] += m * py * py; p[6] += m * pz * pz;
+                    p[7] += m * px * py; p[8] += m * px * pz; p[9] += m * py * pz;
+                }
+            }
+        }
+    });
+    double s[10] = {};
+    for (int z = 0; z < n; z++)
+        for (int k = 0; k < 10; k++) s[k] += partials[(size_t)z * 10 + k];
+
+    const double M = s[0];
+    const double cx = M > 0.0 ? s[1] / M : 0.0, cy = M > 0.0 ? s[2] / M : 0.0, cz = M > 0.0 ? s[3] / M : 0.0;
+    // Moments centrés puis quadrupôle sans trace Q_ij = Σ m (3 d_i d_j - d² δ_ij)
+    const double xx = s[4] - M * cx * cx, yy = s[5] - M * cy * cy, zz = s[6] - M * cz * cz;
+    const double xy = s[7] - M * cx * cy, xz = s[8] - M * cx * cz, yz = s[9] - M * cy * cz;
+    const double trace = xx + yy + zz;
+    const double qxx = 3.0 * xx - trace, qyy = 3.0 * yy - trace, qzz = 3.0 * zz - trace;
+    const double qxy = 3.0 * xy, qxz = 3.0 * xz, qyz = 3.0 * yz;
+
+    //   Φ(d) = -G [ M / r + ½ dᵀ Q d / r⁵ ]
+    auto potentialAt = [&](int x, int y, int z) {
+        const double dx = origin + (x + 0.5) * h - cx;
+        const double dy = origin + (y + 0.5) * h - cy;
+        const double dz = origin + (z + 0.5) * h - cz;
+        const double r2 = dx * dx + dy * dy + dz * dz;
+        const double inv = 1.0 / std::sqrt(r2), inv2 = inv * inv;
+        const double quad = qxx * dx * dx + qyy * dy * dy + qzz * dz * dz +
+                            2.0 * (qxy * dx * dy + qxz * dx * dz + qyz * dy * dz);
+        return (float)(-G * inv * (M + 0.5 * quad * inv2 * inv2));
+    };
+    ForEachGhost(potentialAt);
+}
+
+// Φ aux cellules fantômes de la grille fine, interpolé dans le potentiel de la grille parente
+void MultigridSolver::SetParentBoundary(const Parent& parent) {
+    const float h = levels[0].h;
+    const float origin = -0.5f * h * n;
+    const float ph = parent.size / (float)parent.n;
+    const int last = parent.n - 1;
+    auto potentialAt = [&](int x, int y, int z) {
+        // Coordonnées dans le parent, origine au centre de sa cellule 0
+        const int cell[3] = { x, y, z };
+        int i0[3];
+        float f[3];
+        for (int a = 0; a < 3; a++) {
+            const float g = (origin + (cell[a] + 0.5f) * h - parent.offset[a]) / ph + 0.5f * parent.n - 0.5f;
+            const float c = std::min(std::max(g, 0.0f), (float)last);
+            i0[a] = std::min((int)c, last - 1);
+            f[a] = c - (float)i0[a];
+        }
+        auto at = [&](int dx, int dy, int dz) {
+            return parent.phi[((size_t)(i0[2] + dz) * parent.n + (i0[1] + dy)) * parent.n + (i0[0] + dx)];
+        };
+        const float x00 = at(0, 0, 0) + f[0] * (at(1, 0, 0) - at(0, 0, 0));
+        const float x10 = at(0, 1, 0) + f[0] * (at(1, 1, 0) - at(0, 1, 0));
+        const float x01 = at(0, 0, 1) + f[0] * (at(1, 0, 1) - at(0, 0, 1));
+        const float x11 = at(0, 1, 1) + f[0] * (at(1, 1, 1) - at(0, 1, 1));
+        const float y0 = x00 + f[1] * (x10 - x00), y1 = x01 + f[1] * (x11 - x01);
+        return y0 + f[2] * (y1 - y0);
+    };
+    ForEachGhost(potentialAt);
+}
+
+// Axe par axe, chaque passe couvrant les fantômes déjà posés par la précédente : arêtes (a²) et coins (a³)
+// sont remplis aussi, le stencil trilinéaire de Prolong les lit
+void MultigridSolver::FillGhosts(Level& level) {
+    const int m = level.n;
+    const size_t s = Stride(m), plane = s * s;
+    const float a = level.ghostFactor;
+    float* phi = level.phi.data();
+    ParallelFor(0, m, 4, [&](size_t begin, size_t end) {
+        for (size_t z = begin; z < end; z++) {
+            for (int y = 0; y < m; y++) {
+                const size_t row = Index(m, 0, y, (int)z);
+                phi[row - 1] = a * phi[row];
+                phi[row + m] = a * phi[row + m - 1];
+            }
+            for (int x = -1; x <= m; x++) {
+                const size_t first = Index(m, x, 0, (int)z), last = Index(m, x, m - 1, (int)z);
+                phi[first - s] = a * phi[first];
+                phi[last + s] = a * phi[last];
+            }
+        }
+    });
+    for (int y = -1; y <= m; y++) {
+        for (int x = -1; x <= m; x++) {
+            const size_t first = Index(m, x, y, 0), last = Index(m, x, y, m - 1);
+            phi[first - plane] = a * phi[first];
+            phi[last + plane] = a * phi[last];
+        }
+    }
+}
+
+// Gauss-Seidel rouge-noir : les cellules d'une couleur ne dépendent que de l'autre, plans z en parallèle
+void MultigridSolver::Smooth(Level& level, int sweeps) {
+    const int m = level.n;
+    const size_t s = Stride(m), plane = s * s;
+    const float h2 = level.h * level.h;
+    float* phi = level.phi.data();
+    const float* rhs = level.rhs.data();
+    const bool ghosts = level.ghostFactor != 0.0f;
+    for (int sweep = 0; sweep < sweeps; sweep++) {
+        for (int color = 0; color < 2; color++) {
+            if (ghosts) FillGhosts(level);
+            ParallelFor(0, m, 4, [&](size_t begin, size_t end) {
+                for (size_t z = begin; z < end; z++) {
+                    for (int y = 0; y < m; y++) {
+                        const size_t row = Index(m, 0, y, (int)z);
+                        for (int x = (int)((z + y + color) & 1); x < m; x += 2) {
+                            const size_t i = row + x;
+                            phi[i] = (phi[i - 1] + phi[i + 1] + phi[i - s] + phi[i + s] + phi[i - plane] +
+                                      phi[i + plane] - h2 * rhs[i]) * (1.0f / 6.0f);
+                        }
+                    }
+                }
+            });
+        }
+    }
+    if (ghosts) FillGhosts(level);   // Pour le résidu et la prolongation
+}
+
+double MultigridSolver::Residual(Level& level) {
+    const int m = level.n;
+    const size_t s = Stride(m), plane = s * s;
+    const float invH2 = 1.0f / (level.h * level.h);
+    const float* phi = level.phi.data();
+    const float* rhs = level.rhs.data();
+    float* res = level.res.data();
+    partials.assign(m, 0.0);
+    ParallelFor(0, m, 4, [&](size_t begin, size_t end) {
+        for (size_t z = begin; z < end; z++) {
+            double sum = 0.0;
+            for (int y = 0; y < m; y++) {
+                const size_t row = Index(m, 0, y, (int)z);
+                float rowSum = 0.0f;
+                for (int x = 0; x < m; x++) {
+                    const size_t i = row + x;
+                    const float laplacian = (phi[i - 1] + phi[i + 1] + phi[i - s] + phi[i + s] + phi[i - plane] +
+                                             phi[i + plane] - 6.0f * phi[i]) * invH2;
+                    const float r = rhs[i] - laplacian;
+                    res[i] = r;
+                    rowSum += r * r;
+                }
+                sum += rowSum;
+            }
+            partials[z] = sum;
+        }
+    });
+    double total = 0.0;
+    for (int z = 0; z < m; z++) total += partials[z];
+    return total;
+}
+
+// Second membre grossier = moyenne des résidus des 8 cellules filles ; l'erreur part de zéro
+void MultigridSolver::Restrict(const Level& fine, Level& coarse) {
+    const int m = coarse.n, f = fine.n;
+    const size_t s = Stride(f), plane = s * s;
+    const float* res = fine.res.data();
+    std::fill(coarse.phi.begin(), coarse.phi.end(), 0.0f);
+    ParallelFor(0, m, 4, [&](size_t begin, size_t end) {
+        for (size_t z = begin; z < end; z++) {
+            for (int y = 0; y < m; y++) {
+                float* out = &coarse.rhs[Index(m, 0, y, (int)z)];
+                const size_t row = Index(f, 0, 2 * y, 2 * (int)z);
+                for (int x = 0; x < m; x++) {
+                    const size_t i = row + 2 * x;
+                    out[x] = 0.125f * (res[i] + res[i + 1] + res[i + s] + res[i + s + 1] + res[i + plane] +
+                                       res[i + plane + 1] + res[i + plane + s] + res[i + plane + s + 1]);
+                }
+            }
+        }
+    });
+}
+
+// Correction trilinéaire : poids 3/4 pour la cellule mère, 1/4 pour sa voisine côté fille, par axe
+void MultigridSolver::Prolong(const Level& coarse, Level& fine) {
+    const int m = coarse.n, f = fine.n;
+    const ptrdiff_t s = (ptrdiff_t)Stride(m), plane = s * s;
+    const float* c = coarse.phi.data();
+    float* phi = fine.phi.data();
+    ParallelFor(0, f, 4, [&](size_t begin, size_t end) {
+        for (size_t z = begin; z < end; z++) {
+            const ptrdiff_t oz = (z & 1) ? plane : -plane;
+            for (int y = 0; y < f; y++) {
+                const ptrdiff_t oy = (y & 1) ? s : -s;
+                const size_t base = Index(m, 0, y >> 1, (int)z >> 1);
+                float* out = &phi[Index(f, 0, y, (int)z)];
+                for (int x = 0; x < f; x++) {
+                    const ptrdiff_t ox = (x & 1) ? 1 : -1;
+                    const float* p = c + base + (x >> 1);
+                    const float v = 27.0f * p[0] + 9.0f * (p[ox] + p[oy] + p[oz]) +
+                                    3.0f * (p[ox + oy] + p[ox + oz] + p[oy + oz]) + p[ox + oy + oz];
+                    out[x] += v * (1.0f / 64.0f);
+                }
+            }
+        }
+    });
+}
+
+void MultigridSolver::VCycle(size_t l) {
+    Level& level = levels[l];
+    if (l + 1 == levels.size()) {
+        Smooth(level, COARSE_SWEEPS);
+        return;
+    }
+    Smooth(level, PRE_SMOOTH);
+    Residual(level);
+    Restrict(level, levels[l + 1]);
+    VCycle(l + 1);
+    Prolong(levels[l + 1], level);
+    Smooth(level, POST_SMOOTH);
+}
+
+float MultigridSolver::SolvePotential(const float* mass, float boxSize, float G, float* potential, int maxCycles,
+                                      float tolerance) {
+    return Solve(mass, boxSize, G, NULL, potential, maxCycles, tolerance);
+}
+
+float MultigridSolver::SolveNested(const float* mass, float boxSize, float G, const float* parent, int parentRes,
+                                   float parentSize, const float* parentOffset, float* potential, int maxCycles,
+                                   float tolerance) {
+    const Parent source = { parent, parentRes, parentSize, { parentOffset[0], parentOffset[1], parentOffset[2] } };
+    return Solve(mass, boxSize, G, &source, potential, maxCycles, tolerance);
+}
+
+float MultigridSolver::Solve(const float* mass, float boxSize, float G, const Parent* parent, float* potential,
+                             int maxCycles, float tolerance) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (Level& level : levels) level.h = boxSize / (float)level.n;
+    Level& fine = levels[0];
+
+    // f = 4πG ρ,  ρ = M / h³
+    const float scale = 4.0f * 3.14159265358979f * G / (fine.h * fine.h * fine.h);
+    partials.assign(n, 0.0);
+    ParallelFor(0, n, 4, [&](size_t begin, size_t end) {
+        for (size_t z = begin; z < end; z++) {
+            double sum = 0.0;
+            for (int y = 0; y < n; y++) {
+                float* out = &fine.rhs[Index(n, 0, y, (int)z)];
+                const float* in = mass + (z * n + y) * n;
+                for (int x = 0; x < n; x++) {
+                    out[x] = scale * in[x];
+                    sum += (double)out[x] * out[x];
+                }
+            }
+            partials[z] = sum;
+        }
+    });
+    double rhs2 = 0.0;
+    for (int z = 0; z < n; z++) rhs2 += partials[z];
+
+    auto tb = std::chrono::high_resolution_clock::now();
+    if (parent) SetParentBoundary(*parent);
+    else SetBoundary(mass, G);
+    auto tb1 = std::chrono::high_resolution_clock::now();
+    stats.boundaryMs = std::chrono::duration<float, std::milli>(tb1 - tb).count();
+    stats.levels = (int)levels.size();
+    stats.cycles = 0;
+
+    if (rhs2 > 0.0) {
+        const double norm = std::sqrt(rhs2);
+        float relative = (float)(std::sqrt(Residual(fine)) / norm);
+        stats.initialResidual = relative;
+        const int limit = relative > COLD_RESIDUAL ? std::max(maxCycles, (int)COLD_CYCLES) : maxCycles;
+        while (stats.cycles < limit && relative > tolerance) {
+            VCycle(0);
+            stats.cycles++;
+            const float previous = relative;
+            relative = (float)(std::sqrt(Residual(fine)) / norm);
+            if (relative > 0.5f * previous) break;
+        }
+        stats.residual = relative;
+    } else {
+        std::fill(fine.phi.begin(), fine.phi.end(), 0.0f);
+        stats.initialResidual = stats.residual = 0.0f;
+    }
+
+    ParallelFor(0, n, 4, [&](size_t begin, size_t end) {
+        for (size_t z = begin; z < end; z++)
+            for (int y = 0; y < n; y++)
+                std::copy_n(&fine.phi[Index(n, 0, y, (int)z)], n, potential + (z * n + y) * n);
+    });
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    stats.ms = std::chrono::duration<float, std::milli>(t1 - t0).count();
+    return stats.ms;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// --- Solveur multigrille (CPU) ---
+// Poisson isolé  ∇²Φ = 4πGρ  sur la même grille n³ que PMSolver (masse CIC par cellule, potentiel aux
+// centres), avec le même laplacien à 7 points : seules les conditions aux bords changent.
+//   bords      Φ imposé sur une couche de cellules fantômes autour de la boîte, calculé par un
+//              développement multipolaire (monopôle + quadrupôle autour du centre de masse) : pas de
+//              boîtes images ni de masse moyenne retirée comme avec la FFT périodique
+//   V-cycle    Gauss-Seidel rouge-noir (PRE_SMOOTH / POST_SMOOTH balayages), restriction par moyenne
+//              des 8 cellules filles, prolongation trilinéaire, jusqu'à une grille COARSEST³
+//   démarrage  depuis le potentiel de la frame précédente, gardé entre les appels : le potentiel
+//              bouge peu d'une frame à l'autre, un ou deux cycles suffisent. Si le résidu de départ
+//              dépasse COLD_RESIDUAL (reset, changement de mode), jusqu'à COLD_CYCLES cycles.
+// Arrêt dès que ||f - AΦ|| / ||f|| < tolerance, au plus maxCycles cycles, ou quand un cycle ne divise
+// plus le résidu par 2 (plancher de l'arrondi float, ~1e-5 x n / 64).
+// Grilles emboîtées (SolveNested) : Φ aux fantômes interpolé dans le potentiel d'une grille parente qui
+// couvre la boîte, au lieu du multipôle ; la masse hors de la boîte est portée par ces valeurs.
+
+struct MultigridStats {
+    float ms = 0.0f;
+    float boundaryMs = 0.0f;        // Moments + valeurs aux bords
+    int levels = 0;
+    int cycles = 0;
+    float initialResidual = 0.0f;   // Résidu relatif avant le premier cycle
+    float residual = 0.0f;          // Après le dernier
+};
+
+class MultigridSolver {
+public:
+    static const int COARSEST = 4;
+    static const int PRE_SMOOTH = 2;
+    static const int POST_SMOOTH = 2;
+    static const int COARSE_SWEEPS = 32;
+    static const int COLD_CYCLES = 12;
+    static constexpr float COLD_RESIDUAL = 0.1f;
+
+    void Resize(int n);
+    int Size() const { return n; }
+
+    // mass et potential : n³ floats, x le plus rapide. Renvoie la durée en ms.
+    float SolvePotential(const float* mass, float boxSize, float G, float* potential, int maxCycles,
+                         float tolerance);
+
+    // Idem, bords pris dans parent : parentRes³ floats sur un cube de côté parentSize dont le centre est
+    // à parentOffset (3 floats) du centre de cette boîte, interpolation trilinéaire entre centres de cellules
+    float SolveNested(const float* mass, float boxSize, float G, const float* parent, int parentRes, float parentSize,
+                      const float* parentOffset, float* potential, int maxCycles, float tolerance);
+
+    const MultigridStats& Stats() const { return stats; }
+
+private:
+    // Grille avec une couche fantôme : (n + 2)³ floats. Sur les niveaux grossiers (équation de
+    // l'erreur), fantôme = ghostFactor x cellule voisine : extrapolation linéaire qui annule l'erreur
+    // au centre des fantômes de la grille fine, là où Φ est imposé, et non au centre des fantômes grossiers.
+    struct Parent {
+        const float* phi;
+        int n;
+        float size;
+        float offset[3];
+    };
+
+    struct Level {
+        int n = 0;
+        float h = 0.0f;
+        float ghostFactor = 0.0f;
+        std::vector<float> phi, rhs, res;
+    };
+
+    float Solve(const float* mass, float boxSize, float G, const Parent* parent, float* potential, int maxCycles,
+                float tolerance);
+    void SetBoundary(const float* mass, float G);
+    void SetParentBoundary(const Parent& parent);
+    template <typename Function> void ForEachGhost(Function potentialAt);
+    void FillGhosts(Level& level);
+    void Smooth(Level& level, int sweeps);
+    double Residual(Level& level);              // Remplit level.res, renvoie Σ res²
+    void Restrict(const Level& fine, Level& coarse);
+    void Prolong(const Level& coarse, Level& fine);
+    void VCycle(size_t l);
+
+    int n = 0;
+    std::vector<Level> levels;
+    std::vector<double> partials;               // Sommes partielles par plan z
+
+    MultigridStats stats;
+};
@@ -0,0 +1,276 @@
+#include "Octree.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int MAX_LEVEL = 21;          // 21 bits par axe -> clés de 63 bits
+const int PARALLEL_LEVEL = 2;      // Sous-arbres construits en parallèle sous les 64 cellules de niveau 2
+const size_t PARALLEL_MIN = 4096;  // En dessous, construction série complète
+const int RADIX_BITS = 11;
+const size_t RADIX_BUCKETS = (size_t)1 << RADIX_BITS;
+
+// Intercale 21 bits : b20..b0 -> b20 0 0 b19 0 0 ... b0
+inline uint64_t SpreadBits(uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffull;
+    v = (v | v << 16) & 0x1f0000ff0000ffull;
+    v = (v | v << 8)  & 0x100f00f00f00f00full;
+    v = (v | v << 4)  & 0x10c30c30c30c30c3ull;
+    v = (v | v << 2)  & 0x1249249249249249ull;
+    return v;
+}
+
+inline uint32_t CompactBits(uint64_t v) {
+    v &= 0x1249249249249249ull;
+    v = (v ^ (v >> 2))  & 0x10c30c30c30c30c3ull;
+    v = (v ^ (v >> 4))  & 0x100f00f00f00f00full;
+    v = (v ^ (v >> 8))  & 0x1f0000ff0000ffull;
+    v = (v ^ (v >> 16)) & 0x1f00000000ffffull;
+    v = (v ^ (v >> 32)) & 0x1fffff;
+    return (uint32_t)v;
+}
+
+inline uint32_t Quantize(float p, float origin, float scale) {
+    float q = (p - origin) * scale;
+    if (!(q > 0.0f)) return 0;                       // Aussi pour NaN
+    return q >= 2097151.0f ? 2097151u : (uint32_t)q;
+}
+
+inline int Octant(uint64_t key, int level) {
+    return (int)((key >> (3 * (MAX_LEVEL - 1 - level))) & 7);
+}
+
+// Masse et premier moment accumulés en double (positions ~1e3, masses ~1e-3)
+struct Moments {
+    double m = 0.0, x = 0.0, y = 0.0, z = 0.0;
+    void Add(double mass, double px, double py, double pz) { m += mass; x += mass * px; y += mass * py; z += mass * pz; }
+};
+
+} // namespace
+
+// Bornes -> clés de Morton -> tri radix LSD parallèle (stable, histogrammes par bloc) -> SoA triées
+void Octree::SortParticles(const float* positions, size_t count) {
+    const size_t blockCount = std::min<size_t>(count / 4096 + 1, (size_t)ParallelThreadCount() * 4);
+    const size_t blockSize = (count + blockCount - 1) / blockCount;
+
+    std::vector<float> bounds(blockCount * 6);
+    ParallelFor(0, blockCount, 1, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; b++) {
+            float lo[3] = { 1e30f, 1e30f, 1e30f }, hi[3] = { -1e30f, -1e30f, -1e30f };
+            for (size_t i = b * blockSize; i < std::min(count, (b + 1) * blockSize); i++) {
+                for (int a = 0; a < 3; a++) {
+                    float v = positions[4 * i + a];
+                    if (!std::isfinite(v)) continue;
+                    lo[a] = std::min(lo[a], v);
+                    hi[a] = std::max(hi[a], v);
+                }
+            }
+            for (int a = 0; a < 3; a++) { bounds[b * 6 + a] = lo[a]; bounds[b * 6 + 3 + a] = hi[a]; }
+        }
+    });
+    float lo[3] = { 1e30f, 1e30f, 1e30f }, hi[3] = { -1e30f, -1e30f, -1e30f };
+    for (size_t b = 0; b < blockCount; b++) {
+        for (int a = 0; a < 3; a++) {
+            lo[a] = std::min(lo[a], bounds[b * 6 + a]);
+            hi[a] = std::max(hi[a], bounds[b * 6 + 3 + a]);
+        }
+    }
+    if (lo[0] > hi[0]) { lo[0] = lo[1] = lo[2] = 0.0f; hi[0] = hi[1] = hi[2] = 0.0f; }
+    rootSize = std::max({ hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2] }) * 1.0001f + 1e-3f;
+    originX = lo[0]; originY = lo[1]; originZ = lo[2];
+    const float scale = 2097152.0f / rootSize;
+
+    keys.resize(count); keysTmp.resize(count);
+    order.resize(count); orderTmp.resize(count);
+    ParallelFor(0, count, 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const float* p = positions + 4 * i;
+            keys[i] = SpreadBits(Quantize(p[0], originX, scale))
+                    | SpreadBits(Quantize(p[1], originY, scale)) << 1
+                    | SpreadBits(Quantize(p[2], originZ, scale)) << 2;
+            order[i] = (uint32_t)i;
+        }
+    });
+
+    std::vector<uint32_t> histograms(blockCount * RADIX_BUCKETS);
+    for (int shift = 0; shift < 3 * MAX_LEVEL; shift += RADIX_BITS) {
+        std::fill(histograms.begin(), histograms.end(), 0u);
+        ParallelFor(0, blockCount, 1, [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; b++) {
+                uint32_t* h = &histograms[b * RADIX_BUCKETS];
+                for (size_t i = b * blockSize; i < std::min(count, (b + 1) * blockSize); i++)
+                    h[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+            }
+        });
+
+        // Chiffre commun à toutes les clés (bits de poids fort d'un nuage compact) : passe inutile
+        bool uniform = false;
+        for (size_t d = 0; d < RADIX_BUCKETS && !uniform; d++) {
+            size_t total = 0;
+            for (size_t b = 0; b < blockCount; b++) total += histograms[b * RADIX_BUCKETS + d];
+            uniform = total == count;
+        }
+        if (uniform) continue;
+
+        // Offsets : chiffre par chiffre, bloc par bloc -> tri stable
+        uint32_t running = 0;
+        for (size_t d = 0; d < RADIX_BUCKETS; d++) {
+            for (size_t b = 0; b < blockCount; b++) {
+                uint32_t c = histograms[b * RADIX_BUCKETS + d];
+                histograms[b * RADIX_BUCKETS + d] = running;
+                running += c;
+            }
+        }
+
+        ParallelFor(0, blockCount, 1, [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; b++) {
+                uint32_t* offsets = &histograms[b * RADIX_BUCKETS];
+                for (size_t i = b * blockSize; i < std::min(count, (b + 1) * blockSize); i++) {
+                    uint32_t dst = offsets[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+                    keysTmp[dst] = keys[i];
+                    orderTmp[dst] = order[i];
+                }
+            }
+        });
+        keys.swap(keysTmp);
+        order.swap(orderTmp);
+    }
+
+    px.resize(count); py.resize(count); pz.resize(count); pm.resize(count);
+    ParallelFor(0, count, 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const float* p = positions + 4 * (size_t)order[i];
+            px[i] = p[0]; py[i] = p[1]; pz[i] = p[2]; pm[i] = p[3];
+        }
+    });
+}
+
+// ranges[d] = première particule dont l'octant (au niveau level + 1) est >= d ; ranges[8] = end
+void Octree::ChildRanges(size_t begin, size_t end, int level, size_t ranges[9]) const {
+    ranges[0] = begin;
+    for (int d = 1; d < 8; d++) {
+        ranges[d] = std::partition_point(keys.begin() + ranges[d - 1], keys.begin() + end,
+                                         [&](uint64_t k) { return Octant(k, level) < d; }) - keys.begin();
+    }
+    ranges[8] = end;
+}
+
+// Centre de masse déjà rempli : cellule géométrique retrouvée depuis la clé de la première particule
+void Octree::FinishNode(Node& node, int level) const {
+    const uint64_t cell = keys[node.first] >> (3 * (MAX_LEVEL - level));
+    node.size = rootSize / (float)(1u << level);
+    node.cx = originX + ((float)CompactBits(cell) + 0.5f) * node.size;
+    node.cy = originY + ((float)CompactBits(cell >> 1) + 0.5f) * node.size;
+    node.cz = originZ + ((float)CompactBits(cell >> 2) + 0.5f) * node.size;
+    node.level = (uint16_t)level;
+    if (node.mass <= 0.0f) {
+        node.comX = node.cx; node.comY = node.cy; node.comZ = node.cz;
+    }
+}
+
+void Octree::BuildSubtree(size_t begin, size_t end, int level, std::vector<Node>& out) const {
+    const uint32_t index = (uint32_t)out.size();
+    out.emplace_back();
+
+    Node node = {};
+    node.first = (uint32_t)begin;
+    node.count = (uint32_t)(end - begin);
+    Moments moments;
+    if (end - begin <= (size_t)leafSize || level == MAX_LEVEL) {
+        node.leaf = 1;
+        for (size_t i = begin; i < end; i++) moments.Add(pm[i], px[i], py[i], pz[i]);
+    } else {
+        size_t ranges[9];
+        ChildRanges(begin, end, level, ranges);
+        for (int d = 0; d < 8; d++) {
+            if (ranges[d] == ranges[d + 1]) continue;
+            const size_t child = out.size();
+            BuildSubtree(ranges[d], ranges[d + 1], level + 1, out);
+            const Node& c = out[child];
+            moments.Add(c.mass, c.comX, c.comY, c.comZ);
+        }
+    }
+    node.mass = (float)moments.m;
+    if (moments.m > 0.0) {
+        node.comX = (float)(moments.x / moments.m);
+        node.comY = (float)(moments.y / moments.m);
+        node.comZ = (float)(moments.z / moments.m);
+    }
+    FinishNode(node, level);
+    node.next = (uint32_t)out.size();
+    out[index] = node;
+}
+
+void Octree::CollectTasks(size_t begin, size_t end, int level) {
+    if (level == PARALLEL_LEVEL) {
+        tasks.emplace_back(begin, end);
+        return;
+    }
+    size_t ranges[9];
+    ChildRanges(begin, end, level, ranges);
+    for (int d = 0; d < 8; d++)
+        if (ranges[d] < ranges[d + 1]) CollectTasks(ranges[d], ranges[d + 1], level + 1);
+}
+
+// Même parcours que CollectTasks : les sous-arbres arrivent dans l'ordre des tâches
+uint32_t Octree::AppendTop(size_t begin, size_t end, int level, size_t& nextTask) {
+    if (level == PARALLEL_LEVEL) {
+        const uint32_t offset = (uint32_t)nodes.size();
+        for (Node n : parts[nextTask++]) {
+            n.next += offset;
+            nodes.push_back(n);
+        }
+        return offset;
+    }
+
+    const uint32_t index = (uint32_t)nodes.size();
+    nodes.emplace_back();
+    size_t ranges[9];
+    ChildRanges(begin, end, level, ranges);
+    Moments moments;
+    for (int d = 0; d < 8; d++) {
+        if (ranges[d] == ranges[d + 1]) continue;
+        const uint32_t child = AppendTop(ranges[d], ranges[d + 1], level + 1, nextTask);
+        const Node& c = nodes[child];
+        moments.Add(c.mass, c.comX, c.comY, c.comZ);
+    }
+
+    Node node = {};
+    node.first = (uint32_t)begin;
+    node.count = (uint32_t)(end - begin);
+    node.mass = (float)moments.m;
+    if (moments.m > 0.0) {
+        node.comX = (float)(moments.x / moments.m);
+        node.comY = (float)(moments.y / moments.m);
+        node.comZ = (float)(moments.z / moments.m);
+    }
+    FinishNode(node, level);
+    node.next = (uint32_t)nodes.size();
+    nodes[index] = node;
+    return index;
+}
+
+void Octree::Build(const float* positions, size_t count, int leafSizeValue) {
+    leafSize = std::max(leafSizeValue, 1);
+    nodes.clear();
+    SortParticles(positions, count);
+    if (count == 0) return;
+    if (count < PARALLEL_MIN) {
+        BuildSubtree(0, count, 0, nodes);
+        return;
+    }
+    tasks.clear();
+    CollectTasks(0, count, 0);
+    parts.resize(tasks.size());
+    ParallelFor(0, tasks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            parts[t].clear();
+            BuildSubtree(tasks[t].first, tasks[t].second, PARALLEL_LEVEL, parts[t]);
+        }
+    });
+    size_t nextTask = 0;
+    AppendTop(0, count, 0, nextTask);
+}
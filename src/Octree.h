@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// --- Octree CPU partagé (Barnes-Hut, FMM) ---
+// Reconstruit à chaque pas : clés de Morton 63 bits (21 niveaux), tri radix parallèle,
+// sous-arbres construits en parallèle puis raccordés sous les deux premiers niveaux.
+// Les noeuds sont stockés en ordre DFS avec un lien "next" (fin du sous-arbre) : parcours sans pile.
+// Enfants d'un noeud interne i : i + 1, puis nodes[c].next tant que c < nodes[i].next.
+
+class Octree {
+public:
+    struct Node {
+        float comX, comY, comZ, mass;    // Centre de masse (centre géométrique si masse nulle)
+        float cx, cy, cz, size;          // Cellule géométrique
+        uint32_t next;      // Premier noeud après ce sous-arbre
+        uint32_t first;     // Plage de particules triées
+        uint32_t count;
+        uint16_t leaf;
+        uint16_t level;
+    };
+
+    // positions : count x (x, y, z, masse). Feuilles d'au plus leafSize particules.
+    void Build(const float* positions, size_t count, int leafSize);
+
+    std::vector<Node> nodes;
+
+    // Particules triées par clé de Morton (SoA)
+    std::vector<uint32_t> order;    // order[i] = indice d'origine de la i-ème particule triée
+    std::vector<float> px, py, pz, pm;
+
+private:
+    void SortParticles(const float* positions, size_t count);
+    void ChildRanges(size_t begin, size_t end, int level, size_t ranges[9]) const;
+    void BuildSubtree(size_t begin, size_t end, int level, std::vector<Node>& out) const;
+    void CollectTasks(size_t begin, size_t end, int level);
+    uint32_t AppendTop(size_t begin, size_t end, int level, size_t& nextTask);
+    void FinishNode(Node& node, int level) const;
+
+    int leafSize = 16;
+    float originX = 0.0f, originY = 0.0f, originZ = 0.0f, rootSize = 1.0f;
+
+    std::vector<uint64_t> keys, keysTmp;
+    std::vector<uint32_t> orderTmp;
+    std::vector<std::pair<size_t, size_t>> tasks;
+    std::vector<std::vector<Node>> parts;
+};
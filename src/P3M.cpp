@@ -0,0 +1,240 @@
+#include "P3M.h"
+#include "Chebyshev.h"
+#include "ForceKernel.h"
+#include "PMSolver.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const int REFERENCE_GRID = 32;      // Maillage de mesure de R(u)
+const int REFERENCE_OFFSETS = 16;   // Positions de la source dans sa cellule
+const int REFERENCE_DIRECTIONS = 64;
+
+// Interpolation trilinéaire périodique, centres des cellules en i + 0.5 (comme GL_LINEAR + GL_REPEAT)
+float SampleTrilinear(const std::vector<float>& field, int n, float x, float y, float z) {
+    const float gx = x - 0.5f, gy = y - 0.5f, gz = z - 0.5f;
+    const float bx = std::floor(gx), by = std::floor(gy), bz = std::floor(gz);
+    const float f[3] = { gx - bx, gy - by, gz - bz };
+    const int base[3] = { (int)bx, (int)by, (int)bz };
+    float value = 0.0f;
+    for (int c = 0; c < 8; c++) {
+        const int o[3] = { c & 1, (c >> 1) & 1, c >> 2 };
+        int cell[3];
+        float w = 1.0f;
+        for (int a = 0; a < 3; a++) {
+            cell[a] = ((base[a] + o[a]) % n + n) % n;
+            w *= o[a] ? f[a] : 1.0f - f[a];
+        }
+        value += w * field[((size_t)cell[2] * n + cell[1]) * n + cell[0]];
+    }
+    return value;
+}
+
+static_assert(P3MCorrection::REFERENCE_TERMS == FORCE_POLY_TERMS, "R(u) / u évalué par le noyau de ForceKernel.h");
+
+} // namespace
+
+// R(u), u = r / h : force attractive moyenne du maillage entre deux masses unité (G = 1, h = 1).
+// Source CIC à REFERENCE_OFFSETS positions aléatoires dans sa cellule, force échantillonnée comme
+// dans physicsVS dans REFERENCE_DIRECTIONS directions, aux noeuds de Tchebychev de [0, ratio].
+// Le maillage périodique retire la masse moyenne : le fond uniforme négatif (4π/3) u / n³ est rajouté.
+void P3MCorrection::BuildReference(float ratio) {
+    const int n = REFERENCE_GRID;
+    const int N = REFERENCE_TERMS;
+    const double PI = 3.14159265358979323846;
+    PMSolver solver;
+    solver.Resize(n);
+    std::vector<float> mass((size_t)n * n * n), potential(mass.size());
+
+    uint32_t state = 0x9E3779B9u;
+    auto random = [&]() {
+        state = state * 1664525u + 1013904223u;
+        return (float)(state >> 8) * (1.0f / 16777216.0f);
+    };
+
+    double radial[N] = {}, nodes[N];
+    for (int j = 0; j < N; j++) nodes[j] = 0.5 * ratio * (std::cos(PI * (j + 0.5) / N) + 1.0);
+
+    for (int k = 0; k < REFERENCE_OFFSETS; k++) {
+        const float src[3] = { n / 2 + random(), n / 2 + random(), n / 2 + random() };
+        std::fill(mass.begin(), mass.end(), 0.0f);
+        const float g[3] = { src[0] - 0.5f, src[1] - 0.5f, src[2] - 0.5f };
+        const int base[3] = { (int)std::floor(g[0]), (int)std::floor(g[1]), (int)std::floor(g[2]) };
+        for (int c = 0; c < 8; c++) {
+            const int o[3] = { c & 1, (c >> 1) & 1, c >> 2 };
+            float w = 1.0f;
+            for (int a = 0; a < 3; a++) w *= o[a] ? g[a] - base[a] : 1.0f - (g[a] - base[a]);
+            mass[((size_t)(base[2] + o[2]) * n + base[1] + o[1]) * n + base[0] + o[0]] += w;
+        }
+        solver.SolvePotential(mass.data(), (float)n, 1.0f, potential.data());
+
+        for (int d = 0; d < REFERENCE_DIRECTIONS; d++) {
+            const float cz = 2.0f * random() - 1.0f;
+            const float phi = 2.0f * (float)PI * random();
+            const float s = std::sqrt(1.0f - cz * cz);
+            const float dir[3] = { s * std::cos(phi), s * std::sin(phi), cz };
+            for (int j = 0; j < N; j++) {
+                const float p[3] = { src[0] + (float)nodes[j] * dir[0], src[1] + (float)nodes[j] * dir[1],
+                                     src[2] + (float)nodes[j] * dir[2] };
+                float attraction = 0.0f;
+                for (int a = 0; a < 3; a++) {
+                    float lo[3] = { p[0], p[1], p[2] }, hi[3] = { p[0], p[1], p[2] };
+                    lo[a] -= 1.0f;
+                    hi[a] += 1.0f;
+                    const float force = -(SampleTrilinear(potential, n, hi[0], hi[1], hi[2]) -
+                                          SampleTrilinear(potential, n, lo[0], lo[1], lo[2])) * 0.5f;
+                    attraction -= force * dir[a];
+                }
+                radial[j] += attraction;
+            }
+        }
+    }
+
+    // R(u) / u aux noeuds -> coefficients de Tchebychev -> monômes de t = 2 u / ratio - 1
+    double cheb[N] = {};
+    for (int j = 0; j < N; j++) {
+        const double u = nodes[j];
+        const double R = radial[j] / (REFERENCE_OFFSETS * REFERENCE_DIRECTIONS) + 4.0 * PI / 3.0 * u / ((double)n * n * n);
+        for (int k = 0; k < N; k++) cheb[k] += 2.0 / N * (R / u) * std::cos(k * PI * (j + 0.5) / N);
+    }
+    cheb[0] *= 0.5;
+    ChebyshevToMonomial(cheb, referencePoly);
+    referenceRatio = ratio;
+}
+
+void P3MCorrection::ComputeCorrection(const float* positions, size_t count, float worldSize, const float* center,
+                                      int gridRes, int meshRes, float G, float softening, float massThreshold,
+                                      float* accelerations) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    stats = P3MStats();
+    std::memset(accelerations, 0, count * 4 * sizeof(float));
+
+    const float meshCell = worldSize / (float)meshRes;      // h
+    const float cutoff = CUTOFF_CELLS * meshCell;           // rcut
+    if (CUTOFF_CELLS != referenceRatio) BuildReference(CUTOFF_CELLS);
+
+    // Cases de côté >= rcut : les paires à moins de rcut sont dans les 27 cases voisines
+    const int bins = std::max(1, std::min((int)(worldSize / cutoff), MAX_BINS));
+    const float binWidth = worldSize / (float)bins;
+    const float gridCell = worldSize / (float)gridRes;
+    const float binThreshold = massThreshold * std::pow(binWidth / gridCell, 3.0f);
+
+    // 1. Tri par comptage dans les cases (floor(uvw * bins))
+    const size_t cellCount = (size_t)bins * bins * bins;
+    cellOf.resize(count);
+    cellStart.assign(cellCount + 1, 0);
+    cellMass.assign(cellCount, 0.0f);
+    for (size_t i = 0; i < count; i++) {
+        const float* p = positions + 4 * i;
+        int c[3];
+        bool inside = true;
+        for (int a = 0; a < 3; a++) {
+            const float u = (p[a] - center[a]) / worldSize + 0.5f;
+            inside = inside && u >= 0.0f && u <= 1.0f;
+            c[a] = std::min((int)(u * bins), bins - 1);
+        }
+        if (!inside) {
+            cellOf[i] = UINT32_MAX;
+            continue;
+        }
+        const uint32_t cell = (uint32_t)(((size_t)c[2] * bins + c[1]) * bins + c[0]);
+        cellOf[i] = cell;
+        cellStart[cell + 1]++;
+        cellMass[cell] += p[3];
+    }
+    for (size_t c = 0; c < cellCount; c++) cellStart[c + 1] += cellStart[c];
+    const size_t binned = cellStart[cellCount];
+    sorted.resize(binned);
+    sx.resize(binned); sy.resize(binned); sz.resize(binned); sm.resize(binned);
+    {
+        std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+        for (size_t i = 0; i < count; i++) {
+            if (cellOf[i] == UINT32_MAX) continue;
+            const uint32_t k = fill[cellOf[i]]++;
+            sorted[k] = (uint32_t)i;
+            sx[k] = positions[4 * i]; sy[k] = positions[4 * i + 1]; sz[k] = positions[4 * i + 2]; sm[k] = positions[4 * i + 3];
+        }
+    }
+
+    // Cases denses, puis leurs voisines non vides : elles reçoivent la réaction des paires avec les denses
+    auto forNeighbours = [&](uint32_t cell, auto visit) {
+        const int cx = (int)(cell % bins), cy = (int)(cell / bins % bins), cz = (int)(cell / ((size_t)bins * bins));
+        for (int z = std::max(cz - 1, 0); z <= std::min(cz + 1, bins - 1); z++)
+            for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, bins - 1); y++)
+                for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, bins - 1); x++)
+                    visit((uint32_t)(((size_t)z * bins + y) * bins + x));
+    };
+    cellState.assign(cellCount, 0);
+    active.clear();
+    for (size_t c = 0; c < cellCount; c++) {
+        if (cellMass[c] > binThreshold && cellStart[c + 1] > cellStart[c]) {
+            cellState[c] = 2;
+            active.push_back((uint32_t)c);
+        }
+    }
+    const size_t denseCells = active.size();
+    for (size_t k = 0; k < denseCells; k++) {
+        forNeighbours(active[k], [&](uint32_t c) {
+            if (cellState[c] == 0 && cellStart[c + 1] > cellStart[c]) {
+                cellState[c] = 1;
+                active.push_back(c);
+            }
+        });
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    // 2. Somme directe corrigée, chaque case rassemble sur ses propres particules (pas d'écriture
+    // concurrente) : une case dense prend toutes ses voisines comme sources, une voisine seulement les
+    // cases denses. Chaque paire (dense, voisine) est ainsi évaluée des deux côtés.
+    // Noyau SIMD (ForceKernel.h) : m [ (r² + ε²)^(-3/2) - (R(u) / u) / h³ ] pour r < rcut, R(u) / u
+    // polynôme en t = 2 r / rcut - 1  (R(u) / (r h²) = (R(u) / u) / h³)
+    const ForceKernel kernel = SelectForceKernel(FACTOR_P3M, DetectSimdLevel());
+    ForceParams params;
+    params.eps2 = softening * softening;
+    params.tScale = 2.0f / cutoff;
+    params.meshScale = 1.0f / (meshCell * meshCell * meshCell);
+    params.poly = referencePoly;
+    std::atomic<uint64_t> pairs{0}, targets{0};
+    ParallelFor(0, active.size(), 1, [&](size_t begin, size_t end) {
+        std::vector<float> lx, ly, lz, lm;
+        uint64_t localPairs = 0, localTargets = 0;
+        for (size_t ai = begin; ai < end; ai++) {
+            const uint32_t cell = active[ai];
+            const bool dense = cellState[cell] == 2;
+            lx.clear(); ly.clear(); lz.clear(); lm.clear();
+            forNeighbours(cell, [&](uint32_t c) {
+                if (!dense && cellState[c] != 2) return;
+                const uint32_t from = cellStart[c], to = cellStart[c + 1];
+                lx.insert(lx.end(), sx.begin() + from, sx.begin() + to);
+                ly.insert(ly.end(), sy.begin() + from, sy.begin() + to);
+                lz.insert(lz.end(), sz.begin() + from, sz.begin() + to);
+                lm.insert(lm.end(), sm.begin() + from, sm.begin() + to);
+            });
+            const size_t listSize = lx.size();
+            const size_t first = cellStart[cell], last = cellStart[cell + 1];
+            EvaluateTargets(kernel, sx.data(), sy.data(), sz.data(), first, last, lx.data(), ly.data(), lz.data(),
+                            lm.data(), listSize, params, [&](size_t i, float fx, float fy, float fz) {
+                                float* a = accelerations + 4 * (size_t)sorted[i];
+                                a[0] = G * fx; a[1] = G * fy; a[2] = G * fz;
+                            });
+            localPairs += (uint64_t)listSize * (last - first);
+            localTargets += last - first;
+        }
+        pairs += localPairs;
+        targets += localTargets;
+    });
+
+    auto t2 = std::chrono::high_resolution_clock::now();
+    stats.binMs = std::chrono::duration<float, std::milli>(t1 - t0).count();
+    stats.pairMs = std::chrono::duration<float, std::milli>(t2 - t1).count();
+    stats.activeCells = denseCells;
+    stats.activeParticles = (size_t)targets.load();
+    stats.pairsPerParticle = targets ? (double)pairs.load() / (double)targets.load() : 0.0;
+}
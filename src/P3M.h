@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --- Correction P3M (particle-particle / particle-mesh, CPU) ---
+// Le maillage PM lisse la force sous ~2 cellules : des particules entassées dans une même cellule
+// ne s'attirent presque plus. Somme directe adoucie sur les paires à moins de rcut, moins la force que
+// le maillage donne déjà pour la même paire :
+//   a = G m d [ 1 / (r² + ε²)^(3/2) - R(r / h) / (r h²) ]   pour r < rcut = CUTOFF_CELLS x h
+// R(u) : force de paire moyenne du maillage (dépôt CIC, Green 7 points, différences centrées
+// interpolées), mesurée sur un petit maillage périodique puis ajustée par un polynôme en r. Elle vaut
+// 45 % de la force newtonienne à u = 1, 99 % à u = 2 et 99.8 % à u = 2.5 : pas de saut à rcut.
+// Particules rangées (tri par comptage) dans des cases de côté >= rcut, 27 cases voisines par cible.
+// Une paire est corrigée des deux côtés dès qu'une de ses deux cases est dense (masse au-dessus du
+// seuil) : les voisines peu denses reçoivent la réaction, la quantité de mouvement est conservée.
+// Hors des amas la correction est nulle : le coût suit le nombre de particules des cases denses.
+
+struct P3MStats {
+    float binMs = 0.0f;                   // Tri des particules par cellule
+    float pairMs = 0.0f;                  // Sommes directes
+    size_t activeCells = 0;               // Cases denses
+    size_t activeParticles = 0;           // Particules corrigées (cases denses et leurs voisines)
+    double pairsPerParticle = 0.0;        // Par particule corrigée
+};
+
+class P3MCorrection {
+public:
+    static const int REFERENCE_TERMS = 12;  // Polynôme de R(u) / u sur [0, rcut / h]
+    static constexpr float CUTOFF_CELLS = 2.5f;   // rcut / h
+    static constexpr int MAX_BINS = 128;    // Cases par axe au plus
+
+    // positions : count x (x, y, z, masse) ; accelerations : count x (ax, ay, az, 0), ordre d'origine,
+    // nulles pour les particules hors des cases corrigées. Maillage PM meshRes³ sur le cube de côté
+    // worldSize centré sur center (3 floats). massThreshold : masse d'une cellule de la grille gridRes³
+    // (celle de densityGS), ramenée au volume des cases.
+    void ComputeCorrection(const float* positions, size_t count, float worldSize, const float* center, int gridRes,
+                           int meshRes, float G, float softening, float massThreshold, float* accelerations);
+
+    const P3MStats& Stats() const { return stats; }
+
+private:
+    void BuildReference(float ratio);
+
+    float referenceRatio = 0.0f;            // rcut / h de la table en cache
+    float referencePoly[REFERENCE_TERMS] = {};
+
+    std::vector<uint32_t> cellOf;           // Case de chaque particule (UINT32_MAX : hors boîte)
+    std::vector<uint32_t> cellStart;        // bins³ + 1 débuts de plage
+    std::vector<uint32_t> sorted;           // Indice d'origine, ordre des cellules
+    std::vector<float> sx, sy, sz, sm;      // Particules triées (SoA)
+    std::vector<float> cellMass;
+    std::vector<uint8_t> cellState;         // 2 : dense, 1 : voisine d'une case dense, 0 : non corrigée
+    std::vector<uint32_t> active;           // Cases denses puis leurs voisines
+
+    P3MStats stats;
+};
@@ -0,0 +1,138 @@
+#include "PMSolver.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+void PMSolver::Resize(int size) {
+    if (size == n) return;
+    n = size;
+    splitGreenCells = 0.0f;
+    paddedFFT.reset();
+    std::vector<Complex>().swap(paddedSpectrum);
+    std::vector<float>().swap(isolatedGreen);
+    fft.reset(new FFT3D(n));
+    spectrum.assign(fft->HalfSpectrumSize(), Complex(0.0f, 0.0f));
+
+    // Φ_k = -4πG ρ_k / K²,  K² = (4/h²) Σ sin²(π m / n),  ρ_k = M_k / h³
+    //     = -πG M_k / (h Σ sin²)  : seul le facteur sans dimension est tabulé ici
+    const size_t N = (size_t)n;
+    const size_t rowWidth = N / 2 + 1;
+    green.assign(spectrum.size(), 0.0f);
+    const double PI = 3.14159265358979323846;
+    for (size_t z = 0; z < N; z++) {
+        for (size_t y = 0; y < N; y++) {
+            for (size_t x = 0; x < rowWidth; x++) {
+                double sx = std::sin(PI * fft->Frequency((int)x) / n);
+                double sy = std::sin(PI * fft->Frequency((int)y) / n);
+                double sz = std::sin(PI * fft->Frequency((int)z) / n);
+                double s = sx * sx + sy * sy + sz * sz;
+                green[(z * N + y) * rowWidth + x] = s > 0.0 ? (float)(-PI / s) : 0.0f;
+            }
+        }
+    }
+}
+
+float PMSolver::SolvePotential(const float* mass, float boxSize, float G, float* potential, float splitCells) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    const bool split = splitCells > 0.0f;
+    if (split && splitCells != splitGreenCells) {
+        // k r_s = 2π m r_s / (n h) ; W_CIC = Π sinc²(π m / n) par axe, appliquée au dépôt et à l'interpolation
+        const size_t N = (size_t)n;
+        const size_t rowWidth = N / 2 + 1;
+        const double PI = 3.14159265358979323846;
+        splitGreen.resize(green.size());
+        auto sinc = [&](int m) { double a = PI * m / n; return m == 0 ? 1.0 : std::sin(a) / a; };
+        ParallelFor(0, N, 1, [&](size_t begin, size_t end) {
+            for (size_t z = begin; z < end; z++) {
+                for (size_t y = 0; y < N; y++) {
+                    for (size_t x = 0; x < rowWidth; x++) {
+                        const int m[3] = { fft->Frequency((int)x), fft->Frequency((int)y), fft->Frequency((int)z) };
+                        double kr2 = 0.0, window = 1.0;
+                        for (int a = 0; a < 3; a++) {
+                            const double kr = 2.0 * PI * m[a] * splitCells / n;
+                            const double s = sinc(m[a]);
+                            kr2 += kr * kr;
+                            window *= s * s;
+                        }
+                        const size_t i = (z * N + y) * rowWidth + x;
+                        splitGreen[i] = (float)(green[i] * std::exp(-kr2) / (window * window));
+                    }
+                }
+            }
+        });
+        splitGreenCells = splitCells;
+    }
+    const std::vector<float>& table = split ? splitGreen : green;
+
+    fft->ForwardReal(mass, spectrum.data());
+
+    const float cellSize = boxSize / (float)n;
+    const float scale = G / (cellSize * (float)n * (float)n * (float)n); // 1/n³ : normalisation de l'inverse
+    ParallelFor(0, spectrum.size(), 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) spectrum[i] *= table[i] * scale;
+    });
+
+    fft->InverseReal(spectrum.data(), potential);
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<float, std::milli>(t1 - t0).count();
+}
+
+// Noyau en unités de cellules, g(r) = -h/r : le potentiel d'une masse M est (G M / h) g. Distances
+// repliées (min(i, 2n - i)) pour que la convolution circulaire sur 2n soit la convolution libre sur n.
+// À l'origine et aux 6 voisines, valeurs exactes du laplacien discret à 7 points (1/r y est infini, puis
+// 8 % trop faible) : -4π W / 2 avec W = 0.505462 (intégrale de Watson), et la voisine à 4π/6 près.
+void PMSolver::BuildIsolatedGreen() {
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    const size_t N = 2 * (size_t)n;
+    paddedFFT.reset(new FFT3D((int)N));
+    paddedSpectrum.assign(paddedFFT->HalfSpectrumSize(), Complex(0.0f, 0.0f));
+
+    const double PI = 3.14159265358979323846;
+    const double origin = 4.0 * PI * 0.252731;
+    const double face = 4.0 * PI * (0.252731 - 1.0 / 6.0);
+    std::vector<float> kernel(N * N * N);
+    ParallelFor(0, N, 1, [&](size_t begin, size_t end) {
+        for (size_t z = begin; z < end; z++) {
+            const double dz = (double)std::min(z, N - z);
+            for (size_t y = 0; y < N; y++) {
+                const double dy = (double)std::min(y, N - y);
+                for (size_t x = 0; x < N; x++) {
+                    const double dx = (double)std::min(x, N - x);
+                    const double r2 = dx * dx + dy * dy + dz * dz;
+                    kernel[(z * N + y) * N + x] = (float)(r2 == 0.0 ? -origin : r2 == 1.0 ? -face : -1.0 / std::sqrt(r2));
+                }
+            }
+        }
+    });
+
+    paddedFFT->ForwardReal(kernel.data(), paddedSpectrum.data());
+    isolatedGreen.resize(paddedSpectrum.size());
+    for (size_t i = 0; i < isolatedGreen.size(); i++) isolatedGreen[i] = paddedSpectrum[i].real();
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    isolatedGreenMs = std::chrono::duration<float, std::milli>(t1 - t0).count();
+}
+
+float PMSolver::SolveIsolated(const float* mass, float boxSize, float G, float* potential) {
+    if (!paddedFFT) BuildIsolatedGreen();
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    paddedFFT->ForwardRealPadded(mass, paddedSpectrum.data());
+
+    const float cellSize = boxSize / (float)n;
+    const float N = 2.0f * (float)n;
+    const float scale = G / (cellSize * N * N * N);   // 1/(2n)³ : normalisation de l'inverse
+    ParallelFor(0, paddedSpectrum.size(), 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) paddedSpectrum[i] *= isolatedGreen[i] * scale;
+    });
+
+    paddedFFT->InverseRealCropped(paddedSpectrum.data(), potential);
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<float, std::milli>(t1 - t0).count();
+}
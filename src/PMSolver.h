@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "FFT.h"
+
+// --- Solveur particle-mesh (CPU) ---
+// Résout le Poisson périodique  ∇²Φ = 4πGρ  sur une grille n³ couvrant une boîte de côté boxSize.
+// Entrée : masse par cellule (dépôt CIC fait sur GPU), sortie : potentiel aux centres des cellules.
+// Fonction de Green du laplacien discret à 7 points (Hockney & Eastwood) : cohérente avec les
+// différences centrées faites ensuite dans physicsVS, et sans le mode k = 0 (masse moyenne retirée).
+// TreePM : avec splitCells = r_s / h > 0, seule la partie longue portée est gardée (filtre gaussien
+// exp(-k² r_s²), complément de BarnesHutSolver::SetShortRange) et la fenêtre CIC du dépôt et de
+// l'interpolation est déconvoluée, pour que la somme des deux parties reste newtonienne.
+// Bords isolés (SolveIsolated, Hockney & Eastwood) : masse placée dans un coin d'une grille (2n)³ remplie
+// de zéros, convoluée par -G/r (distances repliées sur la grille doublée, donc sans boîte image dans
+// la zone utile), puis recadrée sur n³. La transformée du noyau est calculée une fois par résolution ;
+// les lignes et plans nuls de l'entrée et les parties inutiles de la sortie ne sont pas transformés.
+
+class PMSolver {
+public:
+    static const int MAX_ISOLATED = 128;   // Grille doublée 256³ : demi-spectre de 67 Mo (540 Mo pour n = 256)
+
+    void Resize(int n);
+    int Size() const { return n; }
+
+    // mass et potential : n³ floats, x le plus rapide. Renvoie la durée en ms.
+    float SolvePotential(const float* mass, float boxSize, float G, float* potential, float splitCells = 0.0f);
+
+    // Idem en bords isolés, n <= MAX_ISOLATED. Le premier appel après Resize construit le noyau.
+    float SolveIsolated(const float* mass, float boxSize, float G, float* potential);
+    float IsolatedGreenMs() const { return isolatedGreenMs; }   // Coût de la construction du noyau
+
+private:
+    void BuildIsolatedGreen();
+
+    int n = 0;
+    std::unique_ptr<FFT3D> fft;
+    std::vector<Complex> spectrum;   // Demi-spectre (n/2 + 1) x n x n
+    std::vector<float> green;        // -π / Σ sin²(π m / n), même disposition que spectrum
+    std::vector<float> splitGreen;   // green x exp(-k² r_s²) / W_CIC², recalculé si splitCells change
+    float splitGreenCells = 0.0f;
+
+    std::unique_ptr<FFT3D> paddedFFT;      // Taille 2n, créée au premier SolveIsolated
+    std::vector<Complex> paddedSpectrum;   // Demi-spectre (n + 1) x 2n x 2n
+    std::vector<float> isolatedGreen;      // Transformée de -h/r, réelle (noyau pair), même disposition
+    float isolatedGreenMs = 0.0f;
+};
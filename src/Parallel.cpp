@@ -0,0 +1,136 @@
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct ParallelJob {
+    const std::function<void(size_t, size_t)>* body;
+    size_t begin, end, grain;
+    size_t chunkCount;
+    std::atomic<size_t> nextChunk{0};
+    std::atomic<size_t> doneChunks{0};
+    int activeWorkers = 0; // protégé par le mutex du pool
+};
+
+class ThreadPool {
+public:
+    ThreadPool() {
+        unsigned int n = std::thread::hardware_concurrency();
+        if (n == 0) n = 1;
+        // Le thread appelant travaille aussi : n-1 workers suffisent
+        for (unsigned int i = 1; i < n; i++)
+            workers.emplace_back([this] { WorkerLoop(); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers) t.join();
+    }
+
+    unsigned int ThreadCount() const { return (unsigned int)workers.size() + 1; }
+
+    void Run(ParallelJob& job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(&job);
+        }
+        wake.notify_all();
+
+        // L'appelant consomme ses propres blocs : pas d'attente passive si le pool est occupé ailleurs
+        while (RunOneChunk(job)) {}
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.erase(std::find(jobs.begin(), jobs.end(), &job));
+        }
+        // Plus aucun worker ne peut prendre ce job : on attend ceux qui l'ont déjà pris
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return job.activeWorkers == 0 && job.doneChunks.load() == job.chunkCount; });
+    }
+
+private:
+    bool RunOneChunk(ParallelJob& job) {
+        size_t c = job.nextChunk.fetch_add(1);
+        if (c >= job.chunkCount) return false;
+        size_t b = job.begin + c * job.grain;
+        size_t e = std::min(job.end, b + job.grain);
+        (*job.body)(b, e);
+        job.doneChunks.fetch_add(1);
+        return true;
+    }
+
+    void WorkerLoop() {
+        for (;;) {
+            ParallelJob* job = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] {
+                    if (stopping) return true;
+                    for (ParallelJob* j : jobs)
+                        if (j->nextChunk.load() < j->chunkCount) return true;
+                    return false;
+                });
+                if (stopping) return;
+                for (ParallelJob* j : jobs) {
+                    if (j->nextChunk.load() < j->chunkCount) { job = j; break; }
+                }
+                if (!job) continue;
+                job->activeWorkers++;
+            }
+            while (RunOneChunk(*job)) {}
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                job->activeWorkers--;
+            }
+            done.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::deque<ParallelJob*> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    bool stopping = false;
+};
+
+ThreadPool& Pool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+} // namespace
+
+unsigned int ParallelThreadCount() {
+    return Pool().ThreadCount();
+}
+
+void ParallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body) {
+    if (end <= begin) return;
+    if (grain == 0) grain = 1;
+
+    size_t chunkCount = (end - begin + grain - 1) / grain;
+    if (chunkCount == 1 || ParallelThreadCount() == 1) {
+        body(begin, end);
+        return;
+    }
+
+    ParallelJob job;
+    job.body = &body;
+    job.begin = begin;
+    job.end = end;
+    job.grain = grain;
+    job.chunkCount = chunkCount;
+    Pool().Run(job);
+}
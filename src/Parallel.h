@@ -0,0 +1,13 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+// --- Pool de threads minimal ---
+// ParallelFor découpe [begin, end) en blocs de taille "grain" et les distribue
+// sur tous les coeurs. Le thread appelant participe au travail.
+// Plusieurs ParallelFor peuvent tourner en même temps (ex: thread de rendu + thread de génération),
+// et un appel imbriqué depuis un worker ne bloque pas le pool.
+
+unsigned int ParallelThreadCount();
+
+void ParallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body);
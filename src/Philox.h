@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+
+// --- Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3") ---
+// Générateur "counter-based" : la sortie ne dépend que de (compteur, clé).
+// Chaque particule tire ses nombres avec compteur = {index, flux, 0, 0} et clé = seed,
+// donc le résultat est identique quel que soit le découpage entre threads.
+
+struct Philox4x32 {
+    uint32_t v[4];
+};
+
+inline void PhiloxMulHiLo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo) {
+    uint64_t p = (uint64_t)a * (uint64_t)b;
+    hi = (uint32_t)(p >> 32);
+    lo = (uint32_t)p;
+}
+
+inline Philox4x32 Philox4x32_10(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint32_t k0, uint32_t k1) {
+    const uint32_t M0 = 0xD2511F53u, M1 = 0xCD9E8D57u;
+    const uint32_t W0 = 0x9E3779B9u, W1 = 0xBB67AE85u;
+    for (int round = 0; round < 10; round++) {
+        uint32_t hi0, lo0, hi1, lo1;
+        PhiloxMulHiLo(M0, c0, hi0, lo0);
+        PhiloxMulHiLo(M1, c2, hi1, lo1);
+        uint32_t n0 = hi1 ^ c1 ^ k0;
+        uint32_t n2 = hi0 ^ c3 ^ k1;
+        c0 = n0; c1 = lo1; c2 = n2; c3 = lo0;
+        k0 += W0; k1 += W1;
+    }
+    return { { c0, c1, c2, c3 } };
+}
+
+// 24 bits de mantisse -> float uniforme dans [0, 1)
+inline float PhiloxToUnit(uint32_t x) {
+    return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+// Accès pratique : 4 floats uniformes pour (index, flux) sous une seed donnée
+struct PhiloxStream {
+    uint32_t seed;
+    uint32_t index;
+
+    void Uniform4(uint32_t stream, float out[4]) const {
+        Philox4x32 r = Philox4x32_10(index, stream, 0u, 0u, seed, 0x5EED5EEDu);
+        for (int k = 0; k < 4; k++) out[k] = PhiloxToUnit(r.v[k]);
+    }
+};
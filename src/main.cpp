@@ -8,19 +8,41 @@
 #include <vector>
 #include <cmath>
 #include <cstdlib>
-#include <ctime>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <map>
 #include <string>
+#include <thread>
+
+#include "BarnesHut.h"
+#include "DirectSum.h"
+#include "FMM.h"
+#include "CosmoIC.h"
+#include "GalaxyModels.h"
+#include "GPUPoisson.h"
+#include "GPUTree.h"
+#include "ICCache.h"
+#include "P3M.h"
+#include "Multigrid.h"
+#include "PMSolver.h"
+#include "LowDiscrepancy.h"
+#include "Parallel.h"
+#include "Philox.h"
 
 // --- Paramètres Globaux ---
-const unsigned int PARTICLE_COUNT = 1000000;
+unsigned int particleCount = 1000000;   // Particules simulées et dessinées (contenu valide des VBOs)
+unsigned int targetParticleCount = 1000000;  // Nombre visé par la prochaine génération (--particles N ou l'UI)
+unsigned int particleCapacity = 0;      // Taille allouée des VBOs (croissance géométrique)
 const int WINDOW_WIDTH = 1280;
 const int WINDOW_HEIGHT = 720;
 const int GRID_RES = 128;       // Grille 3D 128x128x128 = 2M cellules. Pour la VRAM, on fait gaffe. 64³ c'est mieux si lourd. Essayons 64 ou 96.
 // 3D Texture of 128^3 floats (RGB) ~ 8MB * 3 = 24MB. C'est OK.
 // Mais le compute shader de remplissage peut être lourd.
 const int GRID_RES_3D = 64; 
-const float WORLD_SIZE = 3000.0f; // Taille du monde simulé pour la grille
+const float WORLD_SIZE = 3000.0f; // Boîte de départ des grilles (la boîte adaptative la remplace ensuite)
 
 // --- Post-Processing Bloom ---
 GLuint hdrFBO;
@@ -50,6 +72,25 @@ float frictionStrength = 4.0f;       // Friction pour aider l'agglomération
 float initialRotation = 0.2f;      // Rotation faible pour effondrement chaotique
 float dispersion = 1200.0f;
 float galaxyThickness = 50.0f; // Epaisseur initiale
+int simSeed = 12345;           // Seed des conditions initiales (reproductible)
+
+// Modèle de conditions initiales
+enum InitialConditionModel {
+    IC_LEGACY_DISK = 0,   // Disque uniforme + vitesse orbitale ad-hoc (historique)
+    IC_EQUILIBRIUM = 1,   // Disque exponentiel + bulbe Hernquist + halo NFW à l'équilibre
+    IC_COSMOLOGICAL = 2   // Boîte cosmologique : réseau déplacé par Zel'dovich (gridSize³ particules)
+};
+int icModel = IC_LEGACY_DISK;
+GalaxyModelParams galaxyParams;
+CosmologyParams cosmoParams;
+bool quasiRandomSampling = false; // Positions initiales par suite de Sobol (rayon, angle, hauteur)
+float lastInitMs = 0.0f;       // Durée de la dernière génération CPU
+GLuint initTimerQuery = 0;     // Temps GPU de la dernière génération GPU / composition de scène, en vol
+bool initTimerPending = false; // Résultat pas encore relu ; une génération CPU ou un chargement l'annule
+float initTimerCpuMs = 0.0f;
+bool icDiskCache = true;       // Conditions initiales gardées dans ic_cache/ (projetées en mémoire au reset)
+bool lastInitFromCache = false;
+size_t icCacheBytes = 0;
 
 // --- Camera 3D / FPS Mode ---
 bool fpsMode = false;
@@ -63,7 +104,7 @@ float lastY = WINDOW_HEIGHT / 2.0f;
 bool firstMouse = true;
 
 // --- Buffers GPU ---
-// Nous utilisons vec4 pour position (x,y,z,w) et vitesse (vx,vy,vz,w) pour alignement facile
+// Nous utilisons vec4 pour position (x,y,z,masse) et vitesse (vx,vy,vz,w) pour alignement facile
 GLuint posVBO[2]; 
 GLuint velVBO[2]; 
 GLuint VAO[2];    // Vertex Array Objects pour lier ces buffers
@@ -76,6 +117,147 @@ GLuint densityFBO;
 GLuint densityTex;
 GLuint densityProgram;
 
+// Champs par cellule, calculés une fois par frame et lus en une seule fois par particule dans physicsVS
+GLuint fieldFBO;
+GLuint fieldTex;                   // RGBA32F, grille de densityTex : gradient de masse (xyz)
+GLuint fieldProgram;
+GLuint meshFieldFBO = 0;
+GLuint meshFieldTex = 0;           // RGBA32F, grille du maillage PM : -∇Φ (xyz)
+GLuint meshFieldProgram;
+int meshFieldRes = 0;
+
+// Pyramide de masse : GRID_RES_3D³ -> 4³ (en dessous, la liste d'interaction est vide)
+const int MIP_LEVELS = 5;
+GLuint mipMomentTex = 0;           // RGBA32F, MIP_LEVELS niveaux ; niveau 0 : second attachement de densityFBO
+GLuint mipAccelTex = 0;            // RGBA32F GRID_RES_3D³ : accélération, lue par physicsVS
+GLuint mipMomentFBO[MIP_LEVELS] = {};
+GLuint mipAccelFBO = 0;
+GLuint mipMomentProgram = 0, mipAccelProgram = 0;
+
+// --- Boîte de simulation adaptative ---
+// Toutes les grilles (densityGS, dépôt PM, pyramide, P3M) couvrent un cube de côté gridSize centré sur
+// gridCenter. Tous les boxUpdateInterval pas, deux réductions GPU sur posVBO (blending additif dans une
+// cible BOX_BINS x 2) : centre de masse, puis histogramme de la masse en fonction de la distance au centre
+// (norme max, échelle log). Le cube couvre boxCoverage de la masse, agrandi de boxMargin ; hors du cube,
+// physicsVS remplace la grille par le monopôle de toute la masse.
+const int BOX_BINS = 256;
+const float BOX_BINS_PER_OCTAVE = 16.0f;   // Pas de 4.4 % en rayon, de 1 à 2^16 unités
+const float BOX_SHRINK = 0.8f;             // Hystérésis : la boîte ne rétrécit que sous 80 % de sa taille
+bool adaptiveBox = true;
+int boxUpdateInterval = 16;
+float boxCoverage = 0.999f;
+float boxMargin = 1.1f;
+glm::vec3 gridCenter(0.0f);
+float gridSize = WORLD_SIZE;
+glm::vec4 boxMassCenter(0.0f);     // Centre de masse et masse totale de la dernière réduction (w = 0 : pas de monopôle)
+int boxUpdateCountdown = 0;        // Pas avant la prochaine réduction (0 : au prochain pas, après un reset)
+float boxOutsideFraction = 0.0f;   // Masse hors de la boîte à la dernière réduction (à un pas d'histogramme près)
+float lastBoxMs = 0.0f;
+GLuint boxFBO = 0, boxTex = 0, boxProgram = 0;
+
+// --- Grilles emboîtées (zoom, GRAVITY_MULTIGRID) ---
+// Jusqu'à MAX_NESTED grilles à la résolution du maillage PM, chacune de côté moitié de sa parente, centrée
+// sur la cellule la plus dense de la parente (ou sur nestedPoint), alignée sur ses cellules. Chacune résout
+// le Poisson de la masse qu'elle contient, Φ aux bords interpolé dans le potentiel parent ; physicsVS lit
+// l'accélération de la plus fine qui contient la particule à NESTED_MARGIN cellules du bord.
+const int MAX_NESTED = 4;
+const int NESTED_MARGIN = 2;
+struct NestedGrid {
+    glm::vec3 center = glm::vec3(0.0f);
+    float size = 0.0f;
+    int res = 0;
+    GLuint massTex = 0, potentialTex = 0, fieldTex = 0;
+    GLuint massFBO = 0, fieldFBO = 0;
+    MultigridSolver solver;            // Potentiel gardé entre les frames (démarrage à chaud)
+    std::vector<float> mass, potential;
+};
+NestedGrid nestedGrids[MAX_NESTED];
+int nestedLevels = 0;              // 0 : maillage seul
+int activeNested = 0;              // Grilles calculées à cette frame, lues par physicsVS
+bool nestedOnDensest = true;       // Sinon centrées sur nestedPoint
+glm::vec3 nestedPoint(0.0f);
+float lastNestedMs = 0.0f;
+
+// --- Raffinement adaptatif par briques (AMR) de la grille de densité ---
+// densityTex est découpée en AMR_BRICKS³ briques de AMR_BRICK³ cellules. Toute brique qui contient plus de
+// amrThreshold particules (comptées sur GPU tous les amrRegridInterval pas) reçoit une brique fille deux
+// fois plus fine, rangée dans un pool : atlas 3D de AMR_POOL_X x AMR_POOL_Y x AMR_POOL_Z emplacements.
+// brickTableTex donne l'emplacement de chaque brique (-1 : non raffinée). Dépôt, gradient de masse et
+// lectures de physicsVS (gravité historique, friction) suivent la table : la mémoire et le calcul
+// suivent la masse, pas le volume de la boîte. Les briques les plus peuplées passent en premier.
+const int AMR_BRICK = 8;
+const int AMR_BRICKS = GRID_RES_3D / AMR_BRICK;
+const int AMR_FINE = 2 * AMR_BRICK;        // Cellules par axe d'une brique raffinée
+const int AMR_POOL_X = 8, AMR_POOL_Y = 8, AMR_POOL_Z = 4;
+const int AMR_SLOTS = AMR_POOL_X * AMR_POOL_Y * AMR_POOL_Z;
+bool amrEnabled = false;
+int amrThreshold = 32768;          // Particules par brique : ~8 par cellule fine, sinon le bruit de comptage domine
+int amrRegridInterval = 8;
+int amrCountdown = 0;              // Pas avant le prochain comptage (0 : au prochain pas)
+int amrUsedSlots = 0;
+size_t amrRefinedParticles = 0;    // Particules dans les briques raffinées au dernier comptage
+float lastAmrMs = 0.0f;
+GLuint brickCountTex = 0, brickCountFBO = 0;   // R32F AMR_BRICKS³ : particules par brique
+GLuint brickTableTex = 0;                      // R32I AMR_BRICKS³ : emplacement dans le pool
+GLuint slotBrickTex = 0;                       // RGBA32I 1D AMR_SLOTS : brique de chaque emplacement
+GLuint poolTex = 0, poolFieldTex = 0;          // RGBA32F atlas : masse + quantité de mouvement, gradient
+GLuint poolFBO = 0, poolFieldFBO = 0;
+GLuint brickCountProgram = 0, amrDepositProgram = 0, amrFieldProgram = 0;
+
+// --- Gravité ---
+enum GravitySolver {
+    GRAVITY_DENSITY_GRADIENT = 0,  // Gradient de la masse brute de densityTex (historique, force locale)
+    GRAVITY_PM_CPU = 1,            // Particle-mesh : dépôt CIC sur GPU, Poisson par FFT sur CPU
+    GRAVITY_PM_GPU = 2,            // Particle-mesh entièrement GPU (compute shaders, contexte 4.3)
+    GRAVITY_BARNES_HUT = 3,        // Octree Barnes-Hut sur CPU : résolution limitée par l'adoucissement, pas par une grille
+    GRAVITY_GPU_TREE = 4,          // Arbre radix (Karras) construit et parcouru sur GPU (compute shaders, contexte 4.3)
+    GRAVITY_FMM = 5,               // Multipôles rapides sur CPU : O(N), pour les runs de plusieurs millions de particules
+    GRAVITY_TREEPM = 6,            // PM filtré (longue portée) + Barnes-Hut tronqué à quelques cellules (courte portée)
+    GRAVITY_DIRECT = 7,            // Somme directe O(N²) SIMD : exacte, pour N <= ~100k
+    GRAVITY_MULTIGRID = 8,         // Particle-mesh isolé : V-cycles multigrille sur CPU, repartant du potentiel précédent
+    GRAVITY_MIP_PYRAMID = 9,       // Pyramide de masse GPU (GL 3.3) : champ lointain par les niveaux grossiers, sans Poisson
+    GRAVITY_PM_ISOLATED = 10       // Particle-mesh isolé : FFT sur la grille doublée complétée de zéros (Hockney & Eastwood)
+};
+int gravitySolver = GRAVITY_DENSITY_GRADIENT;
+float gravityConstant = 1.0f;      // G, mêmes unités que le trou noir et les modèles de galaxie
+int pmGridRes = 64;                // Résolution du maillage PM (64, 128 ou 256)
+int pmAllocatedRes = 0;
+GLuint pmFBO = 0;
+GLuint pmMassTex = 0;              // R32F : masse CIC par cellule
+GLuint pmPotentialTex = 0;         // R32F : potentiel, lu par physicsVS
+GLuint pmDepositProgram;
+PMSolver pmSolver;
+MultigridSolver multigrid;         // Alloué au premier usage : 3 grilles (n + 2)³
+int mgMaxCycles = 2;               // V-cycles par frame au plus (le résidu baisse d'environ x10 par cycle)
+float mgTolerance = 1.0e-3f;       // Résidu relatif visé
+std::vector<float> pmMass, pmPotential;
+GPUPoissonSolver gpuPoisson;
+GLuint gpuSolveQuery = 0;          // GL_TIME_ELAPSED du solveur GPU, lu sans bloquer à la frame suivante
+bool gpuSolveQueryPending = false;
+BarnesHutSolver barnesHut;
+float treeTheta = 0.6f;            // Angle d'ouverture : erreur relative ~θ², coût ~1/θ³
+float treeSoftening = 4.0f;        // Adoucissement de Plummer (unités monde)
+FMMSolver fmm;
+int fmmOrder = 6;                  // Ordre des développements (1..FMMSolver::MAX_ORDER)
+float fmmTheta = 0.8f;             // θ = 1 : sphères tangentes, l'erreur ne diminue plus avec l'ordre
+const float BARNES_HUT_RATE = 0.3e6f; // Particules/s par coeur à θ = 0.6 (mesure de BarnesHut.h)
+const float FMM_RATE = 0.3e6f;        // Particules/s par coeur à p = 6, θ = 0.8 (mesure de FMM.h)
+std::vector<float> treePositions, treeAccelerations;
+GLuint treeAccBuffer = 0;          // vec4 par particule, lu par physicsVS via treeAccTex (texture buffer)
+GLuint treeAccTex = 0;
+GPUTreeSolver gpuTree;
+float treePMSplit = 1.25f;         // r_s du découpage TreePM, en cellules du maillage PM (rcut = 4.5 r_s)
+P3MCorrection p3m;
+DirectSumSolver directSum;
+const size_t ACCURACY_SAMPLES = 1024;  // Particules comparées à la somme directe
+float accuracyRms = -1.0f;         // Erreur relative de la dernière mesure (< 0 : pas encore mesurée)
+float accuracyMedian = 0.0f, accuracyMax = 0.0f, accuracyMs = 0.0f;
+bool p3mEnabled = false;           // Correction particule-particule des modes PM dans les cellules denses
+float p3mMassThreshold = 20.0f;    // Masse minimale d'une cellule de densityGS (seuil en densité, ramené aux cases P3M)
+float lastGravityMs = 0.0f;        // Dépôt + relecture + FFT + upload
+float lastMeshMs = 0.0f;           // Partie PM seule (TreePM)
+float lastSolveMs = 0.0f;          // FFT seule
+
 // Indices pour le ping-pong
 unsigned int currIdx = 0;
 unsigned int nextIdx = 1;
@@ -83,43 +265,153 @@ unsigned int nextIdx = 1;
 // --- Shaders ---
 GLuint physicsProgram;
 GLuint renderProgram;
+GLuint initProgram;   // Génération GPU des conditions initiales (Transform Feedback)
+GLuint initVAO;       // VAO vide : le shader d'init n'a pas d'attributs, seulement gl_VertexID
+bool gpuInitialConditions = true;
+GLuint sceneProgram;  // Instanciation des gabarits de galaxie (Transform Feedback)
+GLuint sceneTF;       // TF dédié : chaque galaxie écrit dans sa propre plage des VBOs
 
 // --- Initialisation des Données ---
+// Instantané des paramètres de génération : le thread de génération ne lit jamais les globales de l'UI
+struct InitialConditionSettings {
+    int model;
+    uint32_t seed;
+    size_t count;
+    bool quasiRandom;
+    float dispersion;
+    float galaxyThickness;
+    float initialRotation;
+    float blackHoleMass;
+    GalaxyModelParams galaxy;
+    CosmologyParams cosmology;
+};
+
+InitialConditionSettings CaptureInitialConditions() {
+    InitialConditionSettings ic;
+    ic.model = icModel;
+    ic.seed = (uint32_t)simSeed;
+    ic.count = targetParticleCount;
+    ic.quasiRandom = quasiRandomSampling;
+    ic.dispersion = dispersion;
+    ic.galaxyThickness = galaxyThickness;
+    ic.initialRotation = initialRotation;
+    ic.blackHoleMass = blackHoleMass;
+    ic.galaxy = galaxyParams;
+    ic.galaxy.blackHoleMass = blackHoleMass;
+    ic.cosmology = cosmoParams;
+    return ic;
+}
+
+// Version des générateurs, mêlée à l'empreinte : les fichiers de ic_cache/ écrits par une version
+// antérieure ne sont plus retrouvés. À incrémenter à chaque changement de sortie d'InitParticlesCPU,
+// GalaxyModels, CosmoIC, LowDiscrepancy, Philox ou FFT (mêmes paramètres, autres particules).
+const uint32_t IC_GENERATOR_VERSION = 1;
+
+// Empreinte FNV-1a des paramètres qui influencent réellement le résultat du modèle choisi
+uint64_t HashInitialConditions(const InitialConditionSettings& ic) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    auto mix = [&h](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            h ^= bytes[i];
+            h *= 0x100000001b3ull;
+        }
+    };
+    const uint64_t count = ic.count;
+    const uint32_t flags = ic.quasiRandom ? 1u : 0u;
+    mix(&IC_GENERATOR_VERSION, sizeof(IC_GENERATOR_VERSION));
+    mix(&ic.model, sizeof(ic.model));
+    mix(&ic.seed, sizeof(ic.seed));
+    mix(&count, sizeof(count));
+    mix(&flags, sizeof(flags));
+    if (ic.model == IC_EQUILIBRIUM) {
+        const GalaxyModelParams& g = ic.galaxy;
+        const float fields[] = { g.diskMass, g.diskScaleLength, g.diskScaleHeight, g.toomreQ,
+                                 g.bulgeMass, g.bulgeScale, g.haloMass, g.haloScale, g.haloConcentration,
+                                 g.bulgeParticleMassRatio, g.haloParticleMassRatio, g.blackHoleMass };
+        mix(fields, sizeof(fields));
+    } else if (ic.model == IC_COSMOLOGICAL) {
+        const CosmologyParams& c = ic.cosmology;
+        const float fields[] = { (float)c.gridSize, c.boxSize, c.boxMpc, c.sigma8, c.redshift,
+                                 c.spectralIndex, c.shapeGamma, c.particleMass, c.velocityScale };
+        mix(fields, sizeof(fields));
+    } else {
+        const float fields[] = { ic.dispersion, ic.galaxyThickness, ic.initialRotation, ic.blackHoleMass };
+        mix(fields, sizeof(fields));
+    }
+    return h;
+}
+
 // Passage en vec4 pour la 3D (x,y,z, padding)
-void InitParticlesCPU(std::vector<glm::vec4>& positions, std::vector<glm::vec4>& velocities) {
-    positions.resize(PARTICLE_COUNT);
-    velocities.resize(PARTICLE_COUNT);
-    
-    std::srand(static_cast<unsigned int>(std::time(0)));
+// Écrit ic.count particules dans positions/velocities (mémoire hôte ou buffer GL mappé), renvoie la durée en ms
+float InitParticlesCPU(const InitialConditionSettings& ic, glm::vec4* positions, glm::vec4* velocities) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    if (ic.model == IC_EQUILIBRIUM) {
+        GalaxyModel model(ic.galaxy);
+        model.Generate(ic.seed, positions, velocities, ic.count, ic.quasiRandom);
+    } else if (ic.model == IC_COSMOLOGICAL) {
+        GenerateCosmologicalBox(ic.cosmology, ic.seed, positions, velocities, ic.count);
+    } else {
+        // Philox : chaque particule a ses propres nombres (compteur = index), donc
+        // le résultat est bit-identique quel que soit le nombre de threads.
+        ParallelFor(0, ic.count, 16384, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                PhiloxStream rng = { ic.seed, (uint32_t)i };
+                float u[4], n[4];
+                rng.Uniform4(0, u);
+                rng.Uniform4(1, n);
+                if (ic.quasiRandom) {
+                    // Sobol sur (angle, rayon, hauteur) : le bruit de grenaille de la grille de densité baisse fortement
+                    for (int d = 0; d < 3; d++) u[d] = SobolUnit((uint32_t)i, d, ic.seed);
+                }
 
-    for (unsigned int i = 0; i < PARTICLE_COUNT; i++) {
-        // Disque d'accrétion initial
-        float angle = (float)(rand() % 360) * 3.14159f / 180.0f;
-        // Distribution
-        float r = dispersion * sqrt((rand() % 10000) / 10000.0f); 
+                // Disque d'accrétion initial
+                float angle = u[0] * 2.0f * 3.14159f;
+                // Distribution
+                float r = ic.dispersion * std::sqrt(u[1]);
 
-        // Position 3D : X, Y sur le disque, Z pour l'épaisseur (Gaussienne approx)
-        float z = ((rand() % 2000) / 1000.0f - 1.0f) * galaxyThickness * (1.0f - r/dispersion); // Plus fin au bord ? ou inverse ? Disons uniforme pour l'instant
-        
-        positions[i] = glm::vec4(cos(angle) * r, sin(angle) * r, z * 2.0f, 1.0f);
+                // Position 3D : X, Y sur le disque, Z pour l'épaisseur (Gaussienne approx)
+                float z = (u[2] * 2.0f - 1.0f) * ic.galaxyThickness * (1.0f - r/ic.dispersion); // Plus fin au bord ? ou inverse ? Disons uniforme pour l'instant
 
-        // Vitesse : Rotation perpendiculaire pour l'orbite
-        float dist = r + 1.0f;
-        
-        float orbitalSpeed = 0.0f;
-        if(blackHoleMass > 1.0f) {
-           orbitalSpeed = sqrt(blackHoleMass / dist) * initialRotation;
-        } else {
-           orbitalSpeed = r * 0.005f * initialRotation; 
-        }
+                positions[i] = glm::vec4(std::cos(angle) * r, std::sin(angle) * r, z * 2.0f, 1.0f);
 
-        glm::vec2 tangent = {-sin(angle), cos(angle)};
-        velocities[i] = glm::vec4(tangent.x * orbitalSpeed, tangent.y * orbitalSpeed, 0.0f, 0.0f);
-        
-        // Bruit 3D
-        velocities[i].x += ((rand()%100)/100.0f - 0.5f) * 2.0f; 
-        velocities[i].y += ((rand()%100)/100.0f - 0.5f) * 2.0f;
-        velocities[i].z += ((rand()%100)/100.0f - 0.5f) * 0.5f; // Petite vitesse verticale
+                // Vitesse : Rotation perpendiculaire pour l'orbite
+                float dist = r + 1.0f;
+
+                float orbitalSpeed = 0.0f;
+                if(ic.blackHoleMass > 1.0f) {
+                   orbitalSpeed = std::sqrt(ic.blackHoleMass / dist) * ic.initialRotation;
+                } else {
+                   orbitalSpeed = r * 0.005f * ic.initialRotation;
+                }
+
+                glm::vec2 tangent = {-std::sin(angle), std::cos(angle)};
+                glm::vec4 vel(tangent.x * orbitalSpeed, tangent.y * orbitalSpeed, 0.0f, 0.0f);
+
+                // Bruit 3D
+                vel.x += (n[0] - 0.5f) * 2.0f;
+                vel.y += (n[1] - 0.5f) * 2.0f;
+                vel.z += (n[2] - 0.5f) * 0.5f; // Petite vitesse verticale
+                velocities[i] = vel;
+            }
+        });
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<float, std::milli>(t1 - t0).count();
+}
+
+void InitParticlesCPU(std::vector<glm::vec4>& positions, std::vector<glm::vec4>& velocities) {
+    InitialConditionSettings ic = CaptureInitialConditions();
+    positions.resize(ic.count);
+    velocities.resize(ic.count);
+    lastInitMs = InitParticlesCPU(ic, positions.data(), velocities.data());
+    initTimerPending = false;
+    lastInitFromCache = false;
+    if (icDiskCache) {
+        ICCacheWrite(HashInitialConditions(ic), ic.count, positions.data(), velocities.data());
+        icCacheBytes = ICCacheBytes();
     }
 }
 
@@ -153,13 +445,16 @@ layout (points, max_vertices = 1) out;
 
 in vec4 vVel[];
 out vec4 gVel; // Pass to FS
+flat out float gMass; // Masse de la particule (pos.w)
+flat out vec3 gOffset; // Position relative au centre de la cellule (moments de la pyramide de masse)
 
 uniform mat4 projection; // Ortho 3D ? Non, juste mapping coords
 uniform float worldSize;
+uniform vec3 gridCenter;
 uniform int gridRes;
 
 void main() {
-    vec3 pos = gl_in[0].gl_Position.xyz;
+    vec3 pos = gl_in[0].gl_Position.xyz - gridCenter;
     
     // Map world pos to grid coords [0, 1]
     vec3 uvw = (pos / worldSize) + 0.5;
@@ -179,6 +474,9 @@ void main() {
         gl_PointSize = 1.0; ; // 1 pixel = 1 cellule
         
         gVel = vVel[0];
+        gMass = gl_in[0].gl_Position.w;
+        vec3 cell = min(floor(uvw * float(gridRes)), vec3(gridRes - 1));
+        gOffset = pos - ((cell + 0.5) / float(gridRes) - 0.5) * worldSize;
         EmitVertex();
         EndPrimitive();
     }
@@ -188,13 +486,360 @@ void main() {
 const char* densityFS = R"(
 #version 330 core
 in vec4 gVel;
-out vec4 FragColor;
+flat in float gMass;
+flat in vec3 gOffset;
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 MomentColor; // Pyramide de masse seulement (sinon pas de draw buffer)
 
 void main() {
     // R = Masse, G = Momentum X, B = Momentum Y, A = Momentum Z
     // On n'utilise pas alpha blending classique mais ADD blending
-    float mass = 1.0;
+    float mass = gMass;
     FragColor = vec4(mass, gVel.xyz * mass);
+    MomentColor = vec4(gOffset * mass, mass);
+}
+)";
+
+// Dépôt Cloud-In-Cell pour le solveur particle-mesh : chaque particule répartit sa masse sur
+// les 8 cellules voisines (un point par cellule, chacun sur sa couche). Bords périodiques ou ouverts.
+const char* pmDepositGS = R"(
+#version 330 core
+layout (points) in;
+layout (points, max_vertices = 8) out;
+
+flat out float gWeight;
+
+uniform float worldSize;
+uniform vec3 gridCenter;
+uniform int gridRes;
+uniform bool periodic;            // Sinon (potentiel isolé, grille emboîtée) : poids hors de la grille perdus
+
+void main() {
+    vec4 p = gl_in[0].gl_Position;
+    vec3 uvw = ((p.xyz - gridCenter) / worldSize) + 0.5;
+    bool inside = all(greaterThanEqual(uvw, vec3(0.0))) && all(lessThan(uvw, vec3(1.0)));
+    if (periodic ? !inside : any(lessThan(uvw, vec3(-1.0 / float(gridRes)))) ||
+                             any(greaterThan(uvw, vec3(1.0 + 1.0 / float(gridRes))))) return;
+
+    // Coordonnées en cellules, origine au centre de la cellule 0 (comme l'échantillonnage GL_LINEAR)
+    vec3 g = uvw * float(gridRes) - 0.5;
+    vec3 base = floor(g);
+    vec3 f = g - base;
+
+    for (int c = 0; c < 8; c++) {
+        ivec3 o = ivec3(c & 1, (c >> 1) & 1, c >> 2);
+        ivec3 cell = ivec3(base) + o;
+        if (periodic) cell = (cell + gridRes) % gridRes;
+        else if (any(lessThan(cell, ivec3(0))) || any(greaterThanEqual(cell, ivec3(gridRes)))) continue;
+        vec3 w = mix(1.0 - f, f, vec3(o));
+
+        gl_Layer = cell.z;
+        gl_Position = vec4((vec2(cell.xy) + 0.5) / float(gridRes) * 2.0 - 1.0, 0.0, 1.0);
+        gl_PointSize = 1.0;
+        gWeight = p.w * w.x * w.y * w.z;
+        EmitVertex();
+        EndPrimitive();
+    }
+}
+)";
+
+const char* pmDepositFS = R"(
+#version 330 core
+flat in float gWeight;
+out vec4 FragColor;
+
+void main() {
+    FragColor = vec4(gWeight, 0.0, 0.0, 0.0);
+}
+)";
+
+// Passes par cellule : un point par couche (gl_PrimitiveIDIn), étendu en quad couvrant la couche.
+// Différences centrées par texelFetch aux centres des cellules : leur interpolation trilinéaire dans
+// physicsVS donne la même force que les différences centrées des lectures trilinéaires d'avant.
+const char* fieldVS = R"(
+#version 330 core
+void main() {
+    gl_Position = vec4(0.0);
+}
+)";
+
+const char* fieldGS = R"(
+#version 330 core
+layout (points) in;
+layout (triangle_strip, max_vertices = 4) out;
+
+flat out int gLayer;
+
+void main() {
+    for (int i = 0; i < 4; i++) {
+        gl_Layer = gl_PrimitiveIDIn;
+        gLayer = gl_PrimitiveIDIn;
+        gl_Position = vec4(float(i & 1) * 2.0 - 1.0, float(i >> 1) * 2.0 - 1.0, 0.0, 1.0);
+        EmitVertex();
+    }
+    EndPrimitive();
+}
+)";
+
+// Grille de densité : gradient de masse, multiplié par selfGravityStrength (ramené à la boîte) dans physicsVS
+const char* fieldFS = R"(
+#version 330 core
+flat in int gLayer;
+layout (location = 0) out vec4 outField;
+
+uniform sampler3D gridTex;
+
+float Mass(ivec3 c, ivec3 last) {
+    return texelFetch(gridTex, clamp(c, ivec3(0), last), 0).r;
+}
+
+void main() {
+    ivec3 c = ivec3(ivec2(gl_FragCoord.xy), gLayer);
+    ivec3 last = textureSize(gridTex, 0) - 1;
+
+    float L = Mass(c - ivec3(1, 0, 0), last);
+    float R = Mass(c + ivec3(1, 0, 0), last);
+    float D = Mass(c - ivec3(0, 1, 0), last);
+    float U = Mass(c + ivec3(0, 1, 0), last);
+    float B = Mass(c - ivec3(0, 0, 1), last);
+    float F = Mass(c + ivec3(0, 0, 1), last);
+    outField = vec4(R - L, U - D, F - B, 0.0);
+}
+)";
+
+// --- AMR ---
+// Comptage des particules par brique : un point par particule dans la couche de sa brique
+const char* brickCountGS = R"(
+#version 330 core
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+uniform float worldSize;
+uniform vec3 gridCenter;
+uniform int bricks;
+
+void main() {
+    vec3 uvw = (gl_in[0].gl_Position.xyz - gridCenter) / worldSize + 0.5;
+    if (any(lessThan(uvw, vec3(0.0))) || any(greaterThanEqual(uvw, vec3(1.0)))) return;
+    ivec3 b = ivec3(uvw * float(bricks));
+    gl_Layer = b.z;
+    gl_Position = vec4((vec2(b.xy) + 0.5) / float(bricks) * 2.0 - 1.0, 0.0, 1.0);
+    gl_PointSize = 1.0;
+    EmitVertex();
+    EndPrimitive();
+}
+)";
+
+const char* brickCountFS = R"(
+#version 330 core
+out vec4 FragColor;
+
+void main() {
+    FragColor = vec4(1.0);
+}
+)";
+
+// Dépôt dans les briques raffinées (même densityFS que la grille de base) ; les autres particules sont ignorées
+const char* amrDepositGS = R"(
+#version 330 core
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+in vec4 vVel[];
+out vec4 gVel;
+flat out float gMass;
+flat out vec3 gOffset;
+
+uniform float worldSize;
+uniform vec3 gridCenter;
+uniform int fineRes;              // Résolution de la grille entièrement raffinée (2 x gridRes)
+uniform int fineBrick;
+uniform ivec3 poolSlots;
+uniform isampler3D brickTable;
+
+ivec3 SlotOrigin(int slot) {
+    return ivec3(slot % poolSlots.x, (slot / poolSlots.x) % poolSlots.y, slot / (poolSlots.x * poolSlots.y)) * fineBrick;
+}
+
+void main() {
+    vec3 uvw = (gl_in[0].gl_Position.xyz - gridCenter) / worldSize + 0.5;
+    if (any(lessThan(uvw, vec3(0.0))) || any(greaterThanEqual(uvw, vec3(1.0)))) return;
+    ivec3 f = min(ivec3(uvw * float(fineRes)), ivec3(fineRes - 1));
+    ivec3 brick = f / fineBrick;
+    int slot = texelFetch(brickTable, brick, 0).r;
+    if (slot < 0) return;
+
+    ivec3 cell = SlotOrigin(slot) + f - brick * fineBrick;
+    gl_Layer = cell.z;
+    gl_Position = vec4((vec2(cell.xy) + 0.5) / vec2(poolSlots.xy * fineBrick) * 2.0 - 1.0, 0.0, 1.0);
+    gl_PointSize = 1.0;
+    gVel = vVel[0];
+    gMass = gl_in[0].gl_Position.w;
+    gOffset = vec3(0.0);
+    EmitVertex();
+    EndPrimitive();
+}
+)";
+
+// Gradient de masse des briques raffinées, aux unités de fieldFS : masse équivalente d'une cellule de base
+// (x 8) sur un pas moitié (x 2). Voisines hors de la brique : brique voisine raffinée ou cellule de base / 8.
+const char* amrFieldFS = R"(
+#version 330 core
+flat in int gLayer;
+layout (location = 0) out vec4 outField;
+
+uniform sampler3D gridTex;
+uniform sampler3D poolTex;
+uniform isampler3D brickTable;
+uniform isampler1D slotBricks;
+uniform int usedSlots;
+uniform int fineRes;
+uniform int fineBrick;
+uniform ivec3 poolSlots;
+
+ivec3 SlotOrigin(int slot) {
+    return ivec3(slot % poolSlots.x, (slot / poolSlots.x) % poolSlots.y, slot / (poolSlots.x * poolSlots.y)) * fineBrick;
+}
+
+float FineMass(ivec3 f) {
+    f = clamp(f, ivec3(0), ivec3(fineRes - 1));
+    ivec3 brick = f / fineBrick;
+    int slot = texelFetch(brickTable, brick, 0).r;
+    if (slot < 0) return texelFetch(gridTex, f / 2, 0).r * 0.125;
+    return texelFetch(poolTex, SlotOrigin(slot) + f - brick * fineBrick, 0).r;
+}
+
+void main() {
+    ivec3 c = ivec3(ivec2(gl_FragCoord.xy), gLayer);
+    ivec3 s = c / fineBrick;
+    int slot = s.x + poolSlots.x * (s.y + poolSlots.y * s.z);
+    if (slot >= usedSlots) {
+        outField = vec4(0.0);
+        return;
+    }
+    ivec3 f = texelFetch(slotBricks, slot, 0).xyz * fineBrick + c - s * fineBrick;
+
+    float L = FineMass(f - ivec3(1, 0, 0));
+    float R = FineMass(f + ivec3(1, 0, 0));
+    float D = FineMass(f - ivec3(0, 1, 0));
+    float U = FineMass(f + ivec3(0, 1, 0));
+    float B = FineMass(f - ivec3(0, 0, 1));
+    float F = FineMass(f + ivec3(0, 0, 1));
+    outField = vec4(16.0 * vec3(R - L, U - D, F - B), 0.0);
+}
+)";
+
+// Maillage PM : -∇Φ par cellule, avec les mêmes bords que le potentiel (périodiques ou bloqués)
+const char* meshFieldFS = R"(
+#version 330 core
+flat in int gLayer;
+layout (location = 0) out vec4 outField;
+
+uniform sampler3D potentialTex;
+uniform float cellSize;
+uniform bool periodic;
+
+float Potential(ivec3 c, int n) {
+    c = periodic ? (c + n) % n : clamp(c, ivec3(0), ivec3(n - 1));
+    return texelFetch(potentialTex, c, 0).r;
+}
+
+void main() {
+    ivec3 c = ivec3(ivec2(gl_FragCoord.xy), gLayer);
+    int n = textureSize(potentialTex, 0).x;
+
+    float L = Potential(c - ivec3(1, 0, 0), n);
+    float R = Potential(c + ivec3(1, 0, 0), n);
+    float D = Potential(c - ivec3(0, 1, 0), n);
+    float U = Potential(c + ivec3(0, 1, 0), n);
+    float B = Potential(c - ivec3(0, 0, 1), n);
+    float F = Potential(c + ivec3(0, 0, 1), n);
+    outField = vec4(-vec3(R - L, U - D, F - B) / (2.0 * cellSize), 0.0);
+}
+)";
+
+// Pyramide de masse : (Σ m (x - centre), Σ m) par cellule, relatifs au centre pour garder la précision
+// float sur les niveaux grossiers. Niveau l = somme des 8 cellules filles : la masse est conservée.
+// Niveaux de mipmap d'une seule texture ; pendant la passe du niveau l, seul l - 1 est échantillonnable
+// (GL_TEXTURE_BASE_LEVEL = MAX_LEVEL = l - 1, texelFetch relatif au niveau de base) : pas de boucle de rétroaction.
+const char* mipMomentFS = R"(
+#version 330 core
+flat in int gLayer;
+layout (location = 0) out vec4 outMoment;
+
+uniform sampler3D fineTex;
+uniform float fineCellSize;
+
+void main() {
+    ivec3 c = ivec3(ivec2(gl_FragCoord.xy), gLayer);
+    vec4 sum = vec4(0.0);
+    for (int i = 0; i < 8; i++) {
+        ivec3 o = ivec3(i & 1, (i >> 1) & 1, i >> 2);
+        vec4 m = texelFetch(fineTex, 2 * c + o, 0);
+        // Centre de la fille - centre de la mère = (o - 0.5) x largeur fine
+        sum += vec4(m.xyz + m.w * (vec3(o) - 0.5) * fineCellSize, m.w);
+    }
+    outMoment = sum;
+}
+)";
+
+// Accélération au centre de chaque cellule du niveau 0, comme un FMM monopolaire sur grille : pour chaque
+// niveau l, l'ancêtre a de la cellule reçoit sa liste d'interaction (filles des voisins du parent de a qui
+// ne sont pas voisines de a, 6³ - 3³ cellules), évaluée directement au centre de la cellule fine. Au
+// niveau 0 les 27 voisines s'ajoutent, adoucies à l'échelle de la cellule (résolution d'un PM de même grille).
+// Monopôles au centre de masse ; interpoler les champs partiels des niveaux grossiers mélangerait des
+// listes différentes, d'où l'évaluation directe (~1000 lectures par cellule, cellules vides sautées).
+const char* mipAccelFS = R"(
+#version 330 core
+flat in int gLayer;
+layout (location = 0) out vec4 outAccel;
+
+uniform sampler3D momentTex;
+uniform int levels;
+uniform float worldSize;
+uniform float G;
+uniform float softening2;
+
+void main() {
+    ivec3 c = ivec3(ivec2(gl_FragCoord.xy), gLayer);
+    int n0 = textureSize(momentTex, 0).x;
+    float h0 = worldSize / float(n0);
+
+    // Aucune masse à moins d'une cellule : aucune particule n'interpole ce texel
+    ivec3 lo = max(c - 1, ivec3(0)) / 2, hi = min(c + 1, ivec3(n0 - 1)) / 2;
+    float nearby = 0.0;
+    for (int z = lo.z; z <= hi.z; z++)
+        for (int y = lo.y; y <= hi.y; y++)
+            for (int x = lo.x; x <= hi.x; x++) nearby += texelFetch(momentTex, ivec3(x, y, z), 1).w;
+    if (nearby <= 0.0) {
+        outAccel = vec4(0.0);
+        return;
+    }
+
+    vec3 acc = vec3(0.0);
+    for (int l = 0; l < levels; l++) {
+        int n = n0 >> l;
+        float h = worldSize / float(n);
+        ivec3 a = c >> l;
+        vec3 target = (vec3(c) + 0.5) * h0 - (vec3(a) + 0.5) * h;    // Relatif au centre de a
+        ivec3 first = max((a / 2) * 2 - 2, ivec3(0));
+        ivec3 last = min((a / 2) * 2 + 3, ivec3(n - 1));
+        for (int z = first.z; z <= last.z; z++) {
+            for (int y = first.y; y <= last.y; y++) {
+                for (int x = first.x; x <= last.x; x++) {
+                    ivec3 j = ivec3(x, y, z);
+                    bool neighbor = all(lessThanEqual(abs(j - a), ivec3(1)));
+                    if (neighbor && l > 0) continue;
+                    vec4 m = texelFetch(momentTex, j, l);
+                    if (m.w <= 0.0) continue;
+                    vec3 d = vec3(j - a) * h + m.xyz / m.w - target;
+                    float r2 = dot(d, d) + (neighbor ? softening2 : 0.0);
+                    acc += G * m.w * d * inversesqrt(r2) / r2;
+                }
+            }
+        }
+    }
+    outAccel = vec4(acc, 0.0);
 }
 )";
 
@@ -209,29 +854,75 @@ out vec4 outVel;
 
 uniform float dt;
 uniform float blackHoleMass;
-uniform sampler3D gridTex; // 3D Texture
+uniform sampler3D gridTex;        // Masse et quantité de mouvement par cellule (friction)
+uniform sampler3D fieldTex;       // Gradient de masse par cellule de gridTex (fieldFS)
 uniform float worldSize;
+uniform vec3 gridCenter;
+uniform vec4 boxMassCenter;       // Centre de masse et masse totale (boîte adaptative), w = 0 : pas de monopôle
+uniform float gravityConstant;
 uniform float selfGravityStrength;
 uniform float frictionStrength;
-uniform float gridRes; 
+uniform float frictionMassScale;  // (WORLD_SIZE / worldSize)³ : masse par cellule ramenée à la boîte d'origine
+uniform int gravityMode;          // 0 : gradient de densité (historique), bit 1 : potentiel particle-mesh, bit 2 : arbre,
+                                  // bit 4 : accélération précalculée par cellule (meshFieldTex : PM ou pyramide de masse)
+uniform sampler3D potentialTex;   // Φ aux centres des cellules (périodique)
+uniform sampler3D meshFieldTex;   // Accélération aux centres des cellules (meshFieldFS ou mipAccelFS)
+uniform float meshRes;
+uniform samplerBuffer treeAccTex; // Accélération calculée par l'arbre pour chaque particule (bit 2)
+uniform int nestedLevels;         // Grilles emboîtées calculées (bit 1), 0 : aucune
+uniform vec4 nestedBox[4];        // Centre et côté de chaque grille, de la plus grande à la plus fine
+uniform sampler3D nestedFieldTex[4];
+uniform float nestedMargin;       // Marge aux bords, en coordonnées de texture
+uniform int amrBricks;            // Briques par axe de gridTex (AMR), 0 : pas de raffinement
+uniform int fineBrick;
+uniform ivec3 poolSlots;
+uniform isampler3D brickTable;    // Emplacement de chaque brique dans le pool, -1 : non raffinée
+uniform sampler3D poolTex;        // Briques raffinées x2 : masse et quantité de mouvement
+uniform sampler3D poolFieldTex;   // Gradient de masse des briques raffinées (amrFieldFS)
+
+// Grille emboîtée la plus fine qui contient pos loin de ses bords (-1 : aucune)
+int NestedLevel(vec3 pos, out vec3 uvw) {
+    for (int k = nestedLevels - 1; k >= 0; k--) {
+        uvw = (pos - nestedBox[k].xyz) / nestedBox[k].w + 0.5;
+        if (all(greaterThan(uvw, vec3(nestedMargin))) && all(lessThan(uvw, vec3(1.0 - nestedMargin)))) return k;
+    }
+    return -1;
+}
 
-// Gradient 3D (Sobel ou Central Differences)
-vec3 GetGravityGradient(vec3 uvw) {
-    float texel = 1.0 / gridRes;
-    
-    // Pour x
-    float L = texture(gridTex, uvw + vec3(-texel, 0, 0)).r;
-    float R = texture(gridTex, uvw + vec3( texel, 0, 0)).r;
-    
-    // Pour y
-    float D = texture(gridTex, uvw + vec3(0, -texel, 0)).r;
-    float U = texture(gridTex, uvw + vec3(0,  texel, 0)).r;
-    
-    // Pour z
-    float B = texture(gridTex, uvw + vec3(0, 0, -texel)).r;
-    float F = texture(gridTex, uvw + vec3(0, 0,  texel)).r;
-    
-    return vec3(R - L, U - D, F - B);
+// Coordonnées dans le pool si la brique de uvw est raffinée. Centres des cellules fines bloqués dans
+// la brique : ses voisines de l'atlas n'ont rien à voir avec elle.
+bool RefinedCoords(vec3 uvw, out vec3 poolUvw) {
+    if (amrBricks == 0) return false;
+    ivec3 brick = min(ivec3(uvw * float(amrBricks)), ivec3(amrBricks - 1));
+    int slot = texelFetch(brickTable, brick, 0).r;
+    if (slot < 0) return false;
+    ivec3 origin = ivec3(slot % poolSlots.x, (slot / poolSlots.x) % poolSlots.y, slot / (poolSlots.x * poolSlots.y));
+    vec3 local = clamp(uvw * float(amrBricks * fineBrick) - vec3(brick * fineBrick), vec3(0.5), vec3(float(fineBrick) - 0.5));
+    poolUvw = (vec3(origin * fineBrick) + local) / vec3(poolSlots * fineBrick);
+    return true;
+}
+
+// GLSL 3.30 : tableau de samplers indexé par des constantes seulement
+vec3 NestedAcceleration(int k, vec3 uvw) {
+    if (k == 0) return texture(nestedFieldTex[0], uvw).xyz;
+    if (k == 1) return texture(nestedFieldTex[1], uvw).xyz;
+    if (k == 2) return texture(nestedFieldTex[2], uvw).xyz;
+    return texture(nestedFieldTex[3], uvw).xyz;
+}
+
+// Accélération -∇Φ par différences centrées sur le potentiel (lecture trilinéaire = interpolation CIC)
+vec3 GetMeshAcceleration(vec3 uvw) {
+    float texel = 1.0 / meshRes;
+    float cellSize = worldSize / meshRes;
+
+    float L = texture(potentialTex, uvw + vec3(-texel, 0, 0)).r;
+    float R = texture(potentialTex, uvw + vec3( texel, 0, 0)).r;
+    float D = texture(potentialTex, uvw + vec3(0, -texel, 0)).r;
+    float U = texture(potentialTex, uvw + vec3(0,  texel, 0)).r;
+    float B = texture(potentialTex, uvw + vec3(0, 0, -texel)).r;
+    float F = texture(potentialTex, uvw + vec3(0, 0,  texel)).r;
+
+    return -vec3(R - L, U - D, F - B) / (2.0 * cellSize);
 }
 
 void main() {
@@ -245,37 +936,95 @@ void main() {
     float distSq = dot(diff, diff) + 10.0;
     float dist = sqrt(distSq);
     vec3 force = (diff / dist) * (blackHoleMass / distSq);
+
+    // Arbre : forces déjà calculées pour chaque particule, valables aussi hors de la boîte
+    // (TreePM : seulement la partie courte portée, le maillage ajoute le reste)
+    if ((gravityMode & 2) != 0) force += texelFetch(treeAccTex, gl_VertexID).xyz;
     
     // 2. Self-Gravity & Collisions (via Grid 3D)
-    vec3 uvw = (pos / worldSize) + 0.5;
+    vec3 uvw = ((pos - gridCenter) / worldSize) + 0.5;
     
     if(uvw.x > 0.0 && uvw.x < 1.0 && uvw.y > 0.0 && uvw.y < 1.0 && uvw.z > 0.0 && uvw.z < 1.0) {
         
-        // --- A. Gravité Locale 3D ---
-        vec3 grad = GetGravityGradient(uvw);
-        force += grad * selfGravityStrength; 
+        // --- A. Gravité 3D ---
+        vec3 nestedUvw, poolUvw;
+        int level = (gravityMode & 1) != 0 ? NestedLevel(pos, nestedUvw) : -1;
+        bool refined = RefinedCoords(uvw, poolUvw);
+        if (level >= 0) {
+            force += NestedAcceleration(level, nestedUvw);
+        } else if ((gravityMode & 1) != 0) {
+            force += (gravityMode & 4) != 0 ? texture(meshFieldTex, uvw).xyz : GetMeshAcceleration(uvw);
+        } else if (gravityMode == 0) {
+            force += (refined ? texture(poolFieldTex, poolUvw).xyz : texture(fieldTex, uvw).xyz) * selfGravityStrength;
+        }
 
         // --- B. Friction / Collision (3D) ---
-        vec4 cell = texture(gridTex, uvw);
-        float localMass = cell.r;
+        vec4 cell = refined ? texture(poolTex, poolUvw) * 8.0 : texture(gridTex, uvw);  // Masse équivalente de base
+        float localMass = cell.r * frictionMassScale;
         
         if(localMass > 1.0) {
-            vec3 avgVel = cell.gba / localMass;
+            // Vitesse moyenne pondérée par la masse : l'échange de quantité de mouvement reste équilibré
+            vec3 avgVel = cell.gba / cell.r;
             vec3 relVel = avgVel - vel;
             // Friction isotrope 3D
             force += relVel * frictionStrength * log(localMass);
         }
+    } else if ((gravityMode & 1) != 0 && boxMassCenter.w > 0.0) {
+        // Hors de la grille : toute la masse au centre de masse, à au moins une demi-boîte de distance
+        vec3 d = boxMassCenter.xyz - pos;
+        float r2 = dot(d, d);
+        force += gravityConstant * boxMassCenter.w * d * inversesqrt(r2) / r2;
     }
     
     // Intégration
     vel += force * dt;
     pos += vel * dt;
     
-    outPos = vec4(pos, 1.0);
+    outPos = vec4(pos, inPos.w); // w = masse, conservée
     outVel = vec4(vel, 0.0);
 }
 )";
 
+// Réductions de la boîte adaptative : un point par particule dans une cible BOX_BINS x 2, blending additif.
+// pass 0 : Σ (x - center) m, Σ m dans le pixel (0, 1) ; pass 1 : masse et nombre de particules par
+// intervalle de log2(max |x - center|) sur la ligne 0.
+const char* boxReduceVS = R"(
+#version 330 core
+layout (location = 0) in vec4 aPos;
+
+flat out vec4 vValue;
+
+uniform int pass;
+uniform vec3 center;
+uniform int bins;
+uniform float binsPerOctave;
+
+void main() {
+    vec3 d = aPos.xyz - center;
+    float m = aPos.w;
+    int bin = 0;
+    if (pass == 0) {
+        vValue = vec4(d * m, m);
+    } else {
+        float r = max(max(abs(d.x), abs(d.y)), abs(d.z));
+        bin = clamp(int(floor(log2(max(r, 1.0)) * binsPerOctave)), 0, bins - 1);
+        vValue = vec4(m, 1.0, 0.0, 0.0);
+    }
+    gl_Position = vec4((float(bin) + 0.5) / float(bins) * 2.0 - 1.0, pass == 0 ? 0.5 : -0.5, 0.0, 1.0);
+    gl_PointSize = 1.0;
+}
+)";
+
+const char* boxReduceFS = R"(
+#version 330 core
+flat in vec4 vValue;
+out vec4 FragColor;
+
+void main() {
+    FragColor = vValue;
+}
+)";
+
 // 2. RENDER SHADERS (Affichage 3D)
 const char* renderVS = R"(
 #version 330 core
@@ -408,6 +1157,122 @@ void main() {
 }
 )";
 
+// 4. INITIAL CONDITIONS (Génération GPU via Transform Feedback)
+// Même modèle que InitParticlesCPU, avec le même Philox4x32-10 (compteur = index de particule).
+// Pas d'attribut d'entrée : on dessine particleCount points "vides" et gl_VertexID donne l'index.
+// Les mêmes bits aléatoires sont tirés que sur CPU ; seuls sin/cos/sqrt du driver peuvent différer de quelques ulps.
+const char* initVS = R"(
+#version 330 core
+out vec4 outPos;
+out vec4 outVel;
+
+uniform uint seed;
+uniform bool quasiRandom;
+uniform uint sobolV[96]; // Nombres de direction de Sobol, 3 dimensions x 32 bits
+uniform float dispersion;
+uniform float galaxyThickness;
+uniform float initialRotation;
+uniform float blackHoleMass;
+
+// GLSL 3.30 n'a pas umulExtended : produit 32x32 -> 64 bits par moitiés de 16 bits
+void MulHiLo(uint a, uint b, out uint hi, out uint lo) {
+    uint aL = a & 0xFFFFu, aH = a >> 16;
+    uint bL = b & 0xFFFFu, bH = b >> 16;
+    uint t  = aL * bL;
+    uint m1 = aH * bL;
+    uint m2 = aL * bH;
+    uint carry = ((t >> 16) + (m1 & 0xFFFFu) + (m2 & 0xFFFFu)) >> 16;
+    hi = aH * bH + (m1 >> 16) + (m2 >> 16) + carry;
+    lo = a * b;
+}
+
+uvec4 Philox4x32_10(uvec4 c, uvec2 k) {
+    for (int round = 0; round < 10; round++) {
+        uint hi0, lo0, hi1, lo1;
+        MulHiLo(0xD2511F53u, c.x, hi0, lo0);
+        MulHiLo(0xCD9E8D57u, c.z, hi1, lo1);
+        c = uvec4(hi1 ^ c.y ^ k.x, lo1, hi0 ^ c.w ^ k.y, lo0);
+        k += uvec2(0x9E3779B9u, 0xBB67AE85u);
+    }
+    return c;
+}
+
+vec4 Uniform4(uint index, uint stream) {
+    uvec4 r = Philox4x32_10(uvec4(index, stream, 0u, 0u), uvec2(seed, 0x5EED5EEDu));
+    return vec4(r >> 8u) * (1.0 / 16777216.0);
+}
+
+uint ReverseBits(uint x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+    x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Sobol + brouillage d'Owen par hachage, identique à LowDiscrepancy.h
+float SobolUnit(uint index, int dim) {
+    uint x = 0u;
+    for (int b = 0; b < 32 && index != 0u; b++, index >>= 1) {
+        if ((index & 1u) != 0u) x ^= sobolV[dim * 32 + b];
+    }
+    uint dimSeed = seed * 0x9E3779B9u + uint(dim) * 0x85EBCA6Bu;
+    x = ReverseBits(x);
+    x += dimSeed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    x = ReverseBits(x);
+    return float(x >> 8) * (1.0 / 16777216.0);
+}
+
+void main() {
+    uint i = uint(gl_VertexID);
+    vec4 u = Uniform4(i, 0u);
+    vec4 n = Uniform4(i, 1u);
+    if (quasiRandom) u.xyz = vec3(SobolUnit(i, 0), SobolUnit(i, 1), SobolUnit(i, 2));
+
+    // Disque d'accrétion initial
+    float angle = u.x * 2.0 * 3.14159;
+    float r = dispersion * sqrt(u.y);
+    float z = (u.z * 2.0 - 1.0) * galaxyThickness * (1.0 - r / dispersion);
+
+    outPos = vec4(cos(angle) * r, sin(angle) * r, z * 2.0, 1.0); // w = masse
+
+    // Vitesse orbitale
+    float dist = r + 1.0;
+    float orbitalSpeed = (blackHoleMass > 1.0) ? sqrt(blackHoleMass / dist) * initialRotation
+                                               : r * 0.005 * initialRotation;
+
+    vec2 tangent = vec2(-sin(angle), cos(angle));
+    vec3 vel = vec3(tangent * orbitalSpeed, 0.0);
+
+    // Bruit 3D
+    vel += (n.xyz - 0.5) * vec3(2.0, 2.0, 0.5);
+    outVel = vec4(vel, 0.0);
+}
+)";
+
+// Instanciation d'un gabarit de galaxie dans la scène : rotation (axe de spin), translation, vitesse d'ensemble
+const char* instanceVS = R"(
+#version 330 core
+layout (location = 0) in vec4 inPos;
+layout (location = 1) in vec4 inVel;
+
+out vec4 outPos;
+out vec4 outVel;
+
+uniform mat3 rotation;
+uniform vec3 offset;
+uniform vec3 bulkVelocity;
+
+void main() {
+    outPos = vec4(rotation * inPos.xyz + offset, inPos.w); // w = masse, inchangée
+    outVel = vec4(rotation * inVel.xyz + bulkVelocity, inVel.w);
+}
+)";
+
 // --- Grid Visualization Shaders ---
 const char* gridVS = R"(
 #version 330 core
@@ -427,142 +1292,1364 @@ const char* gridFS = R"(
 out vec4 FragColor;
 uniform vec4 gridColor;
 
-void main() {
-    FragColor = gridColor;
+void main() {
+    FragColor = gridColor;
+}
+)";
+
+// --- Compilation Shader Helper ---
+GLuint CreateShader(const char* src, GLenum type) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &src, NULL);
+    glCompileShader(shader);
+    // Check errors (simplifié)
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        std::cerr << "SHADER ERROR:\n" << infoLog << std::endl;
+    }
+    return shader;
+}
+
+// Upload CPU -> les deux jeux de buffers (ping-pong)
+void UploadParticles(const std::vector<glm::vec4>& positions, const std::vector<glm::vec4>& velocities) {
+    for(int i=0; i<2; i++) {
+        glBindBuffer(GL_ARRAY_BUFFER, posVBO[i]);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, particleCount * sizeof(glm::vec4), positions.data());
+        glBindBuffer(GL_ARRAY_BUFFER, velVBO[i]);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, particleCount * sizeof(glm::vec4), velocities.data());
+    }
+}
+
+// (Ré)alloue les VBOs ping-pong et reconstruit VAOs + Transform Feedback. Le nouveau jeu est créé avant
+// de libérer l'ancien : en cas d'échec, l'ancien reste intact ; sinon les particleCount particules du set
+// courant y sont recopiées (set 0), la simulation continue sans trou.
+bool AllocateParticleBuffers(unsigned int capacity) {
+    while (glGetError() != GL_NO_ERROR) {}   // Erreurs antérieures : ne pas les prendre pour un manque de mémoire
+
+    GLuint vao[2], pos[2], vel[2], feedback[2];
+    glGenVertexArrays(2, vao);
+    glGenBuffers(2, pos);
+    glGenBuffers(2, vel);
+    glGenTransformFeedbacks(2, feedback);
+
+    const GLsizeiptr bytes = (GLsizeiptr)capacity * sizeof(glm::vec4);
+    for (int i = 0; i < 2; i++) {
+        glBindVertexArray(vao[i]);
+
+        // Position Buffer (vec4)
+        glBindBuffer(GL_ARRAY_BUFFER, pos[i]);
+        glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_DYNAMIC_COPY);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, NULL); // size 4
+        glEnableVertexAttribArray(0);
+
+        // Velocity Buffer (vec4)
+        glBindBuffer(GL_ARRAY_BUFFER, vel[i]);
+        glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_DYNAMIC_COPY);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, NULL); // size 4
+        glEnableVertexAttribArray(1);
+
+        // Setup Transform Feedback pour ce set
+        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedback[i]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, pos[i]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 1, vel[i]);
+        
+        glBindVertexArray(0);
+    }
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (glGetError() == GL_OUT_OF_MEMORY) {
+        glDeleteVertexArrays(2, vao);
+        glDeleteBuffers(2, pos);
+        glDeleteBuffers(2, vel);
+        glDeleteTransformFeedbacks(2, feedback);
+        return false;
+    }
+
+    if (particleCapacity != 0) {
+        const GLsizeiptr live = (GLsizeiptr)particleCount * sizeof(glm::vec4);
+        glBindBuffer(GL_COPY_READ_BUFFER, posVBO[currIdx]);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pos[0]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, live);
+        glBindBuffer(GL_COPY_READ_BUFFER, velVBO[currIdx]);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vel[0]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, live);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        glDeleteVertexArrays(2, VAO);
+        glDeleteBuffers(2, posVBO);
+        glDeleteBuffers(2, velVBO);
+        glDeleteTransformFeedbacks(2, transformFeedback);
+    }
+    for (int i = 0; i < 2; i++) {
+        VAO[i] = vao[i];
+        posVBO[i] = pos[i];
+        velVBO[i] = vel[i];
+        transformFeedback[i] = feedback[i];
+    }
+    particleCapacity = capacity;
+    currIdx = 0;
+    nextIdx = 1;
+    return true;
+}
+
+// Garantit la place pour count particules, sans changer particleCount ni perdre les particules en cours.
+// Ne réalloue que si la capacité est dépassée (x2 à chaque fois), donc réduire puis ré-augmenter le
+// nombre ne coûte rien.
+bool ReserveParticles(unsigned int count) {
+    if (count == 0) return false;
+    if (count <= particleCapacity) return true;
+    unsigned long long grown = std::max<unsigned long long>(count, 2ull * particleCapacity);
+    unsigned int capacity = (unsigned int)std::min<unsigned long long>(grown, 0xFFFFFFFFull / sizeof(glm::vec4));
+    if (AllocateParticleBuffers(capacity)) return true;
+    // Pas assez de VRAM pour la croissance géométrique : on tente la taille exacte, l'ancien jeu reste sinon
+    std::cerr << "Particle buffers: out of memory for " << capacity << " particles" << std::endl;
+    return capacity != count && AllocateParticleBuffers(count);
+}
+
+// Pour les chemins qui remplissent les VBOs aussitôt après (GPU, cache, scène, repli synchrone) :
+// le nouveau nombre ne s'applique qu'avec la place pour lui.
+bool SetParticleCount(unsigned int count) {
+    if (!ReserveParticles(count)) return false;
+    particleCount = count;
+    return true;
+}
+
+// Mêmes paramètres qu'une génération précédente : projection du fichier de cache + upload, sans génération
+bool LoadCachedParticles() {
+    if (!icDiskCache) return false;
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    InitialConditionSettings ic = CaptureInitialConditions();
+    ICCacheReader entry;
+    if (!entry.Open(HashInitialConditions(ic), ic.count)) return false;
+    if (!SetParticleCount((unsigned int)ic.count)) return false;
+
+    // Seul le set courant compte : le prochain pas de physique écrit l'autre
+    const GLsizeiptr bytes = ic.count * sizeof(glm::vec4);
+    glBindBuffer(GL_ARRAY_BUFFER, posVBO[currIdx]);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, entry.Positions());
+    glBindBuffer(GL_ARRAY_BUFFER, velVBO[currIdx]);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, entry.Velocities());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    lastInitMs = std::chrono::duration<float, std::milli>(t1 - t0).count();
+    initTimerPending = false;
+    lastInitFromCache = true;
+    return true;
+}
+
+// Durée GPU d'une génération (GL_TIME_ELAPSED), relue sans bloquer par PollInitTimer aux frames suivantes :
+// lastInitMs vaut la part CPU en attendant, puis part CPU + temps GPU
+void BeginInitTimer() {
+    if (!initTimerQuery) glGenQueries(1, &initTimerQuery);
+    glBeginQuery(GL_TIME_ELAPSED, initTimerQuery);
+}
+
+void EndInitTimer(float cpuMs) {
+    glEndQuery(GL_TIME_ELAPSED);
+    initTimerPending = true;
+    initTimerCpuMs = cpuMs;
+    lastInitMs = cpuMs;
+}
+
+void PollInitTimer() {
+    if (!initTimerPending) return;
+    GLint available = 0;
+    glGetQueryObjectiv(initTimerQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) return;
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(initTimerQuery, GL_QUERY_RESULT, &ns);
+    lastInitMs = initTimerCpuMs + (float)(ns / 1.0e6);
+    initTimerPending = false;
+}
+
+// Génère les conditions initiales directement dans les VBOs : ni mémoire hôte, ni transfert PCIe
+void GenerateParticlesGPU() {
+    BeginInitTimer();
+
+    glUseProgram(initProgram);
+    glUniform1ui(glGetUniformLocation(initProgram, "seed"), (GLuint)simSeed);
+    glUniform1i(glGetUniformLocation(initProgram, "quasiRandom"), quasiRandomSampling);
+    glUniform1uiv(glGetUniformLocation(initProgram, "sobolV"), 3 * SOBOL_BITS, SobolDirections());
+    glUniform1f(glGetUniformLocation(initProgram, "dispersion"), dispersion);
+    glUniform1f(glGetUniformLocation(initProgram, "galaxyThickness"), galaxyThickness);
+    glUniform1f(glGetUniformLocation(initProgram, "initialRotation"), initialRotation);
+    glUniform1f(glGetUniformLocation(initProgram, "blackHoleMass"), blackHoleMass);
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(initVAO);
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, transformFeedback[currIdx]);
+    glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, particleCount);
+    glEndTransformFeedback();
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    // Copie GPU -> GPU vers l'autre moitié du ping-pong
+    const GLsizeiptr bytes = particleCount * sizeof(glm::vec4);
+    glBindBuffer(GL_COPY_READ_BUFFER, posVBO[currIdx]);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, posVBO[nextIdx]);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, velVBO[currIdx]);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, velVBO[nextIdx]);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+
+    EndInitTimer(0.0f);
+}
+
+void InitGPU() {
+    // 1. Setup VAO/VBOs (contenu rempli plus bas, par le GPU ou par upload CPU)
+    if (!SetParticleCount(targetParticleCount)) std::cerr << "Failed to allocate particle buffers" << std::endl;
+
+    // 2. Compile Init Shader (TF, sans attributs)
+    glGenVertexArrays(1, &initVAO);
+    GLuint iVS = CreateShader(initVS, GL_VERTEX_SHADER);
+    initProgram = glCreateProgram();
+    glAttachShader(initProgram, iVS);
+    const char* initVaryings[] = { "outPos", "outVel" };
+    glTransformFeedbackVaryings(initProgram, 2, initVaryings, GL_SEPARATE_ATTRIBS);
+    glLinkProgram(initProgram);
+    glDeleteShader(iVS);
+
+    // Instanciation des gabarits (scène multi-galaxies) : même sortie TF que l'init
+    GLuint sVS = CreateShader(instanceVS, GL_VERTEX_SHADER);
+    sceneProgram = glCreateProgram();
+    glAttachShader(sceneProgram, sVS);
+    glTransformFeedbackVaryings(sceneProgram, 2, initVaryings, GL_SEPARATE_ATTRIBS);
+    glLinkProgram(sceneProgram);
+    glDeleteShader(sVS);
+    glGenTransformFeedbacks(1, &sceneTF);
+
+    // Le modèle à l'équilibre (tables, Jeans) reste sur CPU
+    if (gpuInitialConditions && icModel == IC_LEGACY_DISK) {
+        GenerateParticlesGPU();
+    } else if (!LoadCachedParticles()) {
+        std::vector<glm::vec4> initialPos;
+        std::vector<glm::vec4> initialVel;
+        InitParticlesCPU(initialPos, initialVel);
+        UploadParticles(initialPos, initialVel);
+    }
+
+    // 3. Compile Physics Shader (TF)
+    GLuint vs = CreateShader(physicsVS, GL_VERTEX_SHADER);
+    physicsProgram = glCreateProgram();
+    glAttachShader(physicsProgram, vs);
+
+    // Indiquer ce qu'on veut capturer AVANT le linking
+    const char* varyings[] = { "outPos", "outVel" };
+    glTransformFeedbackVaryings(physicsProgram, 2, varyings, GL_SEPARATE_ATTRIBS);
+    
+    glLinkProgram(physicsProgram);
+    // Check Link Errors...
+    glDeleteShader(vs);
+
+    // 4. Compile Render Shader
+    GLuint rVS = CreateShader(renderVS, GL_VERTEX_SHADER);
+    GLuint rFS = CreateShader(renderFS, GL_FRAGMENT_SHADER);
+    renderProgram = glCreateProgram();
+    glAttachShader(renderProgram, rVS);
+    glAttachShader(renderProgram, rFS);
+    glLinkProgram(renderProgram);
+    glDeleteShader(rVS);
+    glDeleteShader(rFS);
+
+    // 5. Compile Grid Shader
+    GLuint gVS = CreateShader(gridVS, GL_VERTEX_SHADER);
+    GLuint gFS = CreateShader(gridFS, GL_FRAGMENT_SHADER);
+    GLuint gridProgram = glCreateProgram();
+    glAttachShader(gridProgram, gVS);
+    glAttachShader(gridProgram, gFS);
+    glLinkProgram(gridProgram);
+    glDeleteShader(gVS);
+    glDeleteShader(gFS);
+}
+
+// Programme d'une passe par cellule : fieldVS + fieldGS + le fragment shader donné
+GLuint CreateFieldProgram(const char* fragmentSource, const char* name) {
+    GLuint vs = CreateShader(fieldVS, GL_VERTEX_SHADER);
+    GLuint gs = CreateShader(fieldGS, GL_GEOMETRY_SHADER);
+    GLuint fs = CreateShader(fragmentSource, GL_FRAGMENT_SHADER);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, gs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if(!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cerr << name << " LINK ERROR:\n" << infoLog << std::endl;
+    }
+    glDeleteShader(vs);
+    glDeleteShader(gs);
+    glDeleteShader(fs);
+    return program;
+}
+
+// Texture RGBA32F res³ filtrée (lecture trilinéaire par particule)
+GLuint CreateFieldTexture(int res, GLint wrap) {
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_3D, tex);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA32F, res, res, res, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, wrap);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, wrap);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    return tex;
+}
+
+void InitDensityMap() {
+    // 1. Framebuffer
+    glGenFramebuffers(1, &densityFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, densityFBO);
+    
+    // 2. Texture 3D (Float R,G,B,A pour Masse, MomX, MomY, MomZ)
+    // GL_RGB32F -> GL_RGBA32F car on a besoin de 4 composants
+    glGenTextures(1, &densityTex);
+    glBindTexture(GL_TEXTURE_3D, densityTex);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA32F, GRID_RES_3D, GRID_RES_3D, GRID_RES_3D, 0, GL_RGBA, GL_FLOAT, NULL);
+    
+    // Pas de mipmaps : glGenerateMipmap moyennerait la masse au lieu de la sommer. La pyramide de
+    // masse (GRAVITY_MIP_PYRAMID) a sa propre texture, dont les niveaux sont remplis par des passes par cellule.
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); 
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    // Attacher la texture 3D au FBO pour Layered Rendering
+    // On attache toute la texture, le Geometry Shader choisira la layer (Z)
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, densityTex, 0);
+    
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "Density FBO Error! Status: " << glCheckFramebufferStatus(GL_FRAMEBUFFER) << std::endl;
+        
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // 3. Shader
+    GLuint vs = CreateShader(densityVS, GL_VERTEX_SHADER);
+    GLuint gs = CreateShader(densityGS, GL_GEOMETRY_SHADER);
+    GLuint fs = CreateShader(densityFS, GL_FRAGMENT_SHADER);
+    densityProgram = glCreateProgram();
+    glAttachShader(densityProgram, vs);
+    glAttachShader(densityProgram, gs);
+    glAttachShader(densityProgram, fs);
+    glLinkProgram(densityProgram);
+    // check errors...
+    GLint success;
+    glGetProgramiv(densityProgram, GL_LINK_STATUS, &success);
+    if(!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(densityProgram, 512, NULL, infoLog);
+        std::cerr << "DENSITY LINK ERROR:\n" << infoLog << std::endl;
+    }
+
+    // 4. Gradient par cellule, toutes les couches attachées
+    fieldTex = CreateFieldTexture(GRID_RES_3D, GL_CLAMP_TO_EDGE);
+    glGenFramebuffers(1, &fieldFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, fieldFBO);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, fieldTex, 0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "Field FBO Error! Status: " << glCheckFramebufferStatus(GL_FRAMEBUFFER) << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    fieldProgram = CreateFieldProgram(fieldFS, "FIELD");
+}
+
+// --- Particle-Mesh ---
+void InitParticleMesh() {
+    GLuint vs = CreateShader(densityVS, GL_VERTEX_SHADER);
+    GLuint gs = CreateShader(pmDepositGS, GL_GEOMETRY_SHADER);
+    GLuint fs = CreateShader(pmDepositFS, GL_FRAGMENT_SHADER);
+    pmDepositProgram = glCreateProgram();
+    glAttachShader(pmDepositProgram, vs);
+    glAttachShader(pmDepositProgram, gs);
+    glAttachShader(pmDepositProgram, fs);
+    glLinkProgram(pmDepositProgram);
+    GLint success;
+    glGetProgramiv(pmDepositProgram, GL_LINK_STATUS, &success);
+    if(!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(pmDepositProgram, 512, NULL, infoLog);
+        std::cerr << "PM DEPOSIT LINK ERROR:\n" << infoLog << std::endl;
+    }
+    glDeleteShader(vs);
+    glDeleteShader(gs);
+    glDeleteShader(fs);
+    glGenFramebuffers(1, &pmFBO);
+    meshFieldProgram = CreateFieldProgram(meshFieldFS, "MESH FIELD");
+}
+
+// (Ré)alloue les textures du maillage quand la résolution change
+void ResizeParticleMesh(int res) {
+    if (pmMassTex) glDeleteTextures(1, &pmMassTex);
+    if (pmPotentialTex) glDeleteTextures(1, &pmPotentialTex);
+
+    glGenTextures(1, &pmMassTex);
+    glBindTexture(GL_TEXTURE_3D, pmMassTex);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F, res, res, res, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // Potentiel périodique : GL_REPEAT pour que les différences centrées se referment aux bords
+    glGenTextures(1, &pmPotentialTex);
+    glBindTexture(GL_TEXTURE_3D, pmPotentialTex);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F, res, res, res, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, pmFBO);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, pmMassTex, 0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "PM FBO Error! Status: " << glCheckFramebufferStatus(GL_FRAMEBUFFER) << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    const size_t cells = (size_t)res * res * res;
+    pmMass.assign(cells, 0.0f);
+    pmPotential.assign(cells, 0.0f);
+    pmSolver.Resize(res);
+    pmAllocatedRes = res;
+}
+
+bool UsesParticleMesh() {
+    return gravitySolver == GRAVITY_PM_CPU || gravitySolver == GRAVITY_PM_GPU || gravitySolver == GRAVITY_TREEPM ||
+           gravitySolver == GRAVITY_MULTIGRID || gravitySolver == GRAVITY_PM_ISOLATED;
+}
+
+// Potentiel sans boîtes images : dépôt, différences et lecture s'arrêtent aux bords du maillage
+bool UsesIsolatedMesh() {
+    return gravitySolver == GRAVITY_MULTIGRID || gravitySolver == GRAVITY_PM_ISOLATED;
+}
+
+bool UsesTree() {
+    return gravitySolver == GRAVITY_BARNES_HUT || gravitySolver == GRAVITY_GPU_TREE || gravitySolver == GRAVITY_FMM ||
+           gravitySolver == GRAVITY_TREEPM || gravitySolver == GRAVITY_DIRECT;
+}
+
+// -∇Φ précalculé par cellule : une passe de res³ fragments remplace 6 lectures par particule, rentable
+// tant que le maillage n'a pas plus de cellules que de particules
+bool UsesMeshField() {
+    const size_t cells = (size_t)pmAllocatedRes * pmAllocatedRes * pmAllocatedRes;
+    return UsesParticleMesh() && cells <= particleCount;
+}
+
+// P3M : les accélérations correctives passent par treeAccTex, comme celles des arbres.
+// Pas avec les grilles emboîtées : la force de paire retranchée est celle du seul maillage de base.
+bool UsesP3M() {
+    return p3mEnabled && (gravitySolver == GRAVITY_PM_CPU || gravitySolver == GRAVITY_PM_GPU ||
+                          gravitySolver == GRAVITY_PM_ISOLATED || (gravitySolver == GRAVITY_MULTIGRID && nestedLevels == 0));
+}
+
+// Mesure du solveur GPU sans bloquer : une seule requête en vol, relue quand elle est disponible
+bool BeginGPUSolveTimer() {
+    if (!gpuSolveQuery) glGenQueries(1, &gpuSolveQuery);
+    if (gpuSolveQueryPending) {
+        GLint available = 0;
+        glGetQueryObjectiv(gpuSolveQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return false;
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(gpuSolveQuery, GL_QUERY_RESULT, &ns);
+        lastSolveMs = ns / 1.0e6f;
+        gpuSolveQueryPending = false;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, gpuSolveQuery);
+    return true;
+}
+
+void EndGPUSolveTimer(bool started) {
+    if (!started) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    gpuSolveQueryPending = true;
+}
+
+// Passe par cellule sur les res couches de la cible attachée à fbo (programme et textures déjà liés)
+void RunFieldPass(GLuint fbo, int res) {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, res, res);
+    glBindVertexArray(initVAO);
+    glDrawArrays(GL_POINTS, 0, res);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// -∇Φ par différences centrées aux centres des cellules (meshFieldFS), du potentiel potentialTex vers fbo
+void RunMeshFieldPass(GLuint potentialTex, GLuint fbo, int res, float cellSize, bool periodic) {
+    glUseProgram(meshFieldProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, potentialTex);
+    glUniform1i(glGetUniformLocation(meshFieldProgram, "potentialTex"), 0);
+    glUniform1f(glGetUniformLocation(meshFieldProgram, "cellSize"), cellSize);
+    glUniform1i(glGetUniformLocation(meshFieldProgram, "periodic"), periodic);
+    RunFieldPass(fbo, res);
+}
+
+// Textures d'une grille emboîtée : masse (dépôt), potentiel et accélération par cellule
+void AllocateNestedGrid(NestedGrid& grid, int res) {
+    if (grid.massTex) {
+        GLuint textures[3] = { grid.massTex, grid.potentialTex, grid.fieldTex };
+        glDeleteTextures(3, textures);
+    } else {
+        glGenFramebuffers(1, &grid.massFBO);
+        glGenFramebuffers(1, &grid.fieldFBO);
+    }
+    glGenTextures(1, &grid.massTex);
+    glBindTexture(GL_TEXTURE_3D, grid.massTex);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F, res, res, res, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glGenTextures(1, &grid.potentialTex);
+    glBindTexture(GL_TEXTURE_3D, grid.potentialTex);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F, res, res, res, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    grid.fieldTex = CreateFieldTexture(res, GL_CLAMP_TO_EDGE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, grid.massFBO);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, grid.massTex, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, grid.fieldFBO);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, grid.fieldTex, 0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "Nested FBO Error! Status: " << glCheckFramebufferStatus(GL_FRAMEBUFFER) << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    grid.mass.assign((size_t)res * res * res, 0.0f);
+    grid.potential.assign((size_t)res * res * res, 0.0f);
+    grid.solver.Resize(res);
+    grid.res = res;
+}
+
+// Centre de la cellule la plus massive d'une grille res³ de côté size centrée sur center
+glm::vec3 DensestCell(const std::vector<float>& mass, int res, glm::vec3 center, float size) {
+    const size_t best = std::max_element(mass.begin(), mass.end()) - mass.begin();
+    const glm::vec3 cell((float)(best % res), (float)(best / res % res), (float)(best / ((size_t)res * res)));
+    return center + ((cell + 0.5f) / (float)res - 0.5f) * size;
+}
+
+// Grilles emboîtées, de la plus grande à la plus fine, après le potentiel du maillage (pmPotential)
+void ComputeNestedGravity() {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    const int res = pmAllocatedRes;
+    const std::vector<float>* parentMass = &pmMass;
+    const std::vector<float>* parentPotential = &pmPotential;
+    glm::vec3 parentCenter = gridCenter;
+    float parentSize = gridSize;
+
+    for (int k = 0; k < nestedLevels; k++) {
+        NestedGrid& grid = nestedGrids[k];
+        if (grid.res != res) AllocateNestedGrid(grid, res);
+
+        // Centre sur une face de cellule parente (res / 4 cellules de chaque côté), à NESTED_MARGIN
+        // cellules au moins des bords de la parente pour que ses fantômes y soient interpolés
+        const float h = parentSize / res;
+        const glm::vec3 focus = nestedOnDensest ? DensestCell(*parentMass, res, parentCenter, parentSize) : nestedPoint;
+        const float limit = (float)(res / 4 - NESTED_MARGIN);
+        grid.center = parentCenter + glm::clamp(glm::round((focus - parentCenter) / h), -limit, limit) * h;
+        grid.size = 0.5f * parentSize;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, grid.massFBO);
+        glViewport(0, 0, res, res);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glUseProgram(pmDepositProgram);
+        glUniform1f(glGetUniformLocation(pmDepositProgram, "worldSize"), grid.size);
+        glUniform3fv(glGetUniformLocation(pmDepositProgram, "gridCenter"), 1, &grid.center.x);
+        glUniform1i(glGetUniformLocation(pmDepositProgram, "gridRes"), res);
+        glUniform1i(glGetUniformLocation(pmDepositProgram, "periodic"), 0);
+        glBindVertexArray(VAO[currIdx]);
+        glDrawArrays(GL_POINTS, 0, particleCount);
+        glDisable(GL_BLEND);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glBindTexture(GL_TEXTURE_3D, grid.massTex);
+        glGetTexImage(GL_TEXTURE_3D, 0, GL_RED, GL_FLOAT, grid.mass.data());
+        const glm::vec3 offset = parentCenter - grid.center;
+        grid.solver.SolveNested(grid.mass.data(), grid.size, gravityConstant, parentPotential->data(), res, parentSize,
+                                &offset.x, grid.potential.data(), mgMaxCycles, mgTolerance);
+        glBindTexture(GL_TEXTURE_3D, grid.potentialTex);
+        glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, res, res, res, GL_RED, GL_FLOAT, grid.potential.data());
+        glBindTexture(GL_TEXTURE_3D, 0);
+        RunMeshFieldPass(grid.potentialTex, grid.fieldFBO, res, grid.size / res, false);
+
+        parentMass = &grid.mass;
+        parentPotential = &grid.potential;
+        parentCenter = grid.center;
+        parentSize = grid.size;
+    }
+    activeNested = nestedLevels;
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    lastNestedMs = std::chrono::duration<float, std::milli>(t1 - t0).count();
+}
+
+// Dépôt CIC (GPU) -> relecture de la grille (O(M), pas O(N)) -> Poisson FFT (CPU) -> upload du potentiel.
+// Avec GRAVITY_PM_GPU, le Poisson est résolu sur place par compute shaders (pas de relecture).
+// GRAVITY_MULTIGRID : même chemin, multigrille isolée au lieu de la FFT. GRAVITY_PM_ISOLATED : FFT sur la
+// grille doublée, maillage limité à PMSolver::MAX_ISOLATED.
+void ComputeMeshGravity() {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    const int wanted = gravitySolver == GRAVITY_PM_ISOLATED ? std::min(pmGridRes, PMSolver::MAX_ISOLATED) : pmGridRes;
+    if (pmAllocatedRes != wanted) ResizeParticleMesh(wanted);
+    const int res = pmAllocatedRes;
+
+    // Potentiel isolé : les différences centrées ne doivent pas se refermer d'un bord à l'autre
+    const GLint wrap = UsesIsolatedMesh() ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+    glBindTexture(GL_TEXTURE_3D, pmPotentialTex);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, wrap);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, wrap);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, pmFBO);
+    glViewport(0, 0, res, res);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+
+    glUseProgram(pmDepositProgram);
+    glUniform1f(glGetUniformLocation(pmDepositProgram, "worldSize"), gridSize);
+    glUniform3fv(glGetUniformLocation(pmDepositProgram, "gridCenter"), 1, &gridCenter.x);
+    glUniform1i(glGetUniformLocation(pmDepositProgram, "gridRes"), res);
+    glUniform1i(glGetUniformLocation(pmDepositProgram, "periodic"), !UsesIsolatedMesh());
+    glBindVertexArray(VAO[currIdx]);
+    glDrawArrays(GL_POINTS, 0, particleCount);
+
+    glDisable(GL_BLEND);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (gravitySolver == GRAVITY_PM_GPU) {
+        if (gpuPoisson.Size() != res && !gpuPoisson.Init(res)) {
+            std::cerr << "GPU Poisson unavailable, falling back to CPU FFT" << std::endl;
+            gravitySolver = GRAVITY_PM_CPU;
+        } else {
+            bool timed = BeginGPUSolveTimer();
+            gpuPoisson.Solve(pmMassTex, pmPotentialTex, gridSize, gravityConstant);
+            EndGPUSolveTimer(timed);
+            auto t1 = std::chrono::high_resolution_clock::now();
+            lastGravityMs = std::chrono::duration<float, std::milli>(t1 - t0).count();  // Soumission CPU seule
+            return;
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_3D, pmMassTex);
+    glGetTexImage(GL_TEXTURE_3D, 0, GL_RED, GL_FLOAT, pmMass.data());
+
+    if (gravitySolver == GRAVITY_MULTIGRID) {
+        if (multigrid.Size() != res) multigrid.Resize(res);
+        lastSolveMs = multigrid.SolvePotential(pmMass.data(), gridSize, gravityConstant, pmPotential.data(),
+                                               mgMaxCycles, mgTolerance);
+    } else if (gravitySolver == GRAVITY_PM_ISOLATED) {
+        lastSolveMs = pmSolver.SolveIsolated(pmMass.data(), gridSize, gravityConstant, pmPotential.data());
+    } else {
+        lastSolveMs = pmSolver.SolvePotential(pmMass.data(), gridSize, gravityConstant, pmPotential.data(),
+                                              gravitySolver == GRAVITY_TREEPM ? treePMSplit : 0.0f);
+    }
+
+    glBindTexture(GL_TEXTURE_3D, pmPotentialTex);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, res, res, res, GL_RED, GL_FLOAT, pmPotential.data());
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    activeNested = 0;
+    if (gravitySolver == GRAVITY_MULTIGRID && nestedLevels > 0) ComputeNestedGravity();
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    lastGravityMs = std::chrono::duration<float, std::milli>(t1 - t0).count();
+    lastMeshMs = lastGravityMs;
+}
+
+// -∇Φ du potentiel de ComputeMeshGravity, aux centres des cellules du maillage
+void ComputeMeshField() {
+    const int res = pmAllocatedRes;
+    if (meshFieldRes != res) {
+        if (meshFieldTex) glDeleteTextures(1, &meshFieldTex);
+        if (!meshFieldFBO) glGenFramebuffers(1, &meshFieldFBO);
+        meshFieldTex = CreateFieldTexture(res, GL_REPEAT);
+        glBindFramebuffer(GL_FRAMEBUFFER, meshFieldFBO);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, meshFieldTex, 0);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "Mesh field FBO Error! Status: " << glCheckFramebufferStatus(GL_FRAMEBUFFER) << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        meshFieldRes = res;
+    }
+
+    // Mêmes bords que le potentiel, pour les différences et pour la lecture trilinéaire
+    const bool periodic = !UsesIsolatedMesh();
+    const GLint wrap = periodic ? GL_REPEAT : GL_CLAMP_TO_EDGE;
+    glBindTexture(GL_TEXTURE_3D, meshFieldTex);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, wrap);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, wrap);
+
+    RunMeshFieldPass(pmPotentialTex, meshFieldFBO, res, gridSize / res, periodic);
+}
+
+// Textures et programmes de la pyramide, créés au premier usage ; le dépôt de densité remplit le niveau 0
+void InitMipPyramid() {
+    mipMomentProgram = CreateFieldProgram(mipMomentFS, "MIP MOMENT");
+    mipAccelProgram = CreateFieldProgram(mipAccelFS, "MIP ACCEL");
+
+    glGenTextures(1, &mipMomentTex);
+    glBindTexture(GL_TEXTURE_3D, mipMomentTex);
+    for (int l = 0; l < MIP_LEVELS; l++) {
+        const int res = GRID_RES_3D >> l;
+        glTexImage3D(GL_TEXTURE_3D, l, GL_RGBA32F, res, res, res, 0, GL_RGBA, GL_FLOAT, NULL);
+    }
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, MIP_LEVELS - 1);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    for (int l = 1; l < MIP_LEVELS; l++) {
+        glGenFramebuffers(1, &mipMomentFBO[l]);
+        glBindFramebuffer(GL_FRAMEBUFFER, mipMomentFBO[l]);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, mipMomentTex, l);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "Mip FBO Error! Status: " << glCheckFramebufferStatus(GL_FRAMEBUFFER) << std::endl;
+    }
+
+    mipAccelTex = CreateFieldTexture(GRID_RES_3D, GL_CLAMP_TO_EDGE);
+    glGenFramebuffers(1, &mipAccelFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, mipAccelFBO);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, mipAccelTex, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, densityFBO);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, mipMomentTex, 0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "Density FBO Error! Status: " << glCheckFramebufferStatus(GL_FRAMEBUFFER) << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// Pyramide de masse : sommes 2³ niveau par niveau, puis une passe de champ sur la grille fine.
+// Tout reste sur GPU ; physicsVS lit mipAccelTex comme un champ PM précalculé.
+void ComputeMipGravity() {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    bool timed = BeginGPUSolveTimer();
+
+    glUseProgram(mipMomentProgram);
+    glUniform1i(glGetUniformLocation(mipMomentProgram, "fineTex"), 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, mipMomentTex);
+    for (int l = 1; l < MIP_LEVELS; l++) {
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_BASE_LEVEL, l - 1);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, l - 1);
+        glUniform1f(glGetUniformLocation(mipMomentProgram, "fineCellSize"), gridSize / (GRID_RES_3D >> (l - 1)));
+        RunFieldPass(mipMomentFBO[l], GRID_RES_3D >> l);
+    }
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, MIP_LEVELS - 1);
+
+    const float cellSize = gridSize / GRID_RES_3D;
+    glUseProgram(mipAccelProgram);
+    glUniform1i(glGetUniformLocation(mipAccelProgram, "momentTex"), 0);
+    glUniform1i(glGetUniformLocation(mipAccelProgram, "levels"), MIP_LEVELS);
+    glUniform1f(glGetUniformLocation(mipAccelProgram, "worldSize"), gridSize);
+    glUniform1f(glGetUniformLocation(mipAccelProgram, "G"), gravityConstant);
+    glUniform1f(glGetUniformLocation(mipAccelProgram, "softening2"), cellSize * cellSize);
+    RunFieldPass(mipAccelFBO, GRID_RES_3D);
+
+    EndGPUSolveTimer(timed);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    lastGravityMs = std::chrono::duration<float, std::milli>(t1 - t0).count();  // Soumission CPU seule
+}
+
+// Envoie count accélérations dans treeAccBuffer (data peut être NULL : le GPU les écrit lui-même).
+// Le stockage n'est réalloué (et rattaché à treeAccTex) que si la capacité augmente.
+size_t treeAccCapacity = 0;
+bool UploadTreeAccelerations(size_t count, const float* data) {
+    static GLint maxTexels = 0;
+    if (!maxTexels) glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    if (count > (size_t)maxTexels) {
+        std::cerr << "Tree gravity: " << count << " particles exceed GL_MAX_TEXTURE_BUFFER_SIZE, falling back to CPU PM" << std::endl;
+        gravitySolver = GRAVITY_PM_CPU;
+        return false;
+    }
+
+    if (!treeAccBuffer) {
+        glGenBuffers(1, &treeAccBuffer);
+        glGenTextures(1, &treeAccTex);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, treeAccBuffer);
+    if (count > treeAccCapacity) {
+        glBufferData(GL_TEXTURE_BUFFER, count * sizeof(glm::vec4), data, GL_STREAM_DRAW);
+        treeAccCapacity = count;
+        glBindTexture(GL_TEXTURE_BUFFER, treeAccTex);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, treeAccBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    else if (data) {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, count * sizeof(glm::vec4), data);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    return true;
+}
+
+// Barnes-Hut, FMM ou somme directe (CPU) : relecture des positions -> forces -> upload des accélérations
+// (texture buffer). TreePM : Barnes-Hut ne calcule que la partie courte portée, appelé après ComputeMeshGravity.
+void ComputeTreeGravity() {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    const size_t count = particleCount;
+
+    treePositions.resize(count * 4);
+    treeAccelerations.resize(count * 4);
+    glBindBuffer(GL_ARRAY_BUFFER, posVBO[currIdx]);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::vec4), treePositions.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (gravitySolver == GRAVITY_FMM) {
+        fmm.ComputeAccelerations(treePositions.data(), count, gravityConstant, fmmOrder, fmmTheta, treeSoftening,
+                                 treeAccelerations.data());
+        const FMMStats& stats = fmm.Stats();
+        lastSolveMs = stats.buildMs + stats.upwardMs + stats.interactMs + stats.downwardMs;
+    } else if (gravitySolver == GRAVITY_DIRECT) {
+        directSum.ComputeAccelerations(treePositions.data(), count, gravityConstant, treeSoftening, treeAccelerations.data());
+        lastSolveMs = directSum.Stats().ms;
+    } else {
+        const bool treePM = gravitySolver == GRAVITY_TREEPM;
+        barnesHut.SetShortRange(treePM ? treePMSplit * gridSize / pmAllocatedRes : 0.0f);
+        barnesHut.ComputeAccelerations(treePositions.data(), count, gravityConstant, treeTheta, treeSoftening,
+                                       treeAccelerations.data());
+        const BarnesHutStats& stats = barnesHut.Stats();
+        lastSolveMs = stats.buildMs + stats.walkMs;
+    }
+    if (!UploadTreeAccelerations(count, treeAccelerations.data())) return;
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    lastGravityMs = std::chrono::duration<float, std::milli>(t1 - t0).count();
+}
+
+// P3M : relecture des positions -> sommes directes autour des cases denses (rcut = 2.5 cellules PM) -> upload.
+// Appelé après ComputeMeshGravity, dont la force de paire est retranchée (même résolution de maillage).
+void ComputeP3MCorrection() {
+    const size_t count = particleCount;
+    treePositions.resize(count * 4);
+    treeAccelerations.resize(count * 4);
+    glBindBuffer(GL_ARRAY_BUFFER, posVBO[currIdx]);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::vec4), treePositions.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    p3m.ComputeCorrection(treePositions.data(), count, gridSize, &gridCenter.x, GRID_RES_3D, pmAllocatedRes,
+                          gravityConstant, treeSoftening, p3mMassThreshold, treeAccelerations.data());
+    UploadTreeAccelerations(count, treeAccelerations.data());
 }
-)";
 
-// --- Compilation Shader Helper ---
-GLuint CreateShader(const char* src, GLenum type) {
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &src, NULL);
-    glCompileShader(shader);
-    // Check errors (simplifié)
-    GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        std::cerr << "SHADER ERROR:\n" << infoLog << std::endl;
+// Arbre GPU : posVBO est lu directement comme SSBO, les accélérations sont écrites dans treeAccBuffer
+void ComputeGPUTreeGravity() {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    if (!gpuTree.Init()) {
+        std::cerr << "GPU tree unavailable, falling back to CPU Barnes-Hut" << std::endl;
+        gravitySolver = GRAVITY_BARNES_HUT;
+        return;
     }
-    return shader;
-}
+    if (!UploadTreeAccelerations(particleCount, NULL)) return;
 
-void InitGPU() {
-    // 1. Setup Buffers CPU
-    std::vector<glm::vec4> initialPos;
-    std::vector<glm::vec4> initialVel;
-    InitParticlesCPU(initialPos, initialVel);
+    bool timed = BeginGPUSolveTimer();
+    gpuTree.ComputeAccelerations(posVBO[currIdx], particleCount, gravityConstant, treeTheta, treeSoftening, treeAccBuffer);
+    EndGPUSolveTimer(timed);
 
-    // 2. Setup VAO/VBOs
-    glGenVertexArrays(2, VAO);
-    glGenBuffers(2, posVBO);
-    glGenBuffers(2, velVBO);
-    glGenTransformFeedbacks(2, transformFeedback);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    lastGravityMs = std::chrono::duration<float, std::milli>(t1 - t0).count();  // Soumission CPU seule
+}
 
+// Textures et programmes de l'AMR, créés au premier usage
+void InitAMR() {
+    brickCountProgram = glCreateProgram();
+    amrDepositProgram = glCreateProgram();
+    const char* geometry[2] = { brickCountGS, amrDepositGS };
+    const char* fragment[2] = { brickCountFS, densityFS };
+    const GLuint programs[2] = { brickCountProgram, amrDepositProgram };
     for (int i = 0; i < 2; i++) {
-        glBindVertexArray(VAO[i]);
+        GLuint vs = CreateShader(densityVS, GL_VERTEX_SHADER);
+        GLuint gs = CreateShader(geometry[i], GL_GEOMETRY_SHADER);
+        GLuint fs = CreateShader(fragment[i], GL_FRAGMENT_SHADER);
+        glAttachShader(programs[i], vs);
+        glAttachShader(programs[i], gs);
+        glAttachShader(programs[i], fs);
+        glLinkProgram(programs[i]);
+        GLint success;
+        glGetProgramiv(programs[i], GL_LINK_STATUS, &success);
+        if(!success) {
+            char infoLog[512];
+            glGetProgramInfoLog(programs[i], 512, NULL, infoLog);
+            std::cerr << "AMR LINK ERROR:\n" << infoLog << std::endl;
+        }
+        glDeleteShader(vs);
+        glDeleteShader(gs);
+        glDeleteShader(fs);
+    }
+    amrFieldProgram = CreateFieldProgram(amrFieldFS, "AMR FIELD");
+
+    glGenTextures(1, &brickCountTex);
+    glBindTexture(GL_TEXTURE_3D, brickCountTex);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F, AMR_BRICKS, AMR_BRICKS, AMR_BRICKS, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    const std::vector<GLint> empty(AMR_BRICKS * AMR_BRICKS * AMR_BRICKS, -1);
+    glGenTextures(1, &brickTableTex);
+    glBindTexture(GL_TEXTURE_3D, brickTableTex);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R32I, AMR_BRICKS, AMR_BRICKS, AMR_BRICKS, 0, GL_RED_INTEGER, GL_INT, empty.data());
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    glGenTextures(1, &slotBrickTex);
+    glBindTexture(GL_TEXTURE_1D, slotBrickTex);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA32I, AMR_SLOTS, 0, GL_RGBA_INTEGER, GL_INT, NULL);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_1D, 0);
+
+    // Atlas : lecture trilinéaire dans une brique, jamais au-delà (centres bloqués dans physicsVS)
+    GLuint* atlases[2] = { &poolTex, &poolFieldTex };
+    for (GLuint* tex : atlases) {
+        glGenTextures(1, tex);
+        glBindTexture(GL_TEXTURE_3D, *tex);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA32F, AMR_POOL_X * AMR_FINE, AMR_POOL_Y * AMR_FINE, AMR_POOL_Z * AMR_FINE,
+                     0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    GLuint* fbos[3] = { &brickCountFBO, &poolFBO, &poolFieldFBO };
+    const GLuint targets[3] = { brickCountTex, poolTex, poolFieldTex };
+    for (int i = 0; i < 3; i++) {
+        glGenFramebuffers(1, fbos[i]);
+        glBindFramebuffer(GL_FRAMEBUFFER, *fbos[i]);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, targets[i], 0);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "AMR FBO Error! Status: " << glCheckFramebufferStatus(GL_FRAMEBUFFER) << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
 
-        // Position Buffer (vec4)
-        glBindBuffer(GL_ARRAY_BUFFER, posVBO[i]);
-        glBufferData(GL_ARRAY_BUFFER, PARTICLE_COUNT * sizeof(glm::vec4), initialPos.data(), GL_DYNAMIC_COPY);
-        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, NULL); // size 4
-        glEnableVertexAttribArray(0);
+// Comptage des particules par brique (GPU, relecture de AMR_BRICKS³ floats) -> briques à raffiner,
+// les plus peuplées d'abord tant qu'il reste des emplacements -> table d'indirection
+void RegridAMR() {
+    glBindFramebuffer(GL_FRAMEBUFFER, brickCountFBO);
+    glViewport(0, 0, AMR_BRICKS, AMR_BRICKS);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glUseProgram(brickCountProgram);
+    glUniform1f(glGetUniformLocation(brickCountProgram, "worldSize"), gridSize);
+    glUniform3fv(glGetUniformLocation(brickCountProgram, "gridCenter"), 1, &gridCenter.x);
+    glUniform1i(glGetUniformLocation(brickCountProgram, "bricks"), AMR_BRICKS);
+    glBindVertexArray(VAO[currIdx]);
+    glDrawArrays(GL_POINTS, 0, particleCount);
+    glDisable(GL_BLEND);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        // Velocity Buffer (vec4)
-        glBindBuffer(GL_ARRAY_BUFFER, velVBO[i]);
-        glBufferData(GL_ARRAY_BUFFER, PARTICLE_COUNT * sizeof(glm::vec4), initialVel.data(), GL_DYNAMIC_COPY);
-        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, NULL); // size 4
-        glEnableVertexAttribArray(1);
+    const int brickCount = AMR_BRICKS * AMR_BRICKS * AMR_BRICKS;
+    std::vector<float> counts(brickCount);
+    glBindTexture(GL_TEXTURE_3D, brickCountTex);
+    glGetTexImage(GL_TEXTURE_3D, 0, GL_RED, GL_FLOAT, counts.data());
+
+    std::vector<int> dense;
+    for (int b = 0; b < brickCount; b++)
+        if (counts[b] >= (float)amrThreshold) dense.push_back(b);
+    std::sort(dense.begin(), dense.end(), [&](int a, int b) { return counts[a] > counts[b]; });
+    if (dense.size() > (size_t)AMR_SLOTS) dense.resize(AMR_SLOTS);
+
+    std::vector<GLint> table(brickCount, -1);
+    std::vector<GLint> slots(AMR_SLOTS * 4, 0);
+    amrRefinedParticles = 0;
+    for (size_t slot = 0; slot < dense.size(); slot++) {
+        const int b = dense[slot];
+        table[b] = (GLint)slot;
+        slots[slot * 4 + 0] = b % AMR_BRICKS;
+        slots[slot * 4 + 1] = b / AMR_BRICKS % AMR_BRICKS;
+        slots[slot * 4 + 2] = b / (AMR_BRICKS * AMR_BRICKS);
+        amrRefinedParticles += (size_t)counts[b];
+    }
+    amrUsedSlots = (int)dense.size();
+
+    glBindTexture(GL_TEXTURE_3D, brickTableTex);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, AMR_BRICKS, AMR_BRICKS, AMR_BRICKS, GL_RED_INTEGER, GL_INT, table.data());
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glBindTexture(GL_TEXTURE_1D, slotBrickTex);
+    glTexSubImage1D(GL_TEXTURE_1D, 0, 0, AMR_SLOTS, GL_RGBA_INTEGER, GL_INT, slots.data());
+    glBindTexture(GL_TEXTURE_1D, 0);
+}
 
-        // Setup Transform Feedback pour ce set
-        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, transformFeedback[i]);
-        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, posVBO[i]);
-        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 1, velVBO[i]);
-        
-        glBindVertexArray(0);
+// Briques raffinées : dépôt dans le pool puis gradient de masse, après la grille de base
+void ComputeRefinedDensity() {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    if (!amrFieldProgram) InitAMR();
+    if (--amrCountdown < 0) {
+        RegridAMR();
+        amrCountdown = amrRegridInterval - 1;
     }
-    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+    const int poolWidth = AMR_POOL_X * AMR_FINE, poolHeight = AMR_POOL_Y * AMR_FINE;
 
-    // 3. Compile Physics Shader (TF)
-    GLuint vs = CreateShader(physicsVS, GL_VERTEX_SHADER);
-    physicsProgram = glCreateProgram();
-    glAttachShader(physicsProgram, vs);
+    glBindFramebuffer(GL_FRAMEBUFFER, poolFBO);
+    glViewport(0, 0, poolWidth, poolHeight);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    if (amrUsedSlots > 0) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glUseProgram(amrDepositProgram);
+        glUniform1f(glGetUniformLocation(amrDepositProgram, "worldSize"), gridSize);
+        glUniform3fv(glGetUniformLocation(amrDepositProgram, "gridCenter"), 1, &gridCenter.x);
+        glUniform1i(glGetUniformLocation(amrDepositProgram, "fineRes"), 2 * GRID_RES_3D);
+        glUniform1i(glGetUniformLocation(amrDepositProgram, "fineBrick"), AMR_FINE);
+        glUniform3i(glGetUniformLocation(amrDepositProgram, "poolSlots"), AMR_POOL_X, AMR_POOL_Y, AMR_POOL_Z);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_3D, brickTableTex);
+        glUniform1i(glGetUniformLocation(amrDepositProgram, "brickTable"), 0);
+        glBindVertexArray(VAO[currIdx]);
+        glDrawArrays(GL_POINTS, 0, particleCount);
+        glDisable(GL_BLEND);
+    }
 
-    // Indiquer ce qu'on veut capturer AVANT le linking
-    const char* varyings[] = { "outPos", "outVel" };
-    glTransformFeedbackVaryings(physicsProgram, 2, varyings, GL_SEPARATE_ATTRIBS);
-    
-    glLinkProgram(physicsProgram);
-    // Check Link Errors...
-    glDeleteShader(vs);
+    glUseProgram(amrFieldProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, densityTex);
+    glUniform1i(glGetUniformLocation(amrFieldProgram, "gridTex"), 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, poolTex);
+    glUniform1i(glGetUniformLocation(amrFieldProgram, "poolTex"), 1);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_3D, brickTableTex);
+    glUniform1i(glGetUniformLocation(amrFieldProgram, "brickTable"), 2);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_1D, slotBrickTex);
+    glUniform1i(glGetUniformLocation(amrFieldProgram, "slotBricks"), 3);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(glGetUniformLocation(amrFieldProgram, "usedSlots"), amrUsedSlots);
+    glUniform1i(glGetUniformLocation(amrFieldProgram, "fineRes"), 2 * GRID_RES_3D);
+    glUniform1i(glGetUniformLocation(amrFieldProgram, "fineBrick"), AMR_FINE);
+    glUniform3i(glGetUniformLocation(amrFieldProgram, "poolSlots"), AMR_POOL_X, AMR_POOL_Y, AMR_POOL_Z);
+    glBindFramebuffer(GL_FRAMEBUFFER, poolFieldFBO);
+    glViewport(0, 0, poolWidth, poolHeight);
+    glBindVertexArray(initVAO);
+    glDrawArrays(GL_POINTS, 0, AMR_POOL_Z * AMR_FINE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    // 4. Compile Render Shader
-    GLuint rVS = CreateShader(renderVS, GL_VERTEX_SHADER);
-    GLuint rFS = CreateShader(renderFS, GL_FRAGMENT_SHADER);
-    renderProgram = glCreateProgram();
-    glAttachShader(renderProgram, rVS);
-    glAttachShader(renderProgram, rFS);
-    glLinkProgram(renderProgram);
-    glDeleteShader(rVS);
-    glDeleteShader(rFS);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    lastAmrMs = std::chrono::duration<float, std::milli>(t1 - t0).count();
+}
 
-    // 5. Compile Grid Shader
-    GLuint gVS = CreateShader(gridVS, GL_VERTEX_SHADER);
-    GLuint gFS = CreateShader(gridFS, GL_FRAGMENT_SHADER);
-    GLuint gridProgram = glCreateProgram();
-    glAttachShader(gridProgram, gVS);
-    glAttachShader(gridProgram, gFS);
-    glLinkProgram(gridProgram);
-    glDeleteShader(gVS);
-    glDeleteShader(gFS);
+// Boîte adaptative : centre de masse puis histogramme radial de posVBO[currIdx] (réductions GPU, deux
+// relectures de quelques texels), puis centre et taille des grilles pour les pas suivants
+void UpdateSimulationBox() {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    if (!boxProgram) {
+        GLuint vs = CreateShader(boxReduceVS, GL_VERTEX_SHADER);
+        GLuint fs = CreateShader(boxReduceFS, GL_FRAGMENT_SHADER);
+        boxProgram = glCreateProgram();
+        glAttachShader(boxProgram, vs);
+        glAttachShader(boxProgram, fs);
+        glLinkProgram(boxProgram);
+        GLint success;
+        glGetProgramiv(boxProgram, GL_LINK_STATUS, &success);
+        if(!success) {
+            char infoLog[512];
+            glGetProgramInfoLog(boxProgram, 512, NULL, infoLog);
+            std::cerr << "BOX LINK ERROR:\n" << infoLog << std::endl;
+        }
+        glDeleteShader(vs);
+        glDeleteShader(fs);
+
+        glGenTextures(1, &boxTex);
+        glBindTexture(GL_TEXTURE_2D, boxTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, BOX_BINS, 2, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glGenFramebuffers(1, &boxFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, boxFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, boxTex, 0);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "Box FBO Error! Status: " << glCheckFramebufferStatus(GL_FRAMEBUFFER) << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, boxFBO);
+    glViewport(0, 0, BOX_BINS, 2);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glUseProgram(boxProgram);
+    glUniform1i(glGetUniformLocation(boxProgram, "bins"), BOX_BINS);
+    glUniform1f(glGetUniformLocation(boxProgram, "binsPerOctave"), BOX_BINS_PER_OCTAVE);
+    glBindVertexArray(VAO[currIdx]);
+
+    // 1. Centre de masse, sommé relativement au centre actuel (précision des sommes float)
+    glUniform1i(glGetUniformLocation(boxProgram, "pass"), 0);
+    glUniform3fv(glGetUniformLocation(boxProgram, "center"), 1, &gridCenter.x);
+    glDrawArrays(GL_POINTS, 0, particleCount);
+    glm::vec4 moments;
+    glReadPixels(0, 1, 1, 1, GL_RGBA, GL_FLOAT, &moments.x);
+    if (moments.w <= 0.0f) {
+        glDisable(GL_BLEND);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return;
+    }
+    const glm::vec3 center = gridCenter + glm::vec3(moments) / moments.w;
+
+    // 2. Masse par intervalle de distance au centre de masse
+    glUniform1i(glGetUniformLocation(boxProgram, "pass"), 1);
+    glUniform3fv(glGetUniformLocation(boxProgram, "center"), 1, &center.x);
+    glDrawArrays(GL_POINTS, 0, particleCount);
+    std::vector<glm::vec4> histogram(BOX_BINS);
+    glReadPixels(0, 0, BOX_BINS, 1, GL_RGBA, GL_FLOAT, histogram.data());
+    glDisable(GL_BLEND);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // Plus petit rayon (bord haut d'intervalle) couvrant boxCoverage de la masse
+    double total = 0.0, covered = 0.0;
+    for (const glm::vec4& bin : histogram) total += bin.x;
+    int last = 0;
+    while (last < BOX_BINS - 1 && covered + histogram[last].x < boxCoverage * total) covered += histogram[last++].x;
+    const float radius = std::exp2((last + 1) / BOX_BINS_PER_OCTAVE);
+    const float needed = std::max(2.0f * radius * boxMargin, (float)GRID_RES_3D);
+    if (needed > gridSize || needed < BOX_SHRINK * gridSize) gridSize = needed;
+    gridCenter = center;
+    boxMassCenter = glm::vec4(center, (float)total);
+
+    // Intervalles entièrement hors du cube (demi-côté gridSize / 2)
+    const int inside = (int)std::ceil(std::log2(0.5f * gridSize) * BOX_BINS_PER_OCTAVE);
+    double outside = 0.0;
+    for (int b = std::max(inside, 0); b < BOX_BINS; b++) outside += histogram[b].x;
+    boxOutsideFraction = (float)(outside / total);
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    lastBoxMs = std::chrono::duration<float, std::milli>(t1 - t0).count();
 }
 
-void InitDensityMap() {
-    // 1. Framebuffer
-    glGenFramebuffers(1, &densityFBO);
+// Retour à la boîte fixe d'origine ; la prochaine mise à jour adaptative se fera au pas suivant
+void ResetSimulationBox() {
+    gridCenter = glm::vec3(0.0f);
+    gridSize = WORLD_SIZE;
+    boxMassCenter = glm::vec4(0.0f);
+    boxUpdateCountdown = 0;
+    amrCountdown = 0;
+}
+
+// Carte de densité (densityGS) puis gravité du solveur choisi, pour les positions de posVBO[currIdx]
+void ComputeGravity() {
+    if (adaptiveBox && --boxUpdateCountdown < 0) {
+        UpdateSimulationBox();
+        boxUpdateCountdown = boxUpdateInterval - 1;
+    }
+
+    // Pyramide de masse : le dépôt écrit aussi les moments du niveau 0 (second attachement)
+    const bool pyramid = gravitySolver == GRAVITY_MIP_PYRAMID;
+    if (pyramid && !mipAccelProgram) InitMipPyramid();
+
     glBindFramebuffer(GL_FRAMEBUFFER, densityFBO);
+    const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(pyramid ? 2 : 1, drawBuffers);
+    // Viewport doit couvrir x,y de la texture 3D
+    glViewport(0, 0, GRID_RES_3D, GRID_RES_3D);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
     
-    // 2. Texture 3D (Float R,G,B,A pour Masse, MomX, MomY, MomZ)
-    // GL_RGB32F -> GL_RGBA32F car on a besoin de 4 composants
-    glGenTextures(1, &densityTex);
-    glBindTexture(GL_TEXTURE_3D, densityTex);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA32F, GRID_RES_3D, GRID_RES_3D, GRID_RES_3D, 0, GL_RGBA, GL_FLOAT, NULL);
+    // Additive blending
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE); 
     
-    // Pas de mipmaps pour l'instant en 3D (couteux et complexe à générer sans compute)
-    // On reste sur du Nearest/Linear local pour la gravité short-range
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); 
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    // Attacher la texture 3D au FBO pour Layered Rendering
-    // On attache toute la texture, le Geometry Shader choisira la layer (Z)
-    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, densityTex, 0);
+    glUseProgram(densityProgram);
+    glUniform1f(glGetUniformLocation(densityProgram, "worldSize"), gridSize);
+    glUniform3fv(glGetUniformLocation(densityProgram, "gridCenter"), 1, &gridCenter.x);
+    glUniform1i(glGetUniformLocation(densityProgram, "gridRes"), GRID_RES_3D);
     
-    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cerr << "Density FBO Error! Status: " << glCheckFramebufferStatus(GL_FRAMEBUFFER) << std::endl;
-        
+    glBindVertexArray(VAO[currIdx]);
+    glDrawArrays(GL_POINTS, 0, particleCount);
+    
+    glDisable(GL_BLEND);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    // 3. Shader
-    GLuint vs = CreateShader(densityVS, GL_VERTEX_SHADER);
-    GLuint gs = CreateShader(densityGS, GL_GEOMETRY_SHADER);
-    GLuint fs = CreateShader(densityFS, GL_FRAGMENT_SHADER);
-    densityProgram = glCreateProgram();
-    glAttachShader(densityProgram, vs);
-    glAttachShader(densityProgram, gs);
-    glAttachShader(densityProgram, fs);
-    glLinkProgram(densityProgram);
-    // check errors...
-    GLint success;
-    glGetProgramiv(densityProgram, GL_LINK_STATUS, &success);
-    if(!success) {
-        char infoLog[512];
-        glGetProgramInfoLog(densityProgram, 512, NULL, infoLog);
-        std::cerr << "DENSITY LINK ERROR:\n" << infoLog << std::endl;
+    // Gradient de masse par cellule : une lecture par particule au lieu de six
+    glUseProgram(fieldProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, densityTex);
+    glUniform1i(glGetUniformLocation(fieldProgram, "gridTex"), 0);
+    RunFieldPass(fieldFBO, GRID_RES_3D);
+    if (amrEnabled) ComputeRefinedDensity();
+    if (pyramid) ComputeMipGravity();
+
+    // Gravité longue portée : potentiel particle-mesh
+    if (UsesParticleMesh()) ComputeMeshGravity();
+    if (UsesMeshField()) ComputeMeshField();
+    if (UsesP3M()) ComputeP3MCorrection();
+    if (gravitySolver == GRAVITY_BARNES_HUT || gravitySolver == GRAVITY_FMM || gravitySolver == GRAVITY_TREEPM ||
+        gravitySolver == GRAVITY_DIRECT)
+        ComputeTreeGravity();
+    else if (gravitySolver == GRAVITY_GPU_TREE) ComputeGPUTreeGravity();
+}
+
+// Pas de physicsVS : posVBO/velVBO[currIdx] -> [nextIdx] par Transform Feedback, avec les forces de ComputeGravity
+void RunPhysicsStep(float stepDt, float bhMass, float friction) {
+    glUseProgram(physicsProgram);
+    
+    glUniform1f(glGetUniformLocation(physicsProgram, "dt"), stepDt);
+    glUniform1f(glGetUniformLocation(physicsProgram, "blackHoleMass"), bhMass);
+    glUniform2f(glGetUniformLocation(physicsProgram, "centerPos"), 0.0f, 0.0f);
+    glUniform1f(glGetUniformLocation(physicsProgram, "worldSize"), gridSize);
+    glUniform3fv(glGetUniformLocation(physicsProgram, "gridCenter"), 1, &gridCenter.x);
+    glUniform4fv(glGetUniformLocation(physicsProgram, "boxMassCenter"), 1, &boxMassCenter.x);
+    glUniform1f(glGetUniformLocation(physicsProgram, "gravityConstant"), gravityConstant);
+    glUniform1f(glGetUniformLocation(physicsProgram, "frictionStrength"), friction);
+    const float boxRatio = WORLD_SIZE / gridSize;
+    // Gradient historique : écart de masse entre cellules voisines ≈ 2 h⁴ ∂ρ/∂x pour des cellules de côté h.
+    // selfGravityStrength est réglé pour la boîte WORLD_SIZE : x (WORLD_SIZE / gridSize)⁴ à densité égale.
+    const float boxRatio2 = boxRatio * boxRatio;
+    glUniform1f(glGetUniformLocation(physicsProgram, "selfGravityStrength"), selfGravityStrength * boxRatio2 * boxRatio2);
+    glUniform1f(glGetUniformLocation(physicsProgram, "frictionMassScale"), boxRatio * boxRatio * boxRatio);
+    
+    // Bind Texture Grid 3D (friction) et son gradient par cellule
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, densityTex);
+    glUniform1i(glGetUniformLocation(physicsProgram, "gridTex"), 0);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_3D, fieldTex);
+    glUniform1i(glGetUniformLocation(physicsProgram, "fieldTex"), 3);
+
+    // La pyramide de masse passe par le même chemin qu'un champ PM précalculé
+    const bool pyramid = gravitySolver == GRAVITY_MIP_PYRAMID;
+    const bool meshField = UsesMeshField();
+    const int gravityMode = (UsesParticleMesh() || pyramid ? 1 : 0) | (UsesTree() || UsesP3M() ? 2 : 0) |
+                            (meshField || pyramid ? 4 : 0);
+    glUniform1i(glGetUniformLocation(physicsProgram, "gravityMode"), gravityMode);
+    glUniform1f(glGetUniformLocation(physicsProgram, "meshRes"), (float)pmAllocatedRes);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, pmPotentialTex);
+    glUniform1i(glGetUniformLocation(physicsProgram, "potentialTex"), 1);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_BUFFER, treeAccTex);
+    glUniform1i(glGetUniformLocation(physicsProgram, "treeAccTex"), 2);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_3D, pyramid ? mipAccelTex : meshField ? meshFieldTex : 0);
+    glUniform1i(glGetUniformLocation(physicsProgram, "meshFieldTex"), 4);
+
+    // Grilles emboîtées sur les unités 5 à 8
+    const int nested = gravitySolver == GRAVITY_MULTIGRID ? activeNested : 0;
+    glm::vec4 nestedBox[MAX_NESTED];
+    GLint nestedUnits[MAX_NESTED];
+    for (int k = 0; k < MAX_NESTED; k++) {
+        nestedBox[k] = glm::vec4(nestedGrids[k].center, nestedGrids[k].size);
+        nestedUnits[k] = 5 + k;
+        glActiveTexture(GL_TEXTURE5 + k);
+        glBindTexture(GL_TEXTURE_3D, k < nested ? nestedGrids[k].fieldTex : 0);
+    }
+    glUniform1i(glGetUniformLocation(physicsProgram, "nestedLevels"), nested);
+    glUniform4fv(glGetUniformLocation(physicsProgram, "nestedBox"), MAX_NESTED, &nestedBox[0].x);
+    glUniform1iv(glGetUniformLocation(physicsProgram, "nestedFieldTex"), MAX_NESTED, nestedUnits);
+    glUniform1f(glGetUniformLocation(physicsProgram, "nestedMargin"), (float)NESTED_MARGIN / pmAllocatedRes);
+
+    // Briques raffinées sur les unités 9 à 11
+    glUniform1i(glGetUniformLocation(physicsProgram, "amrBricks"), amrEnabled ? AMR_BRICKS : 0);
+    glUniform1i(glGetUniformLocation(physicsProgram, "fineBrick"), AMR_FINE);
+    glUniform3i(glGetUniformLocation(physicsProgram, "poolSlots"), AMR_POOL_X, AMR_POOL_Y, AMR_POOL_Z);
+    glActiveTexture(GL_TEXTURE9);
+    glBindTexture(GL_TEXTURE_3D, brickTableTex);
+    glUniform1i(glGetUniformLocation(physicsProgram, "brickTable"), 9);
+    glActiveTexture(GL_TEXTURE10);
+    glBindTexture(GL_TEXTURE_3D, poolTex);
+    glUniform1i(glGetUniformLocation(physicsProgram, "poolTex"), 10);
+    glActiveTexture(GL_TEXTURE11);
+    glBindTexture(GL_TEXTURE_3D, poolFieldTex);
+    glUniform1i(glGetUniformLocation(physicsProgram, "poolFieldTex"), 11);
+    glActiveTexture(GL_TEXTURE0);
+
+    // On désactive le rendu graphique, on veut juste écrire dans les buffers
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    // Bind Source VAO (Current)
+    glBindVertexArray(VAO[currIdx]);
+
+    // Bind Destination TF (Next)
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, transformFeedback[nextIdx]);
+
+    // Start TF
+    glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, particleCount);
+    glEndTransformFeedback();
+
+    // Cleanup (le swap des indices reste à l'appelant)
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+    glDisable(GL_RASTERIZER_DISCARD);
+}
+
+// Erreur de la gravité réellement appliquée par physicsVS (tous modes, y compris le gradient historique),
+// mesurée contre la somme directe sur ACCURACY_SAMPLES particules réparties dans le tableau.
+// Un pas sans trou noir ni friction est écrit dans [nextIdx] : Δv / dt = accélération (dt grand : l'arrondi
+// de v + a dt devient négligeable). Ces buffers sont écrasés au pas suivant. ComputeGravity peut déplacer la
+// boîte ou refaire les briques AMR si leur tour est venu : boîte et compteurs sont restaurés, le pas suivant
+// refait donc la même mise à jour depuis les mêmes positions (la table des briques est réécrite en entier).
+// Seul le multigrille repart du potentiel de la mesure, calculé sur ces mêmes positions.
+void MeasureGravityAccuracy() {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    const size_t count = particleCount;
+    const float probeDt = 1.0e4f;
+    const glm::vec3 savedCenter = gridCenter;
+    const float savedSize = gridSize, savedOutside = boxOutsideFraction;
+    const glm::vec4 savedMassCenter = boxMassCenter;
+    const int savedBoxCountdown = boxUpdateCountdown, savedAmrCountdown = amrCountdown;
+    ComputeGravity();
+    RunPhysicsStep(probeDt, 0.0f, 0.0f);
+    gridCenter = savedCenter;
+    gridSize = savedSize;
+    boxOutsideFraction = savedOutside;
+    boxMassCenter = savedMassCenter;
+    boxUpdateCountdown = savedBoxCountdown;
+    amrCountdown = savedAmrCountdown;
+
+    std::vector<glm::vec4> positions(count), before(count), after(count);
+    glBindBuffer(GL_ARRAY_BUFFER, posVBO[currIdx]);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::vec4), positions.data());
+    glBindBuffer(GL_ARRAY_BUFFER, velVBO[currIdx]);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::vec4), before.data());
+    glBindBuffer(GL_ARRAY_BUFFER, velVBO[nextIdx]);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::vec4), after.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    const size_t samples = std::min(ACCURACY_SAMPLES, count);
+    std::vector<uint32_t> targets(samples);
+    for (size_t s = 0; s < samples; s++) targets[s] = (uint32_t)(s * count / samples);
+    std::vector<glm::vec4> reference(samples);
+    directSum.ComputeTargets(&positions[0].x, count, targets.data(), samples, gravityConstant, treeSoftening,
+                             &reference[0].x);
+
+    double error2 = 0.0, norm2 = 0.0;
+    std::vector<float> relative(samples);
+    for (size_t s = 0; s < samples; s++) {
+        const glm::vec3 applied = glm::vec3(after[targets[s]] - before[targets[s]]) / probeDt;
+        const glm::vec3 exact = glm::vec3(reference[s]);
+        const float e2 = glm::dot(applied - exact, applied - exact), n2 = glm::dot(exact, exact);
+        error2 += e2;
+        norm2 += n2;
+        relative[s] = n2 > 0.0f ? std::sqrt(e2 / n2) : 0.0f;
     }
+    std::sort(relative.begin(), relative.end());
+    accuracyRms = norm2 > 0.0 ? (float)std::sqrt(error2 / norm2) : 0.0f;
+    accuracyMedian = samples ? relative[samples / 2] : 0.0f;
+    accuracyMax = samples ? relative.back() : 0.0f;
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    accuracyMs = std::chrono::duration<float, std::milli>(t1 - t0).count();
 }
 
 void InitPostProcessing(int width, int height) {
@@ -644,18 +2731,348 @@ void RenderQuad() {
     glBindVertexArray(0);
 }
 
+// --- Régénération en arrière-plan ---
+// Le CPU génère dans un buffer de staging mappé (façon PBO) pendant que la simulation continue.
+// Quand le thread a fini : unmap + copie GPU -> GPU dans les VBOs courants, entre deux frames.
+// Un fence suit cette copie ; une fois passé, la mémoire du staging est rendue au driver.
+struct RegenerationJob {
+    std::thread worker;
+    std::atomic<bool> finished{false};
+    bool running = false;
+    bool restartRequested = false;   // Reset pressé pendant une génération : on relance avec les nouveaux paramètres
+    bool cancelled = false;          // Les VBOs ont été remplis autrement (scène) : résultat ignoré, pas de relance
+    InitialConditionSettings settings;
+    float elapsedMs = 0.0f;
+};
+
+RegenerationJob regenJob;
+GLuint stagingBuffer = 0;
+GLsync stagingFence = 0;
+
+bool StartRegeneration() {
+    if (stagingBuffer == 0) glGenBuffers(1, &stagingBuffer);
+
+    regenJob.settings = CaptureInitialConditions();
+    const size_t count = regenJob.settings.count;
+    const GLsizeiptr bytes = 2 * count * sizeof(glm::vec4); // [positions | vitesses]
+
+    // Orphelinage : si l'ancienne copie n'est pas terminée, le driver fournit un nouveau stockage
+    glBindBuffer(GL_COPY_WRITE_BUFFER, stagingBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, bytes, NULL, GL_STREAM_COPY);
+    void* mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (!mapped) return false;
+
+    glm::vec4* positions = static_cast<glm::vec4*>(mapped);
+    glm::vec4* velocities = positions + count;
+
+    regenJob.finished = false;
+    regenJob.running = true;
+    regenJob.restartRequested = false;
+    regenJob.cancelled = false;
+    const bool writeCache = icDiskCache;
+    regenJob.worker = std::thread([positions, velocities, writeCache] {
+        const InitialConditionSettings& ic = regenJob.settings;
+        ICCacheWriter cache;
+        if (writeCache && cache.Begin(HashInitialConditions(ic), ic.count)) {
+            // Génération dans les pages du fichier de cache, puis copie séquentielle vers le staging
+            regenJob.elapsedMs = InitParticlesCPU(ic, cache.Positions(), cache.Velocities());
+            std::memcpy(positions, cache.Positions(), ic.count * sizeof(glm::vec4));
+            std::memcpy(velocities, cache.Velocities(), ic.count * sizeof(glm::vec4));
+            cache.Commit();
+        } else {
+            regenJob.elapsedMs = InitParticlesCPU(ic, positions, velocities);
+        }
+        regenJob.finished = true;
+    });
+    return true;
+}
+
+// Appelé chaque frame : applique le résultat dès qu'il est prêt, sans jamais bloquer
+void PollRegeneration() {
+    if (stagingFence) {
+        GLenum state = glClientWaitSync(stagingFence, 0, 0);
+        if (state == GL_ALREADY_SIGNALED || state == GL_CONDITION_SATISFIED) {
+            glDeleteSync(stagingFence);
+            stagingFence = 0;
+            // Copie terminée côté GPU : libère le staging (16 Mo par million de particules). Pas si une
+            // nouvelle génération a déjà remappé ce buffer : son thread écrit dedans.
+            if (!regenJob.running) {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, stagingBuffer);
+                glBufferData(GL_COPY_WRITE_BUFFER, 0, NULL, GL_STREAM_COPY);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            }
+        }
+    }
+
+    if (!regenJob.running || !regenJob.finished) return;
+
+    regenJob.worker.join();
+    regenJob.running = false;
+
+    glBindBuffer(GL_COPY_READ_BUFFER, stagingBuffer);
+    bool valid = glUnmapBuffer(GL_COPY_READ_BUFFER) == GL_TRUE;
+    icCacheBytes = ICCacheBytes();
+
+    if (regenJob.cancelled) {
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        return;
+    }
+    if (regenJob.restartRequested || regenJob.settings.count != targetParticleCount) {
+        // Résultat périmé (paramètres ou nombre de particules changés) : on ne l'applique pas
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        if (!LoadCachedParticles()) StartRegeneration();
+        return;
+    }
+
+    // Nouveau nombre et nouvelles données ensemble : jusqu'ici la simulation tournait sur l'ancien jeu
+    if (valid && !ReserveParticles((unsigned int)regenJob.settings.count)) {
+        std::cerr << "Regeneration: no room for " << regenJob.settings.count << " particles" << std::endl;
+        targetParticleCount = particleCount;
+        valid = false;
+    }
+    if (valid) {
+        particleCount = (unsigned int)regenJob.settings.count;
+        const GLsizeiptr bytes = regenJob.settings.count * sizeof(glm::vec4);
+        glBindBuffer(GL_COPY_READ_BUFFER, stagingBuffer);   // ReserveParticles a pu changer la liaison
+        // Seul le set courant compte : le prochain pas de physique écrit l'autre
+        glBindBuffer(GL_COPY_WRITE_BUFFER, posVBO[currIdx]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, velVBO[currIdx]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, bytes, 0, bytes);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        if (stagingFence) glDeleteSync(stagingFence);
+        stagingFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        lastInitMs = regenJob.elapsedMs;
+        initTimerPending = false;
+        lastInitFromCache = false;
+        boxUpdateCountdown = 0;
+        amrCountdown = 0;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void ShutdownRegeneration() {
+    if (regenJob.running) {
+        regenJob.worker.join();
+        regenJob.running = false;
+        glBindBuffer(GL_COPY_READ_BUFFER, stagingBuffer);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    if (stagingFence) glDeleteSync(stagingFence);
+    if (stagingBuffer) glDeleteBuffers(1, &stagingBuffer);
+}
+
+// --- Scène multi-galaxies ---
+// Chaque galaxie = un gabarit (modèle + seed + budget de particules) + une orbite (position, vitesse, axe de spin).
+// Les gabarits sont générés une seule fois sur CPU et gardés en VRAM ; composer la scène ne fait que
+// les instancier par Transform Feedback dans des plages consécutives de posVBO/velVBO.
+struct SceneGalaxy {
+    InitialConditionSettings model;   // model.count = budget de particules de la galaxie
+    glm::vec3 position;
+    glm::vec3 velocity;
+    glm::vec3 spinAxis;               // Axe du moment cinétique (z dans le repère du gabarit)
+};
+
+struct GalaxyTemplate {
+    GLuint buffer = 0;     // [positions | vitesses]
+    GLuint vao = 0;
+    size_t count = 0;
+    unsigned int lastUse = 0;
+};
+
+std::vector<SceneGalaxy> sceneGalaxies;
+bool sceneMode = false;                 // Reset recompose la scène au lieu d'une galaxie isolée
+std::map<uint64_t, GalaxyTemplate> templateCache;
+unsigned int sceneComposeCount = 0;
+const size_t TEMPLATE_CACHE_BUDGET = 512ull << 20; // Octets de VRAM pour les gabarits inutilisés
+
+size_t TemplateCacheBytes() {
+    size_t bytes = 0;
+    for (const auto& entry : templateCache) bytes += entry.second.count * 2 * sizeof(glm::vec4);
+    return bytes;
+}
+
+// Renvoie le gabarit, généré (CPU, parallèle) puis uploadé au premier usage seulement
+const GalaxyTemplate& AcquireTemplate(const InitialConditionSettings& ic, float& generationMs) {
+    GalaxyTemplate& tpl = templateCache[HashInitialConditions(ic)];
+    tpl.lastUse = sceneComposeCount;
+    if (tpl.buffer != 0) return tpl;
+
+    // Même disposition [positions | vitesses] que le fichier de cache : un seul upload dans les deux cas
+    const uint64_t hash = HashInitialConditions(ic);
+    const GLsizeiptr bytes = 2 * ic.count * sizeof(glm::vec4);
+    tpl.count = ic.count;
+    glGenBuffers(1, &tpl.buffer);
+    glGenVertexArrays(1, &tpl.vao);
+    glBindVertexArray(tpl.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, tpl.buffer);
+
+    ICCacheReader entry;
+    if (icDiskCache && entry.Open(hash, ic.count)) {
+        glBufferData(GL_ARRAY_BUFFER, bytes, entry.Positions(), GL_STATIC_DRAW);
+    } else {
+        std::vector<glm::vec4> data(2 * ic.count);
+        generationMs += InitParticlesCPU(ic, data.data(), data.data() + ic.count);
+        glBufferData(GL_ARRAY_BUFFER, bytes, data.data(), GL_STATIC_DRAW);
+        if (icDiskCache) ICCacheWrite(hash, ic.count, data.data(), data.data() + ic.count);
+    }
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, NULL);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)(ic.count * sizeof(glm::vec4)));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return tpl;
+}
+
+void ReleaseTemplate(GalaxyTemplate& tpl) {
+    glDeleteVertexArrays(1, &tpl.vao);
+    glDeleteBuffers(1, &tpl.buffer);
+    tpl = GalaxyTemplate();
+}
+
+// Libère les gabarits les plus anciens (hors scène courante) au-delà du budget
+void TrimTemplateCache() {
+    size_t bytes = TemplateCacheBytes();
+    while (bytes > TEMPLATE_CACHE_BUDGET) {
+        auto oldest = templateCache.end();
+        for (auto it = templateCache.begin(); it != templateCache.end(); ++it) {
+            if (it->second.lastUse == sceneComposeCount) continue;
+            if (oldest == templateCache.end() || it->second.lastUse < oldest->second.lastUse) oldest = it;
+        }
+        if (oldest == templateCache.end()) break;
+        bytes -= oldest->second.count * 2 * sizeof(glm::vec4);
+        ReleaseTemplate(oldest->second);
+        templateCache.erase(oldest);
+    }
+}
+
+void ClearTemplateCache() {
+    for (auto& entry : templateCache) ReleaseTemplate(entry.second);
+    templateCache.clear();
+}
+
+// Rotation qui amène l'axe z du gabarit sur l'axe de spin demandé
+glm::mat3 SpinRotation(glm::vec3 axis) {
+    const glm::vec3 z(0.0f, 0.0f, 1.0f);
+    if (glm::length(axis) < 1e-6f) return glm::mat3(1.0f);
+    axis = glm::normalize(axis);
+    glm::vec3 pivot = glm::cross(z, axis);
+    float c = glm::clamp(glm::dot(z, axis), -1.0f, 1.0f);
+    if (glm::length(pivot) < 1e-6f) {
+        // Axe (anti)parallèle à z : identité ou demi-tour autour de x (rotation inversée)
+        return c > 0.0f ? glm::mat3(1.0f) : glm::mat3(glm::rotate(glm::mat4(1.0f), 3.14159265f, glm::vec3(1.0f, 0.0f, 0.0f)));
+    }
+    return glm::mat3(glm::rotate(glm::mat4(1.0f), std::acos(c), glm::normalize(pivot)));
+}
+
+bool ComposeScene() {
+    unsigned long long total = 0;
+    for (const SceneGalaxy& g : sceneGalaxies) total += g.model.count;
+    if (total == 0 || total > 0x0FFFFFFF) return false;
+
+    // 1. Gabarits : seuls ceux qui n'ont jamais été générés coûtent du CPU
+    sceneComposeCount++;
+    float generationMs = 0.0f;
+    std::vector<const GalaxyTemplate*> templates;
+    for (const SceneGalaxy& g : sceneGalaxies) templates.push_back(&AcquireTemplate(g.model, generationMs));
+
+    if (!SetParticleCount((unsigned int)total)) return false;
+    if (regenJob.running) regenJob.cancelled = true; // Sinon son résultat écraserait la scène
+
+    // 2. Instanciation GPU : chaque galaxie écrit dans sa plage [offset, offset + count)
+    BeginInitTimer();
+
+    glUseProgram(sceneProgram);
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, sceneTF);
+    GLintptr offset = 0;
+    for (size_t k = 0; k < sceneGalaxies.size(); k++) {
+        const SceneGalaxy& g = sceneGalaxies[k];
+        const GalaxyTemplate& tpl = *templates[k];
+        const GLsizeiptr bytes = tpl.count * sizeof(glm::vec4);
+
+        glm::mat3 rotation = SpinRotation(g.spinAxis);
+        glUniformMatrix3fv(glGetUniformLocation(sceneProgram, "rotation"), 1, GL_FALSE, &rotation[0][0]);
+        glUniform3fv(glGetUniformLocation(sceneProgram, "offset"), 1, &g.position[0]);
+        glUniform3fv(glGetUniformLocation(sceneProgram, "bulkVelocity"), 1, &g.velocity[0]);
+
+        glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, posVBO[currIdx], offset, bytes);
+        glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 1, velVBO[currIdx], offset, bytes);
+        glBindVertexArray(tpl.vao);
+        glBeginTransformFeedback(GL_POINTS);
+            glDrawArrays(GL_POINTS, 0, (GLsizei)tpl.count);
+        glEndTransformFeedback();
+        offset += bytes;
+    }
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    EndInitTimer(generationMs);
+
+    TrimTemplateCache();
+    icCacheBytes = ICCacheBytes();
+    return true;
+}
+
+// Ajoute une galaxie avec le modèle courant de l'UI
+void AddSceneGalaxy(size_t budget, glm::vec3 position, glm::vec3 velocity, glm::vec3 spinAxis) {
+    SceneGalaxy g;
+    g.model = CaptureInitialConditions();
+    g.model.count = budget;
+    if (g.model.model == IC_COSMOLOGICAL) g.model.count = CosmologyParticleCount(g.model.cosmology);
+    g.model.seed += (uint32_t)sceneGalaxies.size(); // Galaxies distinctes par défaut
+    g.position = position;
+    g.velocity = velocity;
+    g.spinAxis = spinAxis;
+    sceneGalaxies.push_back(g);
+}
+
 void ResetSimulation() {
+    boxUpdateCountdown = 0;     // Nouvelles positions : boîte et briques recalculées au prochain pas
+    amrCountdown = 0;
+    if (sceneMode && !sceneGalaxies.empty()) {
+        ComposeScene();
+        return;
+    }
+
+    // La boîte cosmologique impose son nombre de particules (réseau gridSize³)
+    if (icModel == IC_COSMOLOGICAL) {
+        size_t lattice = CosmologyParticleCount(cosmoParams);
+        targetParticleCount = (unsigned int)lattice;
+    }
+
+    if (gpuInitialConditions && icModel == IC_LEGACY_DISK) {
+        if (SetParticleCount(targetParticleCount)) GenerateParticlesGPU();
+        return;
+    }
+
+    // Paramètres déjà générés : lecture du cache disque, immédiate
+    if (LoadCachedParticles()) {
+        if (regenJob.running) regenJob.cancelled = true;
+        return;
+    }
+
+    // Génération CPU : en arrière-plan, la simulation continue en attendant
+    if (regenJob.running) {
+        regenJob.restartRequested = true;
+        regenJob.cancelled = false;
+        return;
+    }
+    if (StartRegeneration()) return;
+
+    // Mapping impossible : repli synchrone
+    if (!SetParticleCount(targetParticleCount)) return;
     std::vector<glm::vec4> initialPos; // vec4
     std::vector<glm::vec4> initialVel;
     InitParticlesCPU(initialPos, initialVel);
     
     // Re-upload aux deux buffers pour être sûr
-    for(int i=0; i<2; i++) {
-        glBindBuffer(GL_ARRAY_BUFFER, posVBO[i]);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, PARTICLE_COUNT * sizeof(glm::vec4), initialPos.data());
-        glBindBuffer(GL_ARRAY_BUFFER, velVBO[i]);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, PARTICLE_COUNT * sizeof(glm::vec4), initialVel.data());
-    }
+    UploadParticles(initialPos, initialVel);
 }
 
 // --- Grid Visualization ---
@@ -664,11 +3081,11 @@ GLuint gridVBO, gridVAO;
 bool showGrid = false;
 int gridLinesCount = 0;
 
+// Lignes du cube unité [-0.5, 0.5]³ : la matrice model les place sur la boîte courante (gridCenter, gridSize)
 void InitGrid() {
     // Generate grid lines
     std::vector<glm::vec3> lines;
-    float step = WORLD_SIZE / (float)GRID_RES_3D;
-    float halfSize = WORLD_SIZE / 2.0f;
+    float halfSize = 0.5f;
 
     // We'll draw a simplified grid, maybe every N cells to avoid clutter
     // Drawing every 4th cell line
@@ -677,8 +3094,8 @@ void InitGrid() {
     // Lines along X
     for (int y = 0; y <= GRID_RES_3D; y += stride) {
         for (int z = 0; z <= GRID_RES_3D; z += stride) {
-             float yPos = (float)y / GRID_RES_3D * WORLD_SIZE - halfSize;
-             float zPos = (float)z / GRID_RES_3D * WORLD_SIZE - halfSize;
+             float yPos = (float)y / GRID_RES_3D - halfSize;
+             float zPos = (float)z / GRID_RES_3D - halfSize;
              lines.push_back(glm::vec3(-halfSize, yPos, zPos));
              lines.push_back(glm::vec3(halfSize, yPos, zPos));
         }
@@ -686,8 +3103,8 @@ void InitGrid() {
     // Lines along Y
     for (int x = 0; x <= GRID_RES_3D; x += stride) {
         for (int z = 0; z <= GRID_RES_3D; z += stride) {
-             float xPos = (float)x / GRID_RES_3D * WORLD_SIZE - halfSize;
-             float zPos = (float)z / GRID_RES_3D * WORLD_SIZE - halfSize;
+             float xPos = (float)x / GRID_RES_3D - halfSize;
+             float zPos = (float)z / GRID_RES_3D - halfSize;
              lines.push_back(glm::vec3(xPos, -halfSize, zPos));
              lines.push_back(glm::vec3(xPos, halfSize, zPos));
         }
@@ -695,8 +3112,8 @@ void InitGrid() {
     // Lines along Z
     for (int x = 0; x <= GRID_RES_3D; x += stride) {
         for (int y = 0; y <= GRID_RES_3D; y += stride) {
-             float xPos = (float)x / GRID_RES_3D * WORLD_SIZE - halfSize;
-             float yPos = (float)y / GRID_RES_3D * WORLD_SIZE - halfSize;
+             float xPos = (float)x / GRID_RES_3D - halfSize;
+             float yPos = (float)y / GRID_RES_3D - halfSize;
              lines.push_back(glm::vec3(xPos, yPos, -halfSize));
              lines.push_back(glm::vec3(xPos, yPos, halfSize));
         }
@@ -731,17 +3148,121 @@ void InitGrid() {
     glDeleteShader(fs);
 }
 
-// --- MAIN ---
-int main() {
-    if (!glfwInit()) return -1;
+// --- Auto-test (--selftest) ---
+
+// L'arbre GPU est comparé à la sommation directe sur un échantillon de particules
+bool SelfTestGPUTree() {
+    const float theta = 0.5f, softening = 4.0f;
+    treeTheta = theta;
+    treeSoftening = softening;
+    gravitySolver = GRAVITY_GPU_TREE;
+    ComputeGPUTreeGravity();
+    if (gravitySolver != GRAVITY_GPU_TREE) return false;
+
+    const size_t count = particleCount;
+    std::vector<float> positions(count * 4), result(count * 4);
+    glBindBuffer(GL_ARRAY_BUFFER, posVBO[currIdx]);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::vec4), positions.data());
+    glBindBuffer(GL_ARRAY_BUFFER, treeAccBuffer);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::vec4), result.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    const size_t samples = std::min<size_t>(count, 512);
+    double errorSq = 0.0;
+    for (size_t s = 0; s < samples; s++) {
+        const size_t i = s * (count / samples);
+        double a[3] = { 0.0, 0.0, 0.0 };
+        for (size_t j = 0; j < count; j++) {
+            const double d[3] = { positions[4 * j] - positions[4 * i], positions[4 * j + 1] - positions[4 * i + 1],
+                                  positions[4 * j + 2] - positions[4 * i + 2] };
+            const double r2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2] + softening * softening;
+            const double w = gravityConstant * positions[4 * j + 3] / (r2 * std::sqrt(r2));
+            for (int k = 0; k < 3; k++) a[k] += d[k] * w;
+        }
+        double diff = 0.0, norm = 0.0;
+        for (int k = 0; k < 3; k++) {
+            diff += (result[4 * i + k] - a[k]) * (result[4 * i + k] - a[k]);
+            norm += a[k] * a[k];
+        }
+        errorSq += norm > 0.0 ? diff / norm : diff;
+    }
+    const double rms = std::sqrt(errorSq / samples);
+    const bool pass = rms < 5e-2;
+    std::cout << "selftest: GPU tree theta " << theta << "  rms rel. force error " << rms
+              << (pass ? "  OK" : "  FAILED") << std::endl;
+    return pass;
+}
+
+// Compare le Poisson GPU au solveur CPU sur la même grille de masse (dépôt CIC des particules
+// initiales). Tourne sans GPU avec Mesa llvmpipe (LIBGL_ALWAYS_SOFTWARE=1), d'où les tailles
+// modestes ; 32 et 128 passent par l'étape radix-2 finale, 64 est en radix-4 pur.
+int RunSelfTest() {
+    if (!GPUPoissonSolver::Supported()) {
+        std::cerr << "selftest: OpenGL 4.3 unavailable, GPU Poisson solver not tested" << std::endl;
+        return 1;
+    }
+
+    bool ok = true;
+    const int resolutions[] = { 32, 64, 128 };
+    for (int res : resolutions) {
+        pmGridRes = res;
+        gravitySolver = GRAVITY_PM_CPU;
+        ComputeMeshGravity();
+        const std::vector<float> reference = pmPotential;
+
+        gravitySolver = GRAVITY_PM_GPU;
+        ComputeMeshGravity();
+        if (gravitySolver != GRAVITY_PM_GPU) return 1;   // Échec de compilation / allocation, déjà signalé
+        std::vector<float> result(reference.size());
+        glBindTexture(GL_TEXTURE_3D, pmPotentialTex);
+        glGetTexImage(GL_TEXTURE_3D, 0, GL_RED, GL_FLOAT, result.data());
+        glBindTexture(GL_TEXTURE_3D, 0);
+
+        float maxError = 0.0f, maxValue = 0.0f;
+        for (size_t i = 0; i < reference.size(); i++) {
+            maxError = std::max(maxError, std::fabs(result[i] - reference[i]));
+            maxValue = std::max(maxValue, std::fabs(reference[i]));
+        }
+        const float relative = maxValue > 0.0f ? maxError / maxValue : maxError;
+        const bool pass = relative < 1e-3f;
+        std::cout << "selftest: GPU Poisson " << res << "^3  max rel. error " << relative
+                  << (pass ? "  OK" : "  FAILED") << std::endl;
+        ok = ok && pass;
+    }
+    ok = SelfTestGPUTree() && ok;
+    return ok ? 0 : 1;
+}
 
-    // OpenGL 3.3 suffit pour Transform Feedback de base, mais 4.1 est mieux sur Mac
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+// --- MAIN ---
+int main(int argc, char** argv) {
+    // Ligne de commande : --particles N, --selftest
+    bool selfTest = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "--particles" || arg == "-n") && i + 1 < argc) {
+            long long n = std::atoll(argv[++i]);
+            if (n > 0 && n <= 0x0FFFFFFF) particleCount = targetParticleCount = (unsigned int)n;
+            else std::cerr << "Invalid particle count: " << argv[i] << std::endl;
+        } else if (arg == "--selftest") {
+            selfTest = true;
+        }
+    }
 
-    GLFWwindow* window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Galaxy GPU Sim", NULL, NULL);
+    if (!glfwInit()) return -1;
+    if (selfTest) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    // OpenGL 4.3 pour les compute shaders (Poisson GPU) ; sinon 3.3, qui suffit pour le
+    // Transform Feedback (Mac : 4.1 au maximum, la création en 4.3 y échoue)
+    GLFWwindow* window = NULL;
+    const int contextVersions[][2] = { { 4, 3 }, { 3, 3 } };
+    for (const auto& version : contextVersions) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, version[0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, version[1]);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Galaxy GPU Sim", NULL, NULL);
+        if (window) break;
+    }
     if (!window) return -1;
     glfwMakeContextCurrent(window);
     glfwSwapInterval(0); // Désactiver V-Sync pour voir les max FPS
@@ -763,13 +3284,28 @@ int main() {
     ImGui_ImplOpenGL3_Init("#version 330");
 
     InitGPU();
-    Init
+    InitDensityMap();
+    InitParticleMesh();
     InitPostProcessing(WINDOW_WIDTH, WINDOW_HEIGHT);
     InitGrid();
+    icCacheBytes = ICCacheBytes();
+
+    if (selfTest) {
+        int status = RunSelfTest();
+        ShutdownRegeneration();
+        ClearTemplateCache();
+        gpuPoisson.Release();
+        gpuTree.Release();
+        if (gpuSolveQuery) glDeleteQueries(1, &gpuSolveQuery);
+        glfwTerminate();
+        return status;
+    }
 
     // Main loop
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
+        PollRegeneration();
+        PollInitTimer();
 
         static double lastTime = glfwGetTime();
         double currentTime = glfwGetTime();
@@ -846,10 +3382,42 @@ int main() {
         } else {
             // --- 2D / UI Controls ---
             ImGui::Begin("GPU Controls");
-            ImGui::Text("Particules: %u", PARTICLE_COUNT);
+            ImGui::Text("Particules: %u (capacite %u)", particleCount, particleCapacity);
+            if (targetParticleCount != particleCount) {
+                ImGui::SameLine();
+                ImGui::TextDisabled("-> %u apres generation", targetParticleCount);
+            }
+            static int requestedCount = (int)particleCount;
+            ImGui::InputInt("Nombre", &requestedCount, 100000, 1000000);
+            ImGui::SameLine();
+            if (ImGui::Button("Appliquer") && requestedCount > 0 && (unsigned int)requestedCount != targetParticleCount) {
+                // Appliqué avec les nouvelles conditions initiales (tout de suite, ou à la fin de la génération)
+                targetParticleCount = (unsigned int)requestedCount;
+                ResetSimulation();
+            }
             ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
             
             if (ImGui::Button("Reset / Regen")) ResetSimulation();
+            if (regenJob.running) {
+                ImGui::SameLine();
+                ImGui::TextColored(ImVec4(1,0.6f,0,1), "Generation en cours...");
+            }
+            ImGui::InputInt("Seed", &simSeed);
+            ImGui::Checkbox("Generation GPU", &gpuInitialConditions);
+            ImGui::Text("Generation: %.1f ms (%u threads)%s", lastInitMs, ParallelThreadCount(), lastInitFromCache ? " - cache disque" : "");
+            ImGui::Checkbox("Cache disque", &icDiskCache);
+            ImGui::SameLine();
+            ImGui::Text("%.0f Mo", icCacheBytes / 1048576.0);
+            ImGui::SameLine();
+            if (ImGui::Button("Vider le cache")) {
+                ICCacheClear();
+                icCacheBytes = ICCacheBytes();
+            }
+            int budgetGB = (int)(ICCacheBudget() >> 30);
+            if (ImGui::SliderInt("Budget disque (Go)", &budgetGB, 1, 64)) {
+                ICCacheSetBudget((size_t)budgetGB << 30);   // Les plus anciennes entrées partent tout de suite
+                icCacheBytes = ICCacheBytes();
+            }
             if (ImGui::Button("ENTER FPS MODE (3D Fly)")) {
                 fpsMode = true;
                 firstMouse = true;
@@ -857,11 +3425,211 @@ int main() {
             ImGui::TextColored(ImVec4(1,1,0,1), "Press ESC to exit FPS mode");
 
             ImGui::Separator();
-            ImGui::SliderFloat("Rotation Init", &initialRotation, 0.0f, 5.0f);
-            ImGui::SliderFloat("Dispersion", &dispersion, 100.0f, 1000.0f);
-            ImGui::SliderFloat("Epaisseur Galaxie", &galaxyThickness, 0.0f, 300.0f); // Nouveau controle
-            ImGui::SliderFloat("Self-Gravity", &selfGravityStrength, 0.0f, 5000.0f);
+            const char* models[] = { "Disque (legacy)", "Galaxie a l'equilibre", "Boite cosmologique" };
+            ImGui::Combo("Modele", &icModel, models, IM_ARRAYSIZE(models));
+            ImGui::Checkbox("Quasi-aleatoire (Sobol)", &quasiRandomSampling);
+            if (icModel == IC_LEGACY_DISK) {
+                ImGui::SliderFloat("Rotation Init", &initialRotation, 0.0f, 5.0f);
+                ImGui::SliderFloat("Dispersion", &dispersion, 100.0f, 1000.0f);
+                ImGui::SliderFloat("Epaisseur Galaxie", &galaxyThickness, 0.0f, 300.0f); // Nouveau controle
+            } else if (icModel == IC_COSMOLOGICAL) {
+                if (ImGui::CollapsingHeader("Boite cosmologique")) {
+                    static int gridChoice = 1;
+                    const char* grids[] = { "32^3", "64^3", "128^3", "256^3" };
+                    if (ImGui::Combo("Reseau", &gridChoice, grids, IM_ARRAYSIZE(grids))) cosmoParams.gridSize = 32 << gridChoice;
+                    ImGui::SliderFloat("Taille boite", &cosmoParams.boxSize, 500.0f, 3000.0f);
+                    ImGui::SliderFloat("Boite (Mpc/h)", &cosmoParams.boxMpc, 10.0f, 1000.0f, "%.0f", ImGuiSliderFlags_Logarithmic);
+                    ImGui::SliderFloat("Sigma8", &cosmoParams.sigma8, 0.1f, 2.0f);
+                    ImGui::SliderFloat("Redshift initial", &cosmoParams.redshift, 0.0f, 200.0f);
+                    ImGui::SliderFloat("Indice spectral (ns)", &cosmoParams.spectralIndex, 0.8f, 1.1f);
+                    ImGui::SliderFloat("Gamma (Omega_m h)", &cosmoParams.shapeGamma, 0.05f, 0.5f);
+                    ImGui::SliderFloat("Masse particule", &cosmoParams.particleMass, 0.1f, 10.0f);
+                    ImGui::SliderFloat("Vitesse (x mode croissant)", &cosmoParams.velocityScale, 0.0f, 5.0f);
+                }
+            } else if (ImGui::CollapsingHeader("Modele galactique")) {
+                ImGui::SliderFloat("Masse Disque", &galaxyParams.diskMass, 1.0e4f, 1.0e7f, "%.3g", ImGuiSliderFlags_Logarithmic);
+                ImGui::SliderFloat("Rayon Disque (Rd)", &galaxyParams.diskScaleLength, 20.0f, 600.0f);
+                ImGui::SliderFloat("Hauteur Disque (z0)", &galaxyParams.diskScaleHeight, 1.0f, 150.0f);
+                ImGui::SliderFloat("Q Toomre", &galaxyParams.toomreQ, 0.5f, 4.0f);
+                ImGui::SliderFloat("Masse Bulbe", &galaxyParams.bulgeMass, 0.0f, 1.0e7f, "%.3g", ImGuiSliderFlags_Logarithmic);
+                ImGui::SliderFloat("Rayon Bulbe (a)", &galaxyParams.bulgeScale, 5.0f, 300.0f);
+                ImGui::SliderFloat("Masse Halo", &galaxyParams.haloMass, 0.0f, 1.0e8f, "%.3g", ImGuiSliderFlags_Logarithmic);
+                ImGui::SliderFloat("Rayon Halo (rs)", &galaxyParams.haloScale, 50.0f, 1500.0f);
+                ImGui::SliderFloat("Concentration", &galaxyParams.haloConcentration, 2.0f, 30.0f);
+                // Importance sampling : particules plus lourdes (donc moins nombreuses) dans les composantes diffuses
+                ImGui::SliderFloat("Masse part. Bulbe (x disque)", &galaxyParams.bulgeParticleMassRatio, 1.0f, 20.0f);
+                ImGui::SliderFloat("Masse part. Halo (x disque)", &galaxyParams.haloParticleMassRatio, 1.0f, 50.0f);
+            }
+            if (ImGui::CollapsingHeader("Scene multi-galaxies")) {
+                ImGui::Checkbox("Mode scene (Reset = composer)", &sceneMode);
+                static int sceneBudget = 500000;
+                ImGui::InputInt("Particules / galaxie", &sceneBudget, 100000, 500000);
+                if (ImGui::Button("Ajouter (modele courant)") && sceneBudget > 0) {
+                    AddSceneGalaxy((size_t)sceneBudget, glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Preset collision") && sceneBudget > 0) {
+                    // Deux galaxies sur une orbite de rencontre, disques inclinés l'un par rapport à l'autre
+                    sceneGalaxies.clear();
+                    AddSceneGalaxy((size_t)sceneBudget, glm::vec3(-700.0f, -150.0f, 0.0f), glm::vec3(15.0f, 4.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+                    AddSceneGalaxy((size_t)sceneBudget, glm::vec3(700.0f, 150.0f, 0.0f), glm::vec3(-15.0f, -4.0f, 0.0f), glm::vec3(0.5f, 0.0f, 0.85f));
+                    sceneMode = true;
+                }
+                for (size_t k = 0; k < sceneGalaxies.size(); k++) {
+                    SceneGalaxy& g = sceneGalaxies[k];
+                    ImGui::PushID((int)k);
+                    ImGui::Text("Galaxie %d : %s, seed %u", (int)k, g.model.model == IC_EQUILIBRIUM ? "equilibre" : g.model.model == IC_COSMOLOGICAL ? "cosmologique" : "legacy", g.model.seed);
+                    int budget = (int)g.model.count;
+                    if (ImGui::InputInt("Particules", &budget, 100000, 500000) && budget > 0) g.model.count = (size_t)budget;
+                    ImGui::DragFloat3("Position", &g.position[0], 5.0f, -WORLD_SIZE * 0.5f, WORLD_SIZE * 0.5f);
+                    ImGui::DragFloat3("Vitesse", &g.velocity[0], 0.5f);
+                    ImGui::DragFloat3("Axe de spin", &g.spinAxis[0], 0.02f, -1.0f, 1.0f);
+                    bool remove = ImGui::Button("Retirer");
+                    ImGui::PopID();
+                    if (remove) {
+                        sceneGalaxies.erase(sceneGalaxies.begin() + k);
+                        break;
+                    }
+                }
+                if (ImGui::Button("Composer la scene")) {
+                    sceneMode = true;
+                    ComposeScene();
+                }
+                ImGui::Text("Gabarits en cache: %d (%.0f Mo)", (int)templateCache.size(), TemplateCacheBytes() / 1048576.0);
+            }
+            const char* solvers[] = { "Gradient densite (legacy)", "Particle-mesh CPU (FFT)",
+                                      "Particle-mesh GPU (compute, GL 4.3)", "Barnes-Hut CPU (octree)",
+                                      "Arbre GPU (Karras, GL 4.3)", "FMM CPU (multipoles)",
+                                      "TreePM (PM + arbre courte portee)", "Somme directe CPU (exacte)",
+                                      "PM isole CPU (multigrille)", "Pyramide de masse GPU (champ lointain)",
+                                      "PM isole CPU (FFT 2n, Hockney-Eastwood)" };
+            ImGui::Combo("Gravite", &gravitySolver, solvers, IM_ARRAYSIZE(solvers));
+            // Sans contexte 4.3, les solveurs GPU retombent sur leur équivalent CPU
+            if (gravitySolver == GRAVITY_PM_GPU && !GPUPoissonSolver::Supported()) gravitySolver = GRAVITY_PM_CPU;
+            if (gravitySolver == GRAVITY_GPU_TREE && !GPUTreeSolver::Supported()) gravitySolver = GRAVITY_BARNES_HUT;
+            static int meshChoice = 0;
+            const char* meshes[] = { "64^3", "128^3", "256^3" };
+            if (gravitySolver == GRAVITY_DENSITY_GRADIENT) {
+                ImGui::SliderFloat("Self-Gravity", &selfGravityStrength, 0.0f, 5000.0f);
+            } else if (gravitySolver == GRAVITY_MIP_PYRAMID) {
+                ImGui::SliderFloat("G", &gravityConstant, 0.01f, 100.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+                ImGui::Text("Pyramide %d^3 -> %d^3: %.2f ms (GPU %.2f ms)", GRID_RES_3D, GRID_RES_3D >> (MIP_LEVELS - 1),
+                            lastGravityMs, lastSolveMs);
+            } else if (gravitySolver == GRAVITY_TREEPM) {
+                if (ImGui::Combo("Maillage PM", &meshChoice, meshes, IM_ARRAYSIZE(meshes))) pmGridRes = 64 << meshChoice;
+                ImGui::SliderFloat("r_s (cellules)", &treePMSplit, 0.5f, 4.0f, "%.2f");
+                ImGui::SliderFloat("Theta", &treeTheta, 0.2f, 1.0f, "%.2f");
+                ImGui::SliderFloat("Adoucissement", &treeSoftening, 0.5f, 50.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+                ImGui::SliderFloat("G", &gravityConstant, 0.01f, 100.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+                const BarnesHutStats& stats = barnesHut.Stats();
+                ImGui::Text("TreePM: PM %.1f ms, arbre %.1f ms", lastMeshMs, stats.buildMs + stats.walkMs);
+                // Même maillage que le solveur (pmAllocatedRes peut être limité ou pas encore alloué)
+                const int meshRes = pmAllocatedRes > 0 ? pmAllocatedRes : pmGridRes;
+                ImGui::Text("rcut %.0f, %.0f interactions/particule",
+                            BarnesHutSolver::SPLIT_CUTOFF * treePMSplit * gridSize / meshRes,
+                            stats.interactionsPerParticle);
+            } else if (UsesTree()) {
+                if (gravitySolver == GRAVITY_FMM) {
+                    ImGui::SliderInt("Ordre", &fmmOrder, 1, FMMSolver::MAX_ORDER);
+                    ImGui::SliderFloat("Theta", &fmmTheta, 0.3f, 1.0f, "%.2f");
+                } else if (gravitySolver == GRAVITY_DIRECT) {
+                    const char* levels[] = { "Generique", "AVX2 + FMA", "AVX-512" };
+                    int simd = directSum.Level();
+                    if (ImGui::Combo("SIMD", &simd, levels, DirectSumSolver::DetectLevel() + 1))
+                        directSum.SetLevel((SimdLevel)simd);
+                } else {
+                    ImGui::SliderFloat("Theta", &treeTheta, 0.2f, 1.0f, "%.2f");
+                }
+                ImGui::SliderFloat("Adoucissement", &treeSoftening, 0.5f, 50.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+                ImGui::SliderFloat("G", &gravityConstant, 0.01f, 100.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+                if (gravitySolver == GRAVITY_GPU_TREE) {
+                    ImGui::Text("Arbre GPU: %.2f ms (GPU %.2f ms)", lastGravityMs, lastSolveMs);
+                } else if (gravitySolver == GRAVITY_DIRECT) {
+                    const DirectSumStats& stats = directSum.Stats();
+                    ImGui::Text("Direct: %.1f ms, %.2f G interactions/s (%s)", lastGravityMs,
+                                stats.interactionsPerSecond * 1e-9, DirectSumSolver::LevelName(directSum.Level()));
+                } else if (gravitySolver == GRAVITY_FMM) {
+                    const FMMStats& stats = fmm.Stats();
+                    ImGui::Text("FMM: %.1f ms (arbre %.1f, montee %.1f, interactions %.1f, descente %.1f)", lastGravityMs,
+                                stats.buildMs, stats.upwardMs, stats.interactMs, stats.downwardMs);
+                    ImGui::Text("%zu noeuds, %.1f M2L/cellule, %.0f paires directes/particule", stats.nodeCount,
+                                stats.m2lPerCell, stats.directPerParticle);
+                } else {
+                    const BarnesHutStats& stats = barnesHut.Stats();
+                    ImGui::Text("BH: %.1f ms (arbre %.1f ms, forces %.1f ms)", lastGravityMs, stats.buildMs, stats.walkMs);
+                    ImGui::Text("%zu noeuds, %.0f interactions/particule", stats.nodeCount, stats.interactionsPerParticle);
+                }
+                // Pas interactifs qu'autour de 10^5 particules : prévenir au million par défaut
+                if (gravitySolver == GRAVITY_BARNES_HUT || gravitySolver == GRAVITY_FMM) {
+                    const float rate = (gravitySolver == GRAVITY_FMM ? FMM_RATE : BARNES_HUT_RATE) * ParallelThreadCount();
+                    const float stepSeconds = particleCount / rate;
+                    if (stepSeconds > 0.1f)
+                        ImGui::TextColored(ImVec4(1, 0.6f, 0, 1), "~%.1f s/pas a %u particules (10 pas/s: ~%.0fk max)",
+                                           stepSeconds, particleCount, 0.1f * rate / 1000.0f);
+                }
+            } else {
+                if (ImGui::Combo("Maillage PM", &meshChoice, meshes, IM_ARRAYSIZE(meshes))) pmGridRes = 64 << meshChoice;
+                ImGui::SliderFloat("G", &gravityConstant, 0.01f, 100.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+                if (gravitySolver == GRAVITY_MULTIGRID) {
+                    ImGui::SliderInt("V-cycles max", &mgMaxCycles, 1, 8);
+                    ImGui::SliderFloat("Tolerance", &mgTolerance, 1.0e-5f, 1.0e-1f, "%.0e", ImGuiSliderFlags_Logarithmic);
+                    const MultigridStats& stats = multigrid.Stats();
+                    ImGui::Text("PM: %.1f ms (multigrille %.1f ms, bords %.1f ms)", lastGravityMs, lastSolveMs,
+                                stats.boundaryMs);
+                    ImGui::Text("%d cycles, %d niveaux, residu %.1e -> %.1e", stats.cycles, stats.levels,
+                                stats.initialResidual, stats.residual);
+                    ImGui::SliderInt("Grilles emboitees", &nestedLevels, 0, MAX_NESTED);
+                    if (nestedLevels > 0) {
+                        ImGui::Checkbox("Zoom sur la cellule la plus dense", &nestedOnDensest);
+                        if (!nestedOnDensest) ImGui::DragFloat3("Point de zoom", &nestedPoint.x, 5.0f);
+                        ImGui::Text("Zoom x%d, cellule %.1f: %.1f ms pour %d grilles", 1 << nestedLevels,
+                                    gridSize / (pmAllocatedRes << nestedLevels), lastNestedMs, nestedLevels);
+                    }
+                } else if (gravitySolver == GRAVITY_PM_GPU) {
+                    ImGui::Text("PM GPU: %.2f ms (Poisson GPU %.2f ms)", lastGravityMs, lastSolveMs);
+                } else if (gravitySolver == GRAVITY_PM_ISOLATED) {
+                    ImGui::Text("PM isole %d^3: %.1f ms (FFT %d^3 %.1f ms, noyau en cache %.0f ms)", pmAllocatedRes,
+                                lastGravityMs, 2 * pmAllocatedRes, lastSolveMs, pmSolver.IsolatedGreenMs());
+                    if (pmGridRes > PMSolver::MAX_ISOLATED)
+                        ImGui::TextDisabled("Maillage limite a %d^3 (grille doublee en memoire)", PMSolver::MAX_ISOLATED);
+                } else {
+                    ImGui::Text("PM: %.1f ms (FFT %.1f ms)", lastGravityMs, lastSolveMs);
+                }
+                ImGui::Checkbox("Correction P3M (amas)", &p3mEnabled);
+                if (p3mEnabled) {
+                    ImGui::SliderFloat("Seuil masse/cellule", &p3mMassThreshold, 1.0f, 10000.0f, "%.0f", ImGuiSliderFlags_Logarithmic);
+                    ImGui::SliderFloat("Adoucissement", &treeSoftening, 0.5f, 50.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+                    const P3MStats& stats = p3m.Stats();
+                    ImGui::Text("P3M: %.1f ms (tri %.1f ms), %zu cases denses, %zu particules, %.0f paires/particule",
+                                stats.binMs + stats.pairMs, stats.binMs, stats.activeCells, stats.activeParticles,
+                                stats.pairsPerParticle);
+                    ImGui::Text("rcut %.1f (%.1f cellules PM)", P3MCorrection::CUTOFF_CELLS * gridSize / pmAllocatedRes,
+                                P3MCorrection::CUTOFF_CELLS);
+                }
+            }
+            if (ImGui::Checkbox("Boite adaptative", &adaptiveBox) && !adaptiveBox) ResetSimulationBox();
+            if (adaptiveBox) {
+                ImGui::SliderInt("Pas entre mises a jour", &boxUpdateInterval, 1, 128);
+                ImGui::SliderFloat("Masse couverte", &boxCoverage, 0.9f, 1.0f, "%.4f");
+                ImGui::SliderFloat("Marge", &boxMargin, 1.0f, 1.5f, "%.2f");
+                ImGui::Text("Boite %.0f centree (%.0f, %.0f, %.0f), %.2f%% de la masse hors boite (%.2f ms)", gridSize,
+                            gridCenter.x, gridCenter.y, gridCenter.z, 100.0f * boxOutsideFraction, lastBoxMs);
+            }
+            if (ImGui::Button("Erreur vs somme directe")) MeasureGravityAccuracy();
+            if (accuracyRms >= 0.0f) {
+                ImGui::SameLine();
+                ImGui::Text("rms %.2e, mediane %.2e, max %.2e (%.0f ms)", accuracyRms, accuracyMedian, accuracyMax,
+                            accuracyMs);
+            }
             ImGui::SliderFloat("Friction (Sticky)", &frictionStrength, 0.0f, 10.0f);
+            // Raffinement de densityTex : gravité historique et friction
+            if (ImGui::Checkbox("Grille de densite raffinee (AMR)", &amrEnabled)) amrCountdown = 0;
+            if (amrEnabled) {
+                ImGui::SliderInt("Particules/brique", &amrThreshold, 512, 262144, "%d", ImGuiSliderFlags_Logarithmic);
+                ImGui::SliderInt("Pas entre recomptages", &amrRegridInterval, 1, 64);
+                ImGui::Text("%d/%d briques raffinees (%zu particules): %.2f ms", amrUsedSlots, AMR_SLOTS,
+                            amrRefinedParticles, lastAmrMs);
+            }
             ImGui::Separator();
             ImGui::Checkbox("Bloom", &enableBloom);
             ImGui::SliderFloat("Bloom Intensity", &bloomIntensity, 0.0f, 2.0f);
@@ -914,69 +3682,12 @@ int main() {
             
         // --- STEP 1: PHYSICS UPDATE (Transform Feedback) ---
         if (!isPaused) {
-            // -- STEP 1.A: Compute Density Map --
-            glBindFramebuffer(GL_FRAMEBUFFER, densityFBO);
-            // Viewport doit couvrir x,y de la texture 3D
-            glViewport(0, 0, GRID_RES_3D, GRID_RES_3D);
-            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
-            
-            // Additive blending
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_ONE, GL_ONE); 
-            
-            glUseProgram(densityProgram);
-            glUniform1f(glGetUniformLocation(densityProgram, "worldSize"), WORLD_SIZE);
-            glUniform1i(glGetUniformLocation(densityProgram, "gridRes"), GRID_RES_3D);
-            
-            glBindVertexArray(VAO[currIdx]);
-            glDrawArrays(GL_POINTS, 0, PARTICLE_COUNT);
-            
-            glDisable(GL_BLEND);
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-            // --- GENERATE MIPMAPS ---
-            // Pas de mipmaps 3D auto en OpenGL 3.3 facilement
-            // glGenerateMipmap marche pour TEXTURE_3D en OpenGL 4.0+
-            // Testons:
-            // glBindTexture(GL_TEXTURE_3D, densityTex);
-            // glGenerateMipmap(GL_TEXTURE_3D);
-            
-            
-            // -- STEP 1.B: Physics Update with TF --
-            glUseProgram(physicsProgram);
-            
-            glUniform1f(glGetUniformLocation(physicsProgram, "dt"), dt * timeSpeed);
-            glUniform1f(glGetUniformLocation(physicsProgram, "blackHoleMass"), blackHoleMass);
-            glUniform2f(glGetUniformLocation(physicsProgram, "centerPos"), 0.0f, 0.0f);
-            glUniform1f(glGetUniformLocation(physicsProgram, "worldSize"), WORLD_SIZE);
-            glUniform1f(glGetUniformLocation(physicsProgram, "selfGravityStrength"), selfGravityStrength);
-            glUniform1f(glGetUniformLocation(physicsProgram, "frictionStrength"), frictionStrength);
-            glUniform1f(glGetUniformLocation(physicsProgram, "gridRes"), (float)GRID_RES_3D);
-            
-            // Bind Texture Grid 3D
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_3D, densityTex);
-            glUniform1i(glGetUniformLocation(physicsProgram, "gridTex"), 0);
-
-            // On désactive le rendu graphique, on veut juste écrire dans les buffers
-            glEnable(GL_RASTERIZER_DISCARD);
-
-            // Bind Source VAO (Current)
-            glBindVertexArray(VAO[currIdx]);
-
-            // Bind Destination TF (Next)
-            glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, transformFeedback[nextIdx]);
+            // -- STEP 1.A: Density Map + gravité --
+            ComputeGravity();
 
-            // Start TF
-            glBeginTransformFeedback(GL_POINTS);
-                glDrawArrays(GL_POINTS, 0, PARTICLE_COUNT);
-            glEndTransformFeedback();
+            // -- STEP 1.B: Physics Update with TF --
+            RunPhysicsStep(dt * timeSpeed, blackHoleMass, frictionStrength);
 
-            // Cleanup & Swap
-            glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
-            glDisable(GL_RASTERIZER_DISCARD);
-            
             // Swap indices ping-pong
             std::swap(currIdx, nextIdx);
         }
@@ -1039,7 +3750,20 @@ int main() {
 
         // Dessiner le buffer "Current" (qui vient d'être mis à jour)
         glBindVertexArray(VAO[currIdx]); 
-        glDrawArrays(GL_POINTS, 0, PARTICLE_COUNT);
+        glDrawArrays(GL_POINTS, 0, particleCount);
+
+        // Grille de calcul : une ligne toutes les 4 cellules de densityTex, sur la boîte courante
+        if (showGrid) {
+            const glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), gridCenter), glm::vec3(gridSize));
+            glUseProgram(gridProgram);
+            glUniformMatrix4fv(glGetUniformLocation(gridProgram, "projection"), 1, GL_FALSE, &proj[0][0]);
+            glUniformMatrix4fv(glGetUniformLocation(gridProgram, "view"), 1, GL_FALSE, &view[0][0]);
+            glUniformMatrix4fv(glGetUniformLocation(gridProgram, "model"), 1, GL_FALSE, &model[0][0]);
+            glUniform4f(glGetUniformLocation(gridProgram, "gridColor"), 0.2f, 0.4f, 0.8f, 0.15f);
+            glBindVertexArray(gridVAO);
+            glDrawArrays(GL_LINES, 0, gridLinesCount);
+        }
+        glBindVertexArray(0);
         
         glDisable(GL_BLEND);
 
@@ -1090,6 +3814,13 @@ int main() {
     }
 
     // Cleanup
+    ShutdownRegeneration();
+    ClearTemplateCache();
+    gpuPoisson.Release();
+    gpuTree.Release();
+    if (gpuSolveQuery) glDeleteQueries(1, &gpuSolveQuery);
+    if (treeAccBuffer) glDeleteBuffers(1, &treeAccBuffer);
+    if (treeAccTex) glDeleteTextures(1, &treeAccTex);
     glDeleteVertexArrays(2, VAO);
     glDeleteBuffers(2, posVBO);
     glDeleteBuffers(2, velVBO);